@@ -0,0 +1,826 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "storyboard/storyboard.hpp"
+#include "storyboard/storyboardCAPI.h"
+#include "storyboard/storyboardCppAPI.hpp"
+
+//-------------------
+// --- Test data ---
+//-------------------
+namespace {
+
+const std::size_t VOCABULARY_SIZE  = 1000;  // Number of distinct words in the texts
+const std::size_t NR_DISTINCT_TAGS = 500;   // Number of distinct tags
+
+struct NoteData
+{
+    std::string              title;
+    std::string              text;
+    std::vector<std::string> tags;
+};
+
+/**
+ * @brief Small, seedable random number generator (splitmix64), so that note i is the same in every run
+ */
+class Random
+{
+public:
+    explicit Random(std::uint64_t seed) : m_state(seed)
+    {
+    }
+
+    std::uint64_t next()
+    {
+        std::uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+        z               = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z               = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * @brief Returns a value in [0, n) with a roughly Zipfian distribution, i.e. small values are much more common
+     */
+    std::size_t zipf(std::size_t n)
+    {
+        // Inverse transform of a continuous 1/x distribution over [1, n + 1)
+        double u = (next() >> 11) * (1.0 / 9007199254740992.0);
+        return static_cast<std::size_t>(std::pow(static_cast<double>(n + 1), u)) - 1;
+    }
+
+    std::size_t uniform(std::size_t lo, std::size_t hi)
+    {
+        return lo + next() % (hi - lo + 1);
+    }
+
+private:
+    std::uint64_t m_state;
+};
+
+/**
+ * @brief Generates the i:th note: unique title, 8-24 words of text and 1-4 tags, both drawn from Zipfian distributions
+ */
+NoteData makeNote(std::size_t index)
+{
+    Random   random(index);
+    NoteData note;
+
+    note.title = "note-" + std::to_string(index);
+
+    std::size_t nr_words = random.uniform(8, 24);
+    for (std::size_t word = 0; word < nr_words; word++)
+    {
+        note.text.append(word ? " w" : "w").append(std::to_string(random.zipf(VOCABULARY_SIZE)));
+    }
+
+    std::size_t nr_tags = random.uniform(1, 4);
+    for (std::size_t tag = 0; tag < nr_tags; tag++)
+    {
+        note.tags.push_back("tag" + std::to_string(random.zipf(NR_DISTINCT_TAGS)));
+    }
+
+    return note;
+}
+
+// Queries: one title hit, a mid-frequency word and tag, and a rare tag
+const char  QUERY_TEXT[]   = "w42 ";
+const char* QUERY_TAG      = "tag7";
+const char* QUERY_RARE_TAG = "tag444";
+
+// Multi-tag queries: frequent tags, so that both the union and the intersection are large
+const storyboard::tag_cont_t QUERY_TAGS{"tag0", "tag1", "tag2"};
+
+// Block filters of the *Filtered benchmarks
+const std::size_t BLOCK_FILTER_SIZE = 256;
+const double      BLOCK_FILTER_RATE = 0.01;
+
+// Query cache of the *Cached benchmarks
+const std::size_t QUERY_CACHE_CAPACITY = 16;
+
+std::string queryTitle(std::size_t nr_notes)
+{
+    return "note-" + std::to_string(nr_notes / 2);
+}
+
+//------------------
+// --- Fixtures ---
+//------------------
+
+// Releases the most recently built fixture
+std::function<void()> g_release_fixture;
+
+/**
+ * @brief Returns a board with nr_notes notes. Boards are large, so only the most recently requested one is kept alive.
+ */
+template <typename Fixture>
+Fixture& fixture(std::size_t nr_notes)
+{
+    static std::unique_ptr<Fixture> instance;
+
+    if (!instance || instance->nr_notes != nr_notes)
+    {
+        if (g_release_fixture)
+        {
+            g_release_fixture();
+        }
+
+        instance.reset(new Fixture(nr_notes));
+        g_release_fixture = [] { instance.reset(); };
+    }
+
+    return *instance;
+}
+
+struct CoreFixture
+{
+    explicit CoreFixture(std::size_t nr_notes) : nr_notes(nr_notes)
+    {
+        for (std::size_t index = 0; index < nr_notes; index++)
+        {
+            NoteData data = makeNote(index);
+            board.addNote(storyboard::Note(data.title, data.text, data.tags));
+        }
+    }
+
+    std::size_t            nr_notes;
+    storyboard::Storyboard board;
+};
+
+note_t constructNote(const NoteData& data)
+{
+    std::vector<const char*> tags;
+    for (auto& tag : data.tags)
+    {
+        tags.push_back(tag.c_str());
+    }
+
+    return note_construct(data.title.c_str(), data.text.c_str(), tags.data(), tags.size(), nullptr);
+}
+
+struct CFixture
+{
+    explicit CFixture(std::size_t nr_notes) : nr_notes(nr_notes), board(storyboard_construct(nullptr))
+    {
+        for (std::size_t index = 0; index < nr_notes; index++)
+        {
+            note_t note = constructNote(makeNote(index));
+            storyboard_add_note(board, note, nullptr);
+            note_destruct(note);
+        }
+    }
+
+    ~CFixture()
+    {
+        storyboard_destruct(board);
+    }
+
+    std::size_t nr_notes;
+    board_t     board;
+};
+
+struct CppFixture
+{
+    explicit CppFixture(std::size_t nr_notes) : nr_notes(nr_notes)
+    {
+        for (std::size_t index = 0; index < nr_notes; index++)
+        {
+            NoteData data = makeNote(index);
+            board.addNote(Note(data.title, data.text, data.tags));
+        }
+    }
+
+    std::size_t nr_notes;
+    StoryBoard  board;
+};
+
+void ignoreResult(void*, const char* title, const char*, const char*[], int32_t)
+{
+    benchmark::DoNotOptimize(title);
+}
+
+void ignoreResultN(void*, const char* title, int32_t, const char*, int32_t, const char* const*, const int32_t*, int32_t)
+{
+    benchmark::DoNotOptimize(title);
+}
+
+/**
+ * @brief Reports the number of notes on the board, and counts the scanned notes as processed items
+ */
+void setScanCounters(benchmark::State& state, std::size_t nr_notes)
+{
+    state.counters["notes"] = nr_notes;
+    state.SetItemsProcessed(state.iterations() * nr_notes);
+}
+
+//-------------------------------
+// --- Core Storyboard (C++) ---
+//-------------------------------
+void coreSearchByTitle(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&       board = fixture<CoreFixture>(nr_notes).board;
+    std::string title = queryTitle(nr_notes);
+
+    for (auto _ : state)
+    {
+        storyboard::note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByTitle(title, result));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void coreSearchByText(benchmark::State& state, std::size_t nr_notes)
+{
+    auto& board = fixture<CoreFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        storyboard::note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByText(QUERY_TEXT, result));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void coreSearchByTextCompressed(benchmark::State& state, std::size_t nr_notes)
+{
+    // Compressing a copy leaves the fixture as it is for the other benchmarks
+    storyboard::Storyboard board(fixture<CoreFixture>(nr_notes).board);
+    std::size_t            text_bytes = board.memoryUsage().texts;
+    board.setTextCompression(true);
+
+    for (auto _ : state)
+    {
+        storyboard::note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByText(QUERY_TEXT, result));
+    }
+
+    storyboard::MemoryUsage usage = board.memoryUsage();
+    state.counters["ratio"]       = static_cast<double>(text_bytes) / (usage.texts + usage.dictionary);
+    setScanCounters(state, nr_notes);
+}
+
+void coreSearchByTextSpilled(benchmark::State& state, std::size_t nr_notes)
+{
+    // A quarter of the texts fit in the budget, the rest is read back from the segment file by every scan
+    storyboard::Storyboard   board(fixture<CoreFixture>(nr_notes).board);
+    storyboard::MemoryUsage before = board.memoryUsage();
+    board.setMemoryBudget(before.notes + before.titles + before.texts / 4, ".");
+
+    for (auto _ : state)
+    {
+        storyboard::note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByText(QUERY_TEXT, result));
+    }
+
+    state.counters["spilled"] = static_cast<double>(board.memoryUsage().spilled) / before.texts;
+    setScanCounters(state, nr_notes);
+}
+
+void coreSearchByTag(benchmark::State& state, std::size_t nr_notes, const char* tag)
+{
+    auto&                  board = fixture<CoreFixture>(nr_notes).board;
+    storyboard::tag_cont_t tags{tag};
+
+    for (auto _ : state)
+    {
+        storyboard::note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByTag(tags, result));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void coreSearchByTitleFiltered(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&       board = fixture<CoreFixture>(nr_notes).board;
+    std::string title = queryTitle(nr_notes);
+
+    // The filters are only enabled for this benchmark, the other ones measure a plain scan
+    board.setBlockFilter(BLOCK_FILTER_SIZE, BLOCK_FILTER_RATE);
+
+    for (auto _ : state)
+    {
+        storyboard::note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByTitle(title, result));
+    }
+
+    state.counters["filter_bytes"] = board.memoryUsage().filters;
+    board.setBlockFilter(0, 0.0);
+    setScanCounters(state, nr_notes);
+}
+
+void coreSearchByTagFiltered(benchmark::State& state, std::size_t nr_notes, const char* tag)
+{
+    auto&                  board = fixture<CoreFixture>(nr_notes).board;
+    storyboard::tag_cont_t tags{tag};
+
+    board.setBlockFilter(BLOCK_FILTER_SIZE, BLOCK_FILTER_RATE);
+
+    for (auto _ : state)
+    {
+        storyboard::note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByTag(tags, result));
+    }
+
+    board.setBlockFilter(0, 0.0);
+    setScanCounters(state, nr_notes);
+}
+
+void coreSearchByTags(benchmark::State& state, std::size_t nr_notes, storyboard::TagMatch match)
+{
+    auto& board = fixture<CoreFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        storyboard::note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByTag(QUERY_TAGS, result, match));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void coreSearchByTagsCached(benchmark::State& state, std::size_t nr_notes, storyboard::TagMatch match)
+{
+    auto& board = fixture<CoreFixture>(nr_notes).board;
+
+    // After the first iteration the results come from the cache, without computing the postings again
+    board.setQueryCacheCapacity(QUERY_CACHE_CAPACITY);
+
+    for (auto _ : state)
+    {
+        storyboard::note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByTag(QUERY_TAGS, result, match));
+    }
+
+    board.setQueryCacheCapacity(0);
+    setScanCounters(state, nr_notes);
+}
+
+void coreCountByTags(benchmark::State& state, std::size_t nr_notes, storyboard::TagMatch match)
+{
+    auto& board = fixture<CoreFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(board.countByTag(QUERY_TAGS, match));
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+void coreSearchComposed(benchmark::State& state, std::size_t nr_notes)
+{
+    using namespace storyboard::query;
+
+    auto&       board = fixture<CoreFixture>(nr_notes).board;
+    std::string tag   = QUERY_TAG;
+    std::string text  = QUERY_TEXT;
+
+    for (auto _ : state)
+    {
+        int nr_long = 0;
+        benchmark::DoNotOptimize(board.search(hasTag(tag) && !textContains(text), [&nr_long](const auto& note) {
+            nr_long += note.getText().size() > 100;
+        }));
+        benchmark::DoNotOptimize(nr_long);
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void coreCountByTag(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&                  board = fixture<CoreFixture>(nr_notes).board;
+    storyboard::tag_cont_t tags{QUERY_TAG};
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(board.countByTag(tags));
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+void coreDeleteNote(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&            board = fixture<CoreFixture>(nr_notes).board;
+    NoteData         data  = makeNote(nr_notes / 2);
+    storyboard::Note note(data.title, data.text, data.tags);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(board.deleteNote(note));
+
+        // Keep the size of the board constant
+        state.PauseTiming();
+        board.addNote(note);
+        state.ResumeTiming();
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+void coreConstructNote(benchmark::State& state)
+{
+    // The producer side of a concurrent ingest: every thread constructs notes, which interns and releases their tags
+    static const std::vector<NoteData> notes = [] {
+        std::vector<NoteData> data;
+
+        for (std::size_t index = 0; index < 1000; index++)
+        {
+            data.push_back(makeNote(index));
+        }
+
+        return data;
+    }();
+
+    std::size_t index = state.thread_index() * notes.size() / state.threads();
+
+    for (auto _ : state)
+    {
+        const NoteData&  data = notes[index++ % notes.size()];
+        storyboard::Note note(data.title, data.text, data.tags);
+        benchmark::DoNotOptimize(note);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+void coreAddNote(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&            board = fixture<CoreFixture>(nr_notes).board;
+    NoteData         data  = makeNote(nr_notes);
+    storyboard::Note note(data.title, data.text, data.tags);
+
+    for (auto _ : state)
+    {
+        board.addNote(note);
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+void coreAddDuplicate(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&            board = fixture<CoreFixture>(nr_notes).board;
+    NoteData         data  = makeNote(nr_notes / 2);
+    storyboard::Note note(data.title, data.text, data.tags);
+
+    // The note is already on the board, so every add is rejected and the board does not change
+    board.setRejectDuplicates(true);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(board.addNote(note));
+    }
+
+    board.setRejectDuplicates(false);
+    state.counters["notes"] = nr_notes;
+}
+
+void coreMergeDuplicates(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&                  board = fixture<CoreFixture>(nr_notes).board;
+    storyboard::Storyboard copy(board);
+
+    // All the notes of the copy are already on the board, so every merge skips them and the board does not change
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(board.merge(copy, storyboard::MergePolicy::SkipDuplicates));
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+void coreDiff(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&                  board = fixture<CoreFixture>(nr_notes).board;
+    storyboard::Storyboard copy(board);
+    auto                   ignore = [](const storyboard::Note&) {};
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(board.diff(copy, ignore, ignore));
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+//--------------
+// --- C ABI ---
+//--------------
+void cSearchByTitle(benchmark::State& state, std::size_t nr_notes)
+{
+    board_t     board = fixture<CFixture>(nr_notes).board;
+    std::string title = queryTitle(nr_notes);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(storyboard_search_by_title(board, title.c_str(), ignoreResult, nullptr, nullptr));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void cSearchByTitleN(benchmark::State& state, std::size_t nr_notes)
+{
+    board_t     board = fixture<CFixture>(nr_notes).board;
+    std::string title = queryTitle(nr_notes);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+            storyboard_search_by_title_n(board, title.data(), title.size(), ignoreResultN, nullptr, nullptr));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void cSearchByText(benchmark::State& state, std::size_t nr_notes)
+{
+    board_t board = fixture<CFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(storyboard_search_by_text(board, QUERY_TEXT, ignoreResult, nullptr, nullptr));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void cSearchByTag(benchmark::State& state, std::size_t nr_notes, const char* tag)
+{
+    board_t board = fixture<CFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(storyboard_search_by_tag(board, tag, ignoreResult, nullptr, nullptr));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void cCountByTag(benchmark::State& state, std::size_t nr_notes)
+{
+    board_t board = fixture<CFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(storyboard_count_by_tag(board, QUERY_TAG, nullptr));
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+void cDeleteNote(benchmark::State& state, std::size_t nr_notes)
+{
+    board_t board = fixture<CFixture>(nr_notes).board;
+    note_t  note  = constructNote(makeNote(nr_notes / 2));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(storyboard_delete_note(board, note, nullptr));
+
+        // Keep the size of the board constant
+        state.PauseTiming();
+        storyboard_add_note(board, note, nullptr);
+        state.ResumeTiming();
+    }
+
+    note_destruct(note);
+    state.counters["notes"] = nr_notes;
+}
+
+void cAddNote(benchmark::State& state, std::size_t nr_notes)
+{
+    board_t board = fixture<CFixture>(nr_notes).board;
+    note_t  note  = constructNote(makeNote(nr_notes));
+
+    for (auto _ : state)
+    {
+        storyboard_add_note(board, note, nullptr);
+    }
+
+    note_destruct(note);
+    state.counters["notes"] = nr_notes;
+}
+
+//------------------------
+// --- C++ wrapper API ---
+//------------------------
+void cppSearchByTitle(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&       board = fixture<CppFixture>(nr_notes).board;
+    std::string title = queryTitle(nr_notes);
+
+    for (auto _ : state)
+    {
+        note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByTitle(title, result));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void cppSearchByText(benchmark::State& state, std::size_t nr_notes)
+{
+    auto& board = fixture<CppFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByText(QUERY_TEXT, result));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void cppSearchByTag(benchmark::State& state, std::size_t nr_notes, const char* tag)
+{
+    auto& board = fixture<CppFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        note_cont_t result;
+        benchmark::DoNotOptimize(board.searchByTag(tag, result));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void cppSearchByTagView(benchmark::State& state, std::size_t nr_notes)
+{
+    auto& board = fixture<CppFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+            board.searchByTag(QUERY_TAG, [](const NoteView& view) { benchmark::DoNotOptimize(view.getTitle()); }));
+    }
+
+    setScanCounters(state, nr_notes);
+}
+
+void cppCountByTag(benchmark::State& state, std::size_t nr_notes)
+{
+    auto& board = fixture<CppFixture>(nr_notes).board;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(board.countByTag(QUERY_TAG));
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+void cppDeleteNote(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&    board = fixture<CppFixture>(nr_notes).board;
+    NoteData data  = makeNote(nr_notes / 2);
+    Note     note(data.title, data.text, data.tags);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(board.deleteNote(note));
+
+        // Keep the size of the board constant
+        state.PauseTiming();
+        board.addNote(note);
+        state.ResumeTiming();
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+void cppAddNote(benchmark::State& state, std::size_t nr_notes)
+{
+    auto&    board = fixture<CppFixture>(nr_notes).board;
+    NoteData data  = makeNote(nr_notes);
+    Note     note(data.title, data.text, data.tags);
+
+    for (auto _ : state)
+    {
+        board.addNote(note);
+    }
+
+    state.counters["notes"] = nr_notes;
+}
+
+/**
+ * @brief Registers the benchmarks
+ * @details Benchmarks are registered size by size and API by API, so that each board is built only once. Adding notes
+ * grows the board, so it is measured last.
+ */
+void registerBenchmarks(std::size_t max_notes)
+{
+    benchmark::RegisterBenchmark("Core/ConstructNote", coreConstructNote)->ThreadRange(1, 8)->UseRealTime();
+
+    for (std::size_t nr_notes = 1000; nr_notes <= max_notes; nr_notes *= 10)
+    {
+        std::string suffix = "/" + std::to_string(nr_notes);
+
+        benchmark::RegisterBenchmark(("Core/SearchByTitle" + suffix).c_str(), coreSearchByTitle, nr_notes);
+        benchmark::RegisterBenchmark(("Core/SearchByText" + suffix).c_str(), coreSearchByText, nr_notes);
+        benchmark::RegisterBenchmark(("Core/SearchByTextCompressed" + suffix).c_str(), coreSearchByTextCompressed,
+                                     nr_notes);
+        benchmark::RegisterBenchmark(("Core/SearchByTextSpilled" + suffix).c_str(), coreSearchByTextSpilled,
+                                     nr_notes);
+        benchmark::RegisterBenchmark(("Core/SearchByTag" + suffix).c_str(), coreSearchByTag, nr_notes, QUERY_TAG);
+        benchmark::RegisterBenchmark(("Core/SearchByRareTag" + suffix).c_str(), coreSearchByTag, nr_notes,
+                                     QUERY_RARE_TAG);
+        benchmark::RegisterBenchmark(("Core/SearchByTitleFiltered" + suffix).c_str(), coreSearchByTitleFiltered,
+                                     nr_notes);
+        benchmark::RegisterBenchmark(("Core/SearchByTagFiltered" + suffix).c_str(), coreSearchByTagFiltered,
+                                     nr_notes, QUERY_TAG);
+        benchmark::RegisterBenchmark(("Core/SearchByRareTagFiltered" + suffix).c_str(), coreSearchByTagFiltered,
+                                     nr_notes, QUERY_RARE_TAG);
+        benchmark::RegisterBenchmark(("Core/SearchComposed" + suffix).c_str(), coreSearchComposed, nr_notes);
+        benchmark::RegisterBenchmark(("Core/SearchByTagsAny" + suffix).c_str(), coreSearchByTags, nr_notes,
+                                     storyboard::TagMatch::Any);
+        benchmark::RegisterBenchmark(("Core/SearchByTagsAll" + suffix).c_str(), coreSearchByTags, nr_notes,
+                                     storyboard::TagMatch::All);
+        benchmark::RegisterBenchmark(("Core/SearchByTagsAnyCached" + suffix).c_str(), coreSearchByTagsCached,
+                                     nr_notes, storyboard::TagMatch::Any);
+        benchmark::RegisterBenchmark(("Core/SearchByTagsAllCached" + suffix).c_str(), coreSearchByTagsCached,
+                                     nr_notes, storyboard::TagMatch::All);
+        benchmark::RegisterBenchmark(("Core/CountByTag" + suffix).c_str(), coreCountByTag, nr_notes);
+        benchmark::RegisterBenchmark(("Core/CountByTagsAny" + suffix).c_str(), coreCountByTags, nr_notes,
+                                     storyboard::TagMatch::Any);
+        benchmark::RegisterBenchmark(("Core/CountByTagsAll" + suffix).c_str(), coreCountByTags, nr_notes,
+                                     storyboard::TagMatch::All);
+        benchmark::RegisterBenchmark(("Core/DeleteNote" + suffix).c_str(), coreDeleteNote, nr_notes);
+        benchmark::RegisterBenchmark(("Core/AddNote" + suffix).c_str(), coreAddNote, nr_notes);
+        benchmark::RegisterBenchmark(("Core/AddDuplicate" + suffix).c_str(), coreAddDuplicate, nr_notes);
+        benchmark::RegisterBenchmark(("Core/MergeDuplicates" + suffix).c_str(), coreMergeDuplicates, nr_notes);
+        benchmark::RegisterBenchmark(("Core/Diff" + suffix).c_str(), coreDiff, nr_notes);
+
+        benchmark::RegisterBenchmark(("CAPI/SearchByTitle" + suffix).c_str(), cSearchByTitle, nr_notes);
+        benchmark::RegisterBenchmark(("CAPI/SearchByTitleN" + suffix).c_str(), cSearchByTitleN, nr_notes);
+        benchmark::RegisterBenchmark(("CAPI/SearchByText" + suffix).c_str(), cSearchByText, nr_notes);
+        benchmark::RegisterBenchmark(("CAPI/SearchByTag" + suffix).c_str(), cSearchByTag, nr_notes, QUERY_TAG);
+        benchmark::RegisterBenchmark(("CAPI/SearchByRareTag" + suffix).c_str(), cSearchByTag, nr_notes,
+                                     QUERY_RARE_TAG);
+        benchmark::RegisterBenchmark(("CAPI/CountByTag" + suffix).c_str(), cCountByTag, nr_notes);
+        benchmark::RegisterBenchmark(("CAPI/DeleteNote" + suffix).c_str(), cDeleteNote, nr_notes);
+        benchmark::RegisterBenchmark(("CAPI/AddNote" + suffix).c_str(), cAddNote, nr_notes);
+
+        benchmark::RegisterBenchmark(("CppAPI/SearchByTitle" + suffix).c_str(), cppSearchByTitle, nr_notes);
+        benchmark::RegisterBenchmark(("CppAPI/SearchByText" + suffix).c_str(), cppSearchByText, nr_notes);
+        benchmark::RegisterBenchmark(("CppAPI/SearchByTag" + suffix).c_str(), cppSearchByTag, nr_notes, QUERY_TAG);
+        benchmark::RegisterBenchmark(("CppAPI/SearchByRareTag" + suffix).c_str(), cppSearchByTag, nr_notes,
+                                     QUERY_RARE_TAG);
+        benchmark::RegisterBenchmark(("CppAPI/SearchByTagView" + suffix).c_str(), cppSearchByTagView, nr_notes);
+        benchmark::RegisterBenchmark(("CppAPI/CountByTag" + suffix).c_str(), cppCountByTag, nr_notes);
+        benchmark::RegisterBenchmark(("CppAPI/DeleteNote" + suffix).c_str(), cppDeleteNote, nr_notes);
+        benchmark::RegisterBenchmark(("CppAPI/AddNote" + suffix).c_str(), cppAddNote, nr_notes);
+    }
+}
+
+}  // namespace
+
+/**
+ * @brief Runs the benchmarks
+ * @details In addition to the Google Benchmark flags, accepts --max_notes=N which limits the size of the largest board
+ * (default 10000000).
+ */
+int main(int argc, char* argv[])
+{
+    std::size_t max_notes = 10000000;
+
+    // Remove our own flag before Google Benchmark parses the rest
+    const char* flag = "--max_notes=";
+    int         kept = 1;
+    for (int index = 1; index < argc; index++)
+    {
+        if (std::strncmp(argv[index], flag, std::strlen(flag)) == 0)
+        {
+            max_notes = std::strtoull(argv[index] + std::strlen(flag), nullptr, 10);
+        }
+        else
+        {
+            argv[kept++] = argv[index];
+        }
+    }
+    argc = kept;
+
+    registerBenchmarks(max_notes);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
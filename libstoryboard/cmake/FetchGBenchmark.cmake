@@ -0,0 +1,13 @@
+include(FetchContent)
+
+# Only the library is needed, not Google Benchmark's own tests
+set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "Build Google Benchmark tests")
+set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "Install Google Benchmark")
+
+# An installed Google Benchmark is used if one is found, otherwise it is fetched
+FetchContent_Declare(benchmark
+                     GIT_REPOSITORY https://github.com/google/benchmark.git
+                     GIT_TAG        v1.8.3
+                     FIND_PACKAGE_ARGS NAMES benchmark CONFIG)
+
+FetchContent_MakeAvailable(benchmark)
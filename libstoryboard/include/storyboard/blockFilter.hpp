@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace storyboard {
+
+/**
+ * @class BlockFilter
+ * @brief Bloom filters over fixed-size blocks of consecutive notes
+ * @details Each full block of notes gets a Bloom filter over the keys of its notes, i.e. their titles. A query that can
+ * only match notes carrying one of a few keys skips the blocks whose filter rules out all of them. The filters never
+ * give false negatives; the false-positive rate, and with it the memory used per key, is configurable. The notes after
+ * the last full block are always scanned.
+ */
+class BlockFilter
+{
+public:
+    using key_cont_t = std::vector<std::uint64_t>;
+
+    /**
+     * @brief Key of a title
+     */
+    static std::uint64_t titleKey(const char* data, std::size_t size);
+
+    /**
+     * @brief Enables or disables the filters and drops the existing ones
+     * @param[in] block_size : number of notes per block, 0 disables the filters
+     * @param[in] false_positive_rate : target rate of blocks that are scanned without containing a key, in (0, 1)
+     */
+    void configure(std::size_t block_size, double false_positive_rate);
+
+    /**
+     * @brief Number of notes per block, 0 when the filters are disabled
+     */
+    std::size_t blockSize() const
+    {
+        return m_blockSize;
+    }
+
+    /**
+     * @brief Target false-positive rate of the filters
+     */
+    double falsePositiveRate() const
+    {
+        return m_falsePositiveRate;
+    }
+
+    /**
+     * @brief Number of blocks that have a filter
+     */
+    std::size_t nrBlocks() const
+    {
+        return m_blocks.size();
+    }
+
+    /**
+     * @brief Drops the filters of the blocks from the given one on, e.g. because their notes have moved
+     */
+    void truncate(std::size_t nr_blocks);
+
+    /**
+     * @brief Adds the filter of the next block
+     * @param[in] keys : keys of the notes of the block
+     */
+    void addBlock(const key_cont_t& keys);
+
+    /**
+     * @brief Returns false if no note of the block carries any of the keys
+     */
+    bool mayContainAny(std::size_t block, const key_cont_t& keys) const;
+
+    /**
+     * @brief Memory used by the filters
+     */
+    std::size_t bytes() const;
+
+private:
+    struct Block
+    {
+        std::size_t   offset;     /// First word of the filter in m_bits
+        std::uint32_t nr_words;   /// Size of the filter in 64-bit words
+        std::uint32_t nr_hashes;  /// Number of bits set per key
+    };
+
+    std::size_t                m_blockSize         = 0;  /// Notes per block, 0 when disabled
+    double                     m_falsePositiveRate = 0;  /// Target false-positive rate
+    double                     m_bitsPerKey        = 0;  /// Filter size needed for the false-positive rate
+    std::vector<Block>         m_blocks;                 /// Filters of the full blocks, in note order
+    std::vector<std::uint64_t> m_bits;                   /// Bits of all the filters, back to back
+};
+
+}  // End of namespace storyboard
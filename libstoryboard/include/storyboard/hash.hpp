@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace storyboard {
+
+/**
+ * @brief 64-bit hash of a byte string
+ * @details Reads the input 8 bytes at a time, in four independent lanes for inputs of 32 bytes or more, so that long
+ * texts hash at several bytes per cycle. The hash depends on the byte order of the platform, so it is meant for
+ * in-memory use only.
+ * @param[in] data : bytes to hash
+ * @param[in] size : number of bytes
+ * @param[in] seed : chains hashes, e.g. the hash of the previous field of a record
+ */
+std::uint64_t hashBytes(const char* data, std::size_t size, std::uint64_t seed = 0);
+
+}  // End of namespace storyboard
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+namespace storyboard {
+
+/**
+ * @brief Building blocks for queries that are composed at compile time
+ * @details Each predicate is a small value type with an inline call operator, and the operators &&, || and ! combine
+ * predicates into new types. A composed predicate passed to Storyboard::search() is therefore inlined into a single
+ * scan loop, without std::function or virtual calls. The predicates refer to the strings they are given, so the
+ * strings must outlive the predicate. Any note type with getTitle(), getText() and getTags() can be matched.
+ *
+ * @code
+ * using namespace storyboard::query;
+ * board.search(hasTag("urgent") && !textContains("done"), [](const Note& note) { ... });
+ * @endcode
+ */
+namespace query {
+
+/**
+ * @class Key
+ * @brief A non-owning reference to the string a predicate matches against
+ */
+class Key
+{
+public:
+    /**
+     * @brief Constructor from a string literal, usable in constant expressions
+     */
+    template <std::size_t N>
+    constexpr Key(const char (&str)[N]) : m_data(str), m_size(N - 1)
+    {
+    }
+
+    /**
+     * @brief Constructor from a std::string. The string must outlive the key.
+     */
+    Key(const std::string& str) : m_data(str.data()), m_size(str.size())
+    {
+    }
+
+    /**
+     * @brief Constructor from a pointer and a length. The characters must outlive the key and may include NULs.
+     */
+    constexpr Key(const char* data, std::size_t size) : m_data(data), m_size(size)
+    {
+    }
+
+    // A temporary string would be gone before the key is used
+    Key(std::string&&) = delete;
+
+    constexpr const char* data() const
+    {
+        return m_data;
+    }
+
+    constexpr std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool equals(const std::string& str) const
+    {
+        return (str.size() == m_size) && (str.compare(0, m_size, m_data, m_size) == 0);
+    }
+
+private:
+    const char* m_data;  /// First character
+    std::size_t m_size;  /// Number of characters
+};
+
+// Notes that lend their text, such as storyboard::Note, are matched without copying the text
+template <typename N, typename Fn>
+auto withText(const N& note, Fn&& fn, int) -> decltype(note.withText(fn))
+{
+    return note.withText(fn);
+}
+
+template <typename N, typename Fn>
+auto withText(const N& note, Fn&& fn, long) -> decltype(fn(note.getText()))
+{
+    return fn(note.getText());
+}
+
+/**
+ * @brief Base of all the predicates, used to restrict the operators to predicate types
+ */
+template <typename Derived>
+struct Predicate
+{
+};
+
+template <typename T>
+using is_predicate = std::is_base_of<Predicate<typename std::decay<T>::type>, typename std::decay<T>::type>;
+
+/**
+ * @brief Matches notes whose title is equal to the key
+ */
+struct TitleEquals : Predicate<TitleEquals>
+{
+    constexpr explicit TitleEquals(Key key) : m_key(key)
+    {
+    }
+
+    template <typename N>
+    bool operator()(const N& note) const
+    {
+        return m_key.equals(note.getTitle());
+    }
+
+    Key m_key;
+};
+
+/**
+ * @brief Matches notes whose text contains the key
+ */
+struct TextContains : Predicate<TextContains>
+{
+    constexpr explicit TextContains(Key key) : m_key(key)
+    {
+    }
+
+    template <typename N>
+    bool operator()(const N& note) const
+    {
+        auto contains = [this](const std::string& text) {
+            return text.find(m_key.data(), 0, m_key.size()) != std::string::npos;
+        };
+
+        return withText(note, contains, 0);
+    }
+
+    Key m_key;
+};
+
+/**
+ * @brief Matches notes that carry a tag equal to the key
+ */
+struct HasTag : Predicate<HasTag>
+{
+    constexpr explicit HasTag(Key key) : m_key(key)
+    {
+    }
+
+    template <typename N>
+    bool operator()(const N& note) const
+    {
+        const auto& tags = note.getTags();
+        return std::any_of(tags.begin(), tags.end(), [this](const std::string& tag) { return m_key.equals(tag); });
+    }
+
+    Key m_key;
+};
+
+/**
+ * @brief Matches the notes that match both predicates. The right one is only evaluated if the left one matches.
+ */
+template <typename L, typename R>
+struct And : Predicate<And<L, R>>
+{
+    constexpr And(L lhs, R rhs) : m_lhs(lhs), m_rhs(rhs)
+    {
+    }
+
+    template <typename N>
+    bool operator()(const N& note) const
+    {
+        return m_lhs(note) && m_rhs(note);
+    }
+
+    L m_lhs;
+    R m_rhs;
+};
+
+/**
+ * @brief Matches the notes that match either predicate. The right one is only evaluated if the left one does not match.
+ */
+template <typename L, typename R>
+struct Or : Predicate<Or<L, R>>
+{
+    constexpr Or(L lhs, R rhs) : m_lhs(lhs), m_rhs(rhs)
+    {
+    }
+
+    template <typename N>
+    bool operator()(const N& note) const
+    {
+        return m_lhs(note) || m_rhs(note);
+    }
+
+    L m_lhs;
+    R m_rhs;
+};
+
+/**
+ * @brief Matches the notes that do not match the predicate
+ */
+template <typename P>
+struct Not : Predicate<Not<P>>
+{
+    constexpr explicit Not(P predicate) : m_predicate(predicate)
+    {
+    }
+
+    template <typename N>
+    bool operator()(const N& note) const
+    {
+        return !m_predicate(note);
+    }
+
+    P m_predicate;
+};
+
+/**
+ * @brief Matches all the notes
+ */
+struct Any : Predicate<Any>
+{
+    template <typename N>
+    constexpr bool operator()(const N&) const
+    {
+        return true;
+    }
+};
+
+constexpr TitleEquals titleEquals(Key key)
+{
+    return TitleEquals(key);
+}
+
+constexpr TextContains textContains(Key key)
+{
+    return TextContains(key);
+}
+
+constexpr HasTag hasTag(Key key)
+{
+    return HasTag(key);
+}
+
+constexpr Any any()
+{
+    return Any();
+}
+
+template <typename L, typename R, typename = std::enable_if_t<is_predicate<L>::value && is_predicate<R>::value>>
+constexpr And<std::decay_t<L>, std::decay_t<R>> operator&&(L&& lhs, R&& rhs)
+{
+    return And<std::decay_t<L>, std::decay_t<R>>(lhs, rhs);
+}
+
+template <typename L, typename R, typename = std::enable_if_t<is_predicate<L>::value && is_predicate<R>::value>>
+constexpr Or<std::decay_t<L>, std::decay_t<R>> operator||(L&& lhs, R&& rhs)
+{
+    return Or<std::decay_t<L>, std::decay_t<R>>(lhs, rhs);
+}
+
+template <typename P, typename = std::enable_if_t<is_predicate<P>::value>>
+constexpr Not<std::decay_t<P>> operator!(P&& predicate)
+{
+    return Not<std::decay_t<P>>(predicate);
+}
+
+}  // End of namespace query
+
+}  // End of namespace storyboard
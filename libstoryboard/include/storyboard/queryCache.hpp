@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <storyboard/query.hpp>
+
+namespace storyboard {
+
+/**
+ * @brief Kinds of queries supported by the Storyboard
+ */
+enum class QueryKind : char
+{
+    Title   = 'T',
+    Text    = 'X',
+    Tag     = 'G',
+    AllTags = 'A'
+};
+
+/**
+ * @brief Statistics of a QueryCache
+ */
+struct QueryCacheStats
+{
+    std::uint64_t hits      = 0;  /// Lookups that were served from the cache
+    std::uint64_t misses    = 0;  /// Lookups that were not found, or were found but stale
+    std::uint64_t evictions = 0;  /// Entries dropped because the cache was full
+    std::size_t   entries   = 0;  /// Number of entries currently stored
+    std::size_t   capacity  = 0;  /// Maximum number of entries, 0 means that the cache is disabled
+    std::size_t   bytes     = 0;  /// Approximate memory used by the stored entries
+};
+
+/**
+ * @class QueryCache
+ * @brief A size-bounded LRU cache of query results.
+ * @details Results are stored as indexes into the note container of the owning Storyboard. Each entry is tagged with
+ * the generation of the board at the time the result was computed, and an entry is only served if the generation
+ * still matches. All the functions are thread safe, so concurrent readers of a Storyboard can share the cache.
+ */
+class QueryCache
+{
+public:
+    using index_cont_t = std::vector<std::size_t>;
+
+    /**
+     * @brief Constructor
+     * @param[in] capacity : maximum number of cached results, 0 disables the cache
+     */
+    explicit QueryCache(std::size_t capacity = 0) : m_capacity(capacity)
+    {
+    }
+
+    /**
+     * @brief Copy constructor. Only the capacity is copied, the copy starts empty.
+     */
+    QueryCache(const QueryCache& other);
+
+    /**
+     * @brief Copy assignment. Only the capacity is copied, the entries are dropped.
+     */
+    QueryCache& operator=(const QueryCache& other);
+
+    /**
+     * @brief Changes the maximum number of cached results. Least recently used entries are evicted if needed.
+     * @param[in] capacity : maximum number of cached results, 0 disables the cache
+     */
+    void setCapacity(std::size_t capacity);
+
+    /**
+     * @brief Returns the maximum number of cached results
+     */
+    std::size_t capacity() const
+    {
+        return m_capacity.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Looks up a cached result
+     * @param[in] kind : kind of the query
+     * @param[in] key : query key
+     * @param[in] generation : current generation of the board
+     * @param[in,out] indexes : indexes of the matching notes are added into this container on a hit
+     * @return true if a result that matches the generation was found, otherwise false
+     */
+    bool find(QueryKind kind, query::Key key, std::uint64_t generation, index_cont_t& indexes);
+
+    /**
+     * @brief Looks up the number of results of a cached query
+     * @param[in] kind : kind of the query
+     * @param[in] key : query key
+     * @param[in] generation : current generation of the board
+     * @param[out] count : number of matching notes on a hit
+     * @return true if a result that matches the generation was found, otherwise false
+     */
+    bool count(QueryKind kind, query::Key key, std::uint64_t generation, std::size_t& count);
+
+    /**
+     * @brief Stores a result, replacing any previous result for the same query
+     * @param[in] kind : kind of the query
+     * @param[in] key : query key
+     * @param[in] generation : generation of the board the result was computed for
+     * @param[in] indexes : indexes of the matching notes
+     */
+    void insert(QueryKind kind, query::Key key, std::uint64_t generation, index_cont_t indexes);
+
+    /**
+     * @brief Removes all the entries. Statistics are kept.
+     */
+    void clear();
+
+    /**
+     * @brief Returns the statistics of the cache
+     */
+    QueryCacheStats stats() const;
+
+private:
+    struct Entry
+    {
+        std::string   key;
+        std::uint64_t generation;
+        index_cont_t  indexes;
+    };
+
+    using entry_cont_t = std::list<Entry>;
+
+    static std::string makeKey(QueryKind kind, query::Key key);
+    static std::size_t entryBytes(const Entry& entry);
+
+    entry_cont_t::iterator lookup(QueryKind kind, query::Key key, std::uint64_t generation);
+    void                   erase(entry_cont_t::iterator it);
+    void                   clearEntries();
+    void                   evictToCapacity();
+
+    std::atomic<std::size_t>                                m_capacity;       /// Maximum number of entries
+    mutable std::mutex                                      m_mutex;          /// Protects the members below
+    entry_cont_t                                            m_entries;        /// Entries, most recently used first
+    std::unordered_map<std::string, entry_cont_t::iterator> m_lookup;         /// Key to entry
+    std::size_t                                             m_bytes     = 0;  /// Approximate memory of the entries
+    std::uint64_t                                           m_hits      = 0;  /// Number of hits
+    std::uint64_t                                           m_misses    = 0;  /// Number of misses
+    std::uint64_t                                           m_evictions = 0;  /// Number of evictions
+};
+
+}  // End of namespace storyboard
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace storyboard {
+
+/**
+ * @class RoaringBitmap
+ * @brief A compressed set of 32-bit integers, after the Roaring bitmap format
+ * @details The values are split by their upper 16 bits into containers of up to 65536 values. Each container uses
+ * whichever representation is smallest for its contents:
+ * - an array: the sorted lower 16 bits of the values, for sparse containers
+ * - a bitmap: 65536 bits, for dense containers. Unions, intersections and counts work on 64 bits at a time.
+ * - runs: (start, length) pairs, for containers made of long ranges of consecutive values
+ *
+ * Adding values in increasing order appends to the last container, so building a bitmap is linear.
+ */
+class RoaringBitmap
+{
+public:
+    /**
+     * @brief Adds a value
+     * @return true if the value was not in the set
+     */
+    bool add(std::uint32_t value);
+
+    /**
+     * @brief Removes a value
+     * @return true if the value was in the set
+     */
+    bool remove(std::uint32_t value);
+
+    bool contains(std::uint32_t value) const;
+
+    /**
+     * @brief Number of values in the set
+     */
+    std::size_t cardinality() const
+    {
+        return m_cardinality;
+    }
+
+    bool empty() const
+    {
+        return m_cardinality == 0;
+    }
+
+    /**
+     * @brief Calls fn with each value, in increasing order
+     */
+    template <typename Fn>
+    void forEach(Fn&& fn) const;
+
+    /**
+     * @brief Adds the values of another set
+     */
+    RoaringBitmap& operator|=(const RoaringBitmap& other);
+
+    /**
+     * @brief Keeps only the values that are also in another set
+     */
+    RoaringBitmap& operator&=(const RoaringBitmap& other);
+
+    /**
+     * @brief Number of values that are in both sets, without building the intersection
+     */
+    static std::size_t andCardinality(const RoaringBitmap& lhs, const RoaringBitmap& rhs);
+
+    /**
+     * @brief Memory used by the containers, counted by their sizes so that a copy uses as much
+     * @details Maintained as values are added and removed, so the cost does not depend on the number of containers.
+     */
+    std::size_t bytes() const
+    {
+        return m_bytes;
+    }
+
+private:
+    /**
+     * @brief A range of consecutive values in a run container
+     */
+    struct Run
+    {
+        std::uint16_t start;   /// First value
+        std::uint16_t length;  /// Number of values after the first one
+    };
+
+    /**
+     * @brief The values of the set that share their upper 16 bits
+     */
+    struct Container
+    {
+        enum class Type : std::uint8_t
+        {
+            Array,
+            Bitmap,
+            Run
+        };
+
+        static const std::uint32_t MAX_ARRAY_SIZE = 4096;  /// Beyond this, a bitmap is smaller than an array
+        static const std::uint32_t NR_WORDS       = 1024;  /// Words of a bitmap container
+
+        bool add(std::uint16_t value);
+        bool remove(std::uint16_t value);
+        bool contains(std::uint16_t value) const;
+
+        /**
+         * @brief ORs the values into a bitmap of NR_WORDS words
+         */
+        void fillWords(std::uint64_t* words) const;
+
+        /**
+         * @brief Switches to the smallest representation for the current values
+         */
+        void optimize();
+
+        template <typename Fn>
+        void forEach(std::uint32_t high, Fn&& fn) const;
+
+        std::size_t bytes() const;
+
+        static Container   orOf(const Container& lhs, const Container& rhs);
+        static Container   andOf(const Container& lhs, const Container& rhs);
+        static std::size_t andCardinality(const Container& lhs, const Container& rhs);
+
+        Type                       type        = Type::Array;  /// Representation of the values
+        std::uint32_t              cardinality = 0;            /// Number of values
+        std::vector<std::uint16_t> values;                     /// Sorted values of an array container
+        std::vector<std::uint64_t> words;                      /// Bits of a bitmap container
+        std::vector<Run>           runs;                       /// Sorted runs of a run container
+    };
+
+    static unsigned trailingZeros(std::uint64_t word)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return index;
+#else
+        return __builtin_ctzll(word);
+#endif
+    }
+
+    static unsigned popCount(std::uint64_t word)
+    {
+#if defined(_MSC_VER)
+        return static_cast<unsigned>(__popcnt64(word));
+#else
+        return __builtin_popcountll(word);
+#endif
+    }
+
+    /**
+     * @brief Returns the container for the given upper 16 bits, creating it if needed
+     */
+    Container& containerFor(std::uint16_t key);
+
+    /**
+     * @brief Memory used by the key and container arrays, without the contents of the containers
+     */
+    std::size_t arrayBytes() const;
+
+    /**
+     * @brief Sums the memory used by all the containers into m_bytes, after the containers were rebuilt
+     */
+    void updateBytes();
+
+    std::vector<std::uint16_t> m_keys;             /// Upper 16 bits of the values of each container, sorted
+    std::vector<Container>     m_containers;       /// Containers, in the order of m_keys
+    std::size_t                m_cardinality = 0;  /// Number of values
+    std::size_t                m_bytes       = 0;  /// See bytes()
+};
+
+template <typename Fn>
+void RoaringBitmap::Container::forEach(std::uint32_t high, Fn&& fn) const
+{
+    switch (type)
+    {
+        case Type::Array:
+            for (auto value : values)
+            {
+                fn(high | value);
+            }
+            break;
+
+        case Type::Bitmap:
+            for (std::uint32_t index = 0; index < NR_WORDS; index++)
+            {
+                for (std::uint64_t word = words[index]; word != 0; word &= word - 1)
+                {
+                    fn(high | (index * 64 + trailingZeros(word)));
+                }
+            }
+            break;
+
+        case Type::Run:
+            for (auto& run : runs)
+            {
+                for (std::uint32_t value = run.start; value <= std::uint32_t(run.start) + run.length; value++)
+                {
+                    fn(high | value);
+                }
+            }
+            break;
+    }
+}
+
+template <typename Fn>
+void RoaringBitmap::forEach(Fn&& fn) const
+{
+    for (std::size_t index = 0; index < m_containers.size(); index++)
+    {
+        m_containers[index].forEach(std::uint32_t(m_keys[index]) << 16, fn);
+    }
+}
+
+}  // End of namespace storyboard
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace storyboard {
+
+/**
+ * @class SegmentFile
+ * @brief An append-only file holding the text blocks that a Storyboard moved out of memory
+ * @details Bytes are only ever appended, so a range that has been written never changes. Appends and reads are
+ * serialized, since they share the position of the file, and go through the buffering of the C library. The file is
+ * removed when the object is destroyed, i.e. when the last block stored in it is released.
+ */
+class SegmentFile
+{
+public:
+    /**
+     * @brief Creates an empty segment file with a name of its own
+     * @param[in] directory : directory the file is created in, it must exist
+     * @throw std::runtime_error if the file cannot be created
+     */
+    static std::shared_ptr<SegmentFile> create(const std::string& directory);
+
+    ~SegmentFile();
+
+    SegmentFile(const SegmentFile&) = delete;
+    SegmentFile& operator=(const SegmentFile&) = delete;
+
+    /**
+     * @brief Appends bytes to the file
+     * @return offset of the bytes in the file
+     * @throw std::runtime_error if the bytes cannot be written
+     */
+    std::uint64_t append(const std::string& data);
+
+    /**
+     * @brief Reads bytes that were appended
+     * @param[in] offset : offset returned by append()
+     * @param[in] size : number of bytes
+     * @param[out] data : receives the bytes, its capacity is reused
+     * @throw std::runtime_error if the bytes cannot be read
+     */
+    void read(std::uint64_t offset, std::size_t size, std::string& data) const;
+
+    const std::string& directory() const
+    {
+        return m_directory;
+    }
+
+    /**
+     * @brief Bytes appended so far
+     */
+    std::uint64_t size() const;
+
+private:
+    SegmentFile(std::string directory, std::string path, std::FILE* file);
+
+    void seek(std::uint64_t offset) const;
+
+    std::string        m_directory;  /// Directory the file was created in
+    std::string        m_path;       /// Path of the file, removed by the destructor
+    std::FILE*         m_file;       /// Open for reading and writing
+    std::uint64_t      m_size = 0;   /// Bytes appended
+    mutable std::mutex m_mutex;      /// Serializes the appends and the reads
+};
+
+}  // End of namespace storyboard
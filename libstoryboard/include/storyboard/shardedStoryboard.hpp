@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include <storyboard/storyboard.hpp>
+
+namespace storyboard {
+
+/**
+ * @class ShardedStoryboard
+ * @brief A Storyboard split into independently locked shards
+ * @details Notes are assigned to shards by the hash of their title. Adds and deletes lock only the shards they touch,
+ * so writers working on different shards do not contend. Queries that can match notes in any shard run on all the
+ * shards in parallel and the results are merged. All the functions are thread safe.
+ */
+class ShardedStoryboard
+{
+public:
+    /**
+     * @brief Constructor
+     * @param[in] nr_shards : number of shards, at least 1
+     */
+    explicit ShardedStoryboard(std::size_t nr_shards = 1);
+
+    /**
+     * @brief Copy constructor. Each shard is copied while holding its read lock.
+     */
+    ShardedStoryboard(const ShardedStoryboard& other);
+
+    ShardedStoryboard& operator=(const ShardedStoryboard&) = delete;
+
+    /**
+     * @brief Number of shards
+     */
+    std::size_t nrShards() const;
+
+    /**
+     * @brief Adds a new note object into the shard of its title
+     * @return false if the note was rejected as a duplicate
+     */
+    bool addNote(const Note& newNote);
+
+    /**
+     * @brief Adds a batch of notes, moving them out of the given container. Each shard is locked once for its part
+     * of the batch.
+     * @return number of notes added
+     */
+    int addNotes(std::vector<Note>&& newNotes);
+
+    /**
+     * @brief Sets whether each shard rejects duplicate notes, see Storyboard::setRejectDuplicates
+     * @details Equal notes have equal titles, so they always meet in the same shard.
+     */
+    void setRejectDuplicates(bool reject);
+
+    /**
+     * @brief Appends copies of the notes of another board, see Storyboard::merge
+     * @details When both boards have the same number of shards, each shard is merged into its counterpart while holding
+     * the read lock of the source shard and the write lock of the destination shard. Otherwise the notes are collected
+     * shard by shard under the read locks, then added in one batch per destination shard.
+     * @param[in] source : board whose notes are copied, can be this one
+     * @param[in] policy : whether notes equal to a stored note are skipped
+     * @return number of notes appended
+     */
+    int merge(const ShardedStoryboard& source, MergePolicy policy);
+
+    /**
+     * @brief Reports the differences with another board, see Storyboard::diff
+     * @details Equal notes have equal titles, so each note of the other board is only paired within the shard of its
+     * title. The read locks of all the shards of both boards are held during the diff.
+     * @param[in] other : board compared with this one
+     * @param[in] added : called for each note of other that has no equal note here
+     * @param[in] removed : called for each note of this board that has no equal note in other
+     * @return number of notes reported
+     */
+    int diff(const ShardedStoryboard& other, const note_visitor_t& added, const note_visitor_t& removed) const;
+
+    /**
+     * @brief Removes the notes that are equal to deleteMe. Only the shard of the title is searched.
+     * @return number of elements that were deleted
+     */
+    int deleteNote(const Note& deleteMe);
+
+    /**
+     * @brief Removes all the notes whose title is the given string. Only the shard of the title is searched.
+     * @return number of elements that were deleted
+     */
+    int deleteByTitle(query::Key title);
+
+    /**
+     * @brief Removes all the notes that contain the given string in the text field
+     * @return number of elements that were deleted
+     */
+    int deleteByText(query::Key text);
+
+    /**
+     * @brief Removes all the notes that carry any of the given tags
+     * @return number of elements that were deleted
+     */
+    int deleteByTag(const tag_cont_t& tags);
+
+    /**
+     * @brief Sets how notes are deleted in all the shards
+     */
+    void setDeleteMode(DeleteMode mode);
+
+    /**
+     * @brief Number of deleted notes that have not been compacted yet
+     */
+    int nrTombstones() const;
+
+    /**
+     * @brief Compacts the shards one at a time. Each shard is copied while holding its read lock, and the write lock
+     * is taken only for swapping the compacted notes in.
+     * @return number of tombstones removed
+     */
+    int compact();
+
+    /**
+     * @brief Search functions. The visitor is called on the calling thread, shard by shard.
+     * @return number of search results
+     */
+    int searchByTitle(query::Key title, const note_visitor_t& visitor);
+    int searchByText(query::Key text, const note_visitor_t& visitor);
+    int searchByTag(const tag_cont_t& tags, const note_visitor_t& visitor, TagMatch match = TagMatch::Any);
+
+    /**
+     * @brief Count functions
+     * @return number of matching notes
+     */
+    int countByTitle(query::Key title);
+    int countByText(query::Key text);
+    int countByTag(const tag_cont_t& tags, TagMatch match = TagMatch::Any);
+
+    /**
+     * @brief Tag statistics and facets, merged over the shards
+     * @return number of distinct tags
+     */
+    int getTagStats(tag_stats_cont_t& container);
+    int facetsByTitle(query::Key title, tag_stats_cont_t& container);
+    int facetsByText(query::Key text, tag_stats_cont_t& container);
+    int facetsByTag(const tag_cont_t& tags, tag_stats_cont_t& container);
+
+    /**
+     * @brief Number of notes stored
+     */
+    int length() const;
+
+    /**
+     * @brief Sets the query cache capacity of each shard
+     */
+    void setQueryCacheCapacity(std::size_t capacity);
+
+    /**
+     * @brief Enables the block filters of each shard, see Storyboard::setBlockFilter
+     */
+    void setBlockFilter(std::size_t block_size, double false_positive_rate);
+
+    /**
+     * @brief Sets whether each shard stores its texts compressed, see Storyboard::setTextCompression
+     * @details Each shard trains its own dictionary. The shards are compressed in parallel.
+     */
+    void setTextCompression(bool enable);
+
+    /**
+     * @brief Sets a memory budget, split evenly between the shards, see Storyboard::setMemoryBudget
+     * @details Each shard spills to a segment file of its own in the directory.
+     */
+    void setMemoryBudget(std::size_t bytes, const std::string& directory);
+
+    /**
+     * @brief Query cache statistics, summed over the shards
+     */
+    QueryCacheStats queryCacheStats() const;
+
+    /**
+     * @brief Memory usage, summed over the shards
+     */
+    MemoryUsage memoryUsage() const;
+
+private:
+    using read_lock_t  = std::shared_lock<std::shared_timed_mutex>;
+    using write_lock_t = std::unique_lock<std::shared_timed_mutex>;
+
+    struct Shard
+    {
+        Storyboard                      board;  /// Notes of the shard
+        mutable std::shared_timed_mutex mutex;  /// Queries share the lock, modifications are exclusive
+    };
+
+    /**
+     * @brief Calls fn(shard) for each shard, in parallel when there is more than one shard. Notes scanned on the
+     * worker threads are added to the counter of the calling thread.
+     */
+    template <typename Fn>
+    void forEachShard(Fn&& fn) const;
+
+    /**
+     * @brief Runs a search on all the shards in parallel, then passes the results to the visitor on this thread
+     */
+    template <typename Search>
+    int runSearch(const note_visitor_t& visitor, Search&& search);
+
+    /**
+     * @brief Runs a tag statistics query on all the shards and merges the results
+     */
+    template <typename Query>
+    int runTagQuery(tag_stats_cont_t& container, Query&& query);
+
+    std::size_t shardIndex(query::Key title) const;
+    Shard&      shardOf(query::Key title);
+
+    int compactShard(Shard& shard);
+
+    std::vector<std::unique_ptr<Shard>> m_shards;  /// Shards, never empty
+};
+
+}  // End of namespace storyboard
@@ -1,15 +1,78 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <storyboard/blockFilter.hpp>
+#include <storyboard/query.hpp>
+#include <storyboard/queryCache.hpp>
+#include <storyboard/roaringBitmap.hpp>
+#include <storyboard/tagList.hpp>
+#include <storyboard/textBlock.hpp>
+
 namespace storyboard {
 
 class Storyboard;
 class Note;
 
-using tag_cont_t  = std::vector<std::string>;
-using note_cont_t = std::vector<Note>;
+using tag_cont_t       = std::vector<std::string>;
+using note_cont_t      = std::vector<Note>;
+using tag_stats_cont_t = std::vector<std::pair<std::string, int>>;
+using note_visitor_t   = std::function<void(const Note&)>;
+
+/**
+ * @brief Approximate memory used by a Storyboard, in bytes
+ * @details String payloads are counted by their length, i.e. the capacity reserved by the string implementation is not
+ * included.
+ */
+struct MemoryUsage
+{
+    std::size_t notes         = 0;  /// Note objects and the arrays holding their tags
+    std::size_t titles        = 0;  /// Title payloads
+    std::size_t texts         = 0;  /// Text payloads
+    std::size_t tags          = 0;  /// Distinct tags, i.e. their entries in the process-wide table of interned tags
+    std::size_t slack         = 0;  /// Unused capacity of the note container
+    std::size_t tag_index     = 0;  /// Per-tag postings
+    std::size_t content_index = 0;  /// Content hashes of the notes, used to find equal notes
+    std::size_t query_cache   = 0;  /// Cached query results
+    std::size_t tombstones    = 0;  /// Deleted notes that have not been compacted yet
+    std::size_t filters       = 0;  /// Per-block Bloom filters
+    std::size_t dictionary    = 0;  /// Dictionary of the compressed texts
+    std::size_t total         = 0;  /// Sum of the above
+    std::size_t spilled       = 0;  /// Texts moved to the segment file, on disk and not included in the total
+};
+
+/**
+ * @brief How a note has to carry the tags of a tag query to match it
+ */
+enum class TagMatch
+{
+    Any,  /// At least one of the tags
+    All   /// Every one of the tags
+};
+
+/**
+ * @brief How Storyboard::deleteNote removes notes
+ */
+enum class DeleteMode
+{
+    Erase,     /// Notes are erased from the container immediately
+    Tombstone  /// Notes are marked as deleted and skipped by queries until the Storyboard is compacted
+};
+
+/**
+ * @brief How Storyboard::merge treats the notes that are already stored
+ */
+enum class MergePolicy
+{
+    KeepAll,        /// All the notes are appended
+    SkipDuplicates  /// Notes equal to a stored note, or to a note appended before them, are skipped
+};
 
 /**
  * @class Note
@@ -31,8 +94,8 @@ public:
      * @param[in] text : Note's text
      * @param[in] tags : Note's tags
      */
-    Note(const std::string& title, const std::string& text, tag_cont_t const& tags)
-        : m_title(title), m_text(text), m_tags(tags)
+    Note(std::string title, std::string text, tag_cont_t const& tags)
+        : m_title(std::move(title)), m_text(std::move(text)), m_tags(tags)
     {
     }
 
@@ -43,26 +106,66 @@ public:
     {
     }
 
+    // Declared explicitly, since the destructor would otherwise suppress the moves that the Storyboard relies on
+    Note(const Note&)            = default;
+    Note(Note&&)                 = default;
+    Note& operator=(const Note&) = default;
+    Note& operator=(Note&&)      = default;
+
     /**
-     * @brief Returns a container with the note's tags
-     * @return std-container that contains the Note's tags
+     * @brief Returns the note's tags
+     * @return list of the note's tags, iterates over them as strings
      */
-    tag_cont_t& getTags();
+    const TagList& getTags() const;
 
     /**
      * @brief Returns Note's title
      * @return String containing the note's title
      */
-    std::string& getTitle();
+    std::string&       getTitle();
+    const std::string& getTitle() const;
 
     /**
      * @brief Returns Note's text
+     * @details The const overload returns a copy, since the text of a note that is stored compressed, or of a copy of
+     * such a note, is decompressed into a cache of the calling thread that later reads replace, see TextBlock::text().
+     * The other overload detaches the text first.
      * @return String containing the note's text
      */
     std::string& getText();
+    std::string  getText() const;
+
+    /**
+     * @brief Calls fn with the text of the note, without copying it
+     * @details The text of a note that is stored compressed stays valid until fn returns, see TextBlock::pin().
+     * @return what fn returns
+     */
+    template <typename Fn>
+    auto withText(Fn&& fn) const -> decltype(fn(std::declval<const std::string&>()))
+    {
+        if (m_textBlock)
+        {
+            std::shared_ptr<const std::string> text = m_textBlock->pin(m_textIndex);
+            return fn(*text);
+        }
+
+        return fn(m_text);
+    }
+
+    /**
+     * @brief Makes the note hold its own copy of its text, if the text is stored compressed
+     */
+    void detachText();
+
+    /**
+     * @brief Returns the hash of the title, text and tags, computed when the note is added to a Storyboard
+     * @return content hash, 0 for notes that have not been stored
+     */
+    std::uint64_t getContentHash() const;
 
     /**
      * @brief operator==
+     * @details Notes that have both been stored are told apart by their content hashes first.
      * @param[in] other : Compared object
      * @return true if contents of this object are the same as those of the input object, otherwise return false
      */
@@ -71,9 +174,26 @@ public:
     friend class Storyboard;
 
 protected:
-    std::string m_title;  /// Title of the note-object
-    std::string m_text;   /// Text of the note-object
-    tag_cont_t  m_tags;   /// Tag(s) of the note-object
+    std::string   m_title;              /// Title of the note-object
+    std::string   m_text;               /// Text of the note-object
+    TagList       m_tags;               /// Tag(s) of the note-object, interned
+    std::uint64_t m_hash      = 0;      /// Content hash, set by the Storyboard
+    bool          m_tombstone = false;  /// Set by the Storyboard for deleted notes that await compaction
+    std::uint32_t m_id        = 0;      /// Set by the Storyboard, increases with the position of the note
+    std::uint32_t m_textIndex = 0;      /// Position of the text in m_textBlock
+
+    std::shared_ptr<const TextBlock> m_textBlock;  /// Compressed text, if the Storyboard compresses the texts
+};
+
+/**
+ * @brief A compacted copy of the notes of a Storyboard, see Storyboard::prepareCompaction()
+ */
+struct Compaction
+{
+    std::uint64_t generation   = 0;  /// Generation of the Storyboard the copy was made from
+    int           nr_reclaimed = 0;  /// Number of tombstones left out of the copy
+    note_cont_t   notes;             /// Notes that are not tombstones
+    BlockFilter   filter;            /// Block filters of the copy, if the Storyboard has them enabled
 };
 
 /**
@@ -86,32 +206,156 @@ class Storyboard
 public:
     /**
      * @brief Adds a new note object into the Storyboard
+     * @details The tags of the stored note are sorted and deduplicated.
      * @param[in] : newNote note to be added into the Storyboard
+     * @return false if the note was rejected as a duplicate, see setRejectDuplicates()
      */
-    void addNote(const Note& newNote);
+    bool addNote(const Note& newNote);
 
     /**
      * @brief Adds a new note object into the Storyboard. Uses move semantics (i.e. steals the resources from the given
      * object)
      * @param[in] : newNote note to be added into the Storyboard
+     * @return false if the note was rejected as a duplicate, see setRejectDuplicates()
      */
-    void addNote(Note&& newNote);
+    bool addNote(Note&& newNote);
+
+    /**
+     * @brief Adds a batch of notes into the Storyboard, moving them out of the given container. The storage is grown
+     * once and the cached query results are invalidated once for the whole batch.
+     * @param[in] : newNotes notes to be added into the Storyboard
+     * @return number of notes added, the others were rejected as duplicates
+     */
+    int addNotes(std::vector<Note>&& newNotes);
+
+    /**
+     * @brief Adds a batch of notes like addNotes, optionally skipping the duplicates
+     * @param[in] : newNotes notes to be added into the Storyboard
+     * @param[in] policy : MergePolicy::SkipDuplicates skips the notes equal to a stored note
+     * @return number of notes added
+     */
+    int addNotes(std::vector<Note>&& newNotes, MergePolicy policy);
+
+    /**
+     * @brief Appends copies of the notes of another Storyboard, in their order
+     * @details The content hashes of the other notes are reused, and duplicates are found through them, so the merge
+     * runs in time linear in the number of notes appended. Duplicates are also skipped if this Storyboard rejects them.
+     * @param[in] other : Storyboard whose notes are copied, can be this one
+     * @param[in] policy : whether notes equal to a stored note are skipped
+     * @return number of notes appended
+     */
+    int merge(const Storyboard& other, MergePolicy policy);
+
+    /**
+     * @brief Reports the notes that would have to be added to and removed from this Storyboard to make it equal to
+     * another one
+     * @details Notes are compared as a multiset: each note of the other Storyboard is paired with an equal note of
+     * this one through the content hashes, in expected linear time. The unpaired notes of the other Storyboard are
+     * added, the unpaired notes of this one are removed.
+     * @param[in] other : Storyboard compared with this one
+     * @param[in] added : called for each note of other that has no equal note here
+     * @param[in] removed : called for each note of this Storyboard that has no equal note in other
+     * @return number of notes reported
+     */
+    int diff(const Storyboard& other, const note_visitor_t& added, const note_visitor_t& removed) const;
+
+    /**
+     * @brief Pairs a note of another Storyboard with an equal note of this one, see diff()
+     * @param[in] note : note stored in a Storyboard, i.e. normalized and hashed
+     * @param[in,out] claimed : ids of the notes of this Storyboard that are already paired, receives the id of the
+     * paired note
+     * @return false if every equal note is already paired
+     */
+    bool claimEqual(const Note& note, RoaringBitmap& claimed) const;
+
+    /**
+     * @brief Calls the visitor for each note whose id is not in claimed, see claimEqual()
+     * @return number of notes visited
+     */
+    int visitUnclaimed(const RoaringBitmap& claimed, const note_visitor_t& visitor) const;
+
+    /**
+     * @brief Sets whether notes equal to a note that is already stored are rejected by addNote and addNotes
+     * @details Equal notes are found through the content hashes, so the check costs about one hash lookup per note.
+     * Duplicates are accepted by default.
+     */
+    void setRejectDuplicates(bool reject);
 
     /**
      * @brief Removes a note from the Storyboard
+     * @details The equal notes are found through the content hashes, without scanning the notes.
      * @param[in] deleteMe : Sample of a Note object to be deleted from the Storyboard. Note objects that are equal to
      * deleteMe will be deleted.
      * @return number of elements that were deleted
      */
     int deleteNote(const Note& deleteMe);
 
+    /**
+     * @brief Removes, in one pass, all the notes whose title is the given string
+     * @param[in] title : string that is matched
+     * @return number of notes that were deleted
+     */
+    int deleteByTitle(query::Key title);
+
+    /**
+     * @brief Removes, in one pass, all the notes that contain the given string in the text field
+     * @param[in] text : string that is matched
+     * @return number of notes that were deleted
+     */
+    int deleteByText(query::Key text);
+
+    /**
+     * @brief Removes, in one pass, all the notes that carry any of the given tags
+     * @param[in] tags : a vector of tags that are matched
+     * @return number of notes that were deleted
+     */
+    int deleteByTag(const tag_cont_t& tags);
+
+    /**
+     * @brief Sets how deleteNote removes notes. In DeleteMode::Tombstone, deleted notes keep their memory until the
+     * Storyboard is compacted.
+     * @param[in] mode : delete mode
+     */
+    void setDeleteMode(DeleteMode mode);
+
+    /**
+     * @brief Returns how deleteNote removes notes
+     */
+    DeleteMode deleteMode() const;
+
+    /**
+     * @brief Number of deleted notes that have not been compacted yet
+     */
+    int nrTombstones() const;
+
+    /**
+     * @brief Removes the tombstones and releases the unused capacity of the note container
+     * @return number of tombstones removed
+     */
+    int compact();
+
+    /**
+     * @brief First phase of a compaction that does not modify the Storyboard: copies the notes that are not tombstones
+     * @details Only reads the Storyboard, so it can run while other threads are searching it.
+     * @param[out] compaction : receives the compacted copy of the notes
+     */
+    void prepareCompaction(Compaction& compaction) const;
+
+    /**
+     * @brief Second phase of a compaction: replaces the notes with the compacted copy in constant time
+     * @param[in,out] compaction : prepared compaction, receives the old notes on success
+     * @return false if the Storyboard has been modified since the compaction was prepared, in which case nothing is
+     * changed
+     */
+    bool commitCompaction(Compaction& compaction);
+
     /**
      * @brief Search the Storyboard for notes that contain the given string in the title field
      * @param[in] title : string that is matched
      * @param[in,out] container : notes in the Storyboard that contain the matched field are added into this container
      * @return number of search results
      */
-    int searchByTitle(const std::string& title, note_cont_t& container);
+    int searchByTitle(query::Key title, note_cont_t& container);
 
     /**
      * @brief Search the Storyboard container for notes that contain the given string in the text field
@@ -119,23 +363,420 @@ public:
      * @param[in,out] container : notes in the Storyboard that contain the matched field are added into this container
      * @return number of search results
      */
-    int searchByText(const std::string& text, note_cont_t& container);
+    int searchByText(query::Key text, note_cont_t& container);
 
     /**
      * @brief Search the Storyboard container for notes that contain the given string(s) in the tag field
+     * @details The matching notes are found with the tag postings, without scanning the notes.
      * @param[in] tags : a vector of tags that are matched
      * @param[in,out] container : notes in the Storyboard that contain the matched field are added into this container
+     * @param[in] match : whether a note has to carry any or all of the tags
      * @return number of search results
      */
-    int searchByTag(const tag_cont_t& tags, note_cont_t& container);
+    int searchByTag(const tag_cont_t& tags, note_cont_t& container, TagMatch match = TagMatch::Any);
+
+    /**
+     * @brief Search the Storyboard for notes that contain the given string in the title field, without copying them
+     * @param[in] title : string that is matched
+     * @param[in] visitor : called for each matching note. The note is only valid during the call.
+     * @return number of search results
+     */
+    int searchByTitle(query::Key title, const note_visitor_t& visitor);
+
+    /**
+     * @brief Search the Storyboard for notes that contain the given string in the text field, without copying them
+     * @param[in] text : string that is matched
+     * @param[in] visitor : called for each matching note. The note is only valid during the call.
+     * @return number of search results
+     */
+    int searchByText(query::Key text, const note_visitor_t& visitor);
+
+    /**
+     * @brief Search the Storyboard for notes that contain the given string(s) in the tag field, without copying them
+     * @param[in] tags : a vector of tags that are matched
+     * @param[in] visitor : called for each matching note. The note is only valid during the call.
+     * @param[in] match : whether a note has to carry any or all of the tags
+     * @return number of search results
+     */
+    int searchByTag(const tag_cont_t& tags, const note_visitor_t& visitor, TagMatch match = TagMatch::Any);
+
+    /**
+     * @brief Searches the Storyboard with a predicate that is composed at compile time, see storyboard::query
+     * @details The predicate is called directly in the scan loop, so a composed predicate is inlined into a single pass
+     * over the notes. The results are not cached.
+     * @param[in] predicate : callable with a const Note&, returns true for matching notes
+     * @param[in] sink : called for each matching note. The note is only valid during the call.
+     * @return number of search results
+     */
+    template <typename Predicate, typename Sink>
+    int search(Predicate&& predicate, Sink&& sink) const;
+
+    /**
+     * @brief Counts the notes that contain the given string in the title field
+     * @param[in] title : string that is matched
+     * @return number of matching notes
+     */
+    int countByTitle(query::Key title);
+
+    /**
+     * @brief Counts the notes that contain the given string in the text field
+     * @param[in] text : string that is matched
+     * @return number of matching notes
+     */
+    int countByText(query::Key text);
+
+    /**
+     * @brief Counts the notes that contain the given string(s) in the tag field
+     * @details Computed from the cardinality of the tag postings, without visiting the notes.
+     * @param[in] tags : a vector of tags that are matched
+     * @param[in] match : whether a note has to carry any or all of the tags
+     * @return number of matching notes
+     */
+    int countByTag(const tag_cont_t& tags, TagMatch match = TagMatch::Any);
+
+    /**
+     * @brief Returns the number of notes carrying each tag. The counts are the cardinalities of the tag postings.
+     * @param[in,out] container : (tag, number of notes) pairs are added into this container, in unspecified order
+     * @return number of distinct tags
+     */
+    int getTagStats(tag_stats_cont_t& container);
+
+    /**
+     * @brief Counts the tags of the notes that contain the given string in the title field
+     * @param[in] title : string that is matched
+     * @param[in,out] container : (tag, number of matching notes) pairs are added into this container
+     * @return number of distinct tags among the matching notes
+     */
+    int facetsByTitle(query::Key title, tag_stats_cont_t& container);
+
+    /**
+     * @brief Counts the tags of the notes that contain the given string in the text field
+     * @param[in] text : string that is matched
+     * @param[in,out] container : (tag, number of matching notes) pairs are added into this container
+     * @return number of distinct tags among the matching notes
+     */
+    int facetsByText(query::Key text, tag_stats_cont_t& container);
+
+    /**
+     * @brief Counts the tags of the notes that contain the given string(s) in the tag field
+     * @param[in] tags : a vector of tags that are matched
+     * @param[in,out] container : (tag, number of matching notes) pairs are added into this container
+     * @return number of distinct tags among the matching notes
+     */
+    int facetsByTag(const tag_cont_t& tags, tag_stats_cont_t& container);
 
     /**
      * @brief Number of notes stored
      */
-    int length();
+    int length() const;
+
+    /**
+     * @brief Number of notes examined by searches, counts and deletes on the calling thread
+     * @details The counter is per thread and never reset, so the cost of a single call can be measured by reading the
+     * counter before and after the call.
+     * @return number of notes examined
+     */
+    static std::uint64_t notesScanned();
+
+    /**
+     * @brief Adds notes examined on behalf of the calling thread, e.g. by worker threads, to its counter
+     * @param[in] nr_notes : number of notes examined
+     */
+    static void addNotesScanned(std::uint64_t nr_notes);
+
+    /**
+     * @brief Generation of the Storyboard. The generation changes every time the notes are modified.
+     * @return generation counter
+     */
+    std::uint64_t generation() const;
+
+    /**
+     * @brief Sets the maximum number of query results that are cached. Caching is disabled by default.
+     * @param[in] capacity : maximum number of cached query results, 0 disables the cache
+     */
+    void setQueryCacheCapacity(std::size_t capacity);
+
+    /**
+     * @brief Returns the statistics of the query cache
+     * @return query cache statistics
+     */
+    QueryCacheStats queryCacheStats() const;
+
+    /**
+     * @brief Enables Bloom filters over blocks of consecutive notes, so that searches, counts and deletes by title skip
+     * the blocks that cannot match. The filters are disabled by default.
+     * @details A lower false-positive rate skips more blocks at the cost of more memory: about 1.44 * log2(1 / rate)
+     * bits per title. Smaller blocks skip more precisely at the cost of a little overhead per block. Tag queries use
+     * the tag postings instead.
+     * @param[in] block_size : number of notes per block, 0 disables the filters
+     * @param[in] false_positive_rate : target rate of blocks that are scanned without containing a match, in (0, 1)
+     */
+    void setBlockFilter(std::size_t block_size, double false_positive_rate);
+
+    /**
+     * @brief Sets whether the texts of the notes are stored compressed. Texts are not compressed by default.
+     * @details The texts are compressed in blocks of about TextBlock::TARGET_BYTES, with a dictionary that is trained
+     * once, when there are TRAINING_BYTES of uncompressed texts. Until then nothing is compressed, and afterwards the
+     * most recent texts stay uncompressed until they fill a block. Enabling compresses the texts that are stored,
+     * disabling decompresses them.
+     *
+     * Titles, tags and indexes are not compressed, so only text queries and the notes returned by queries decompress
+     * texts, a block at a time, see TextBlock::text().
+     * @param[in] enable : true to compress the texts
+     */
+    void setTextCompression(bool enable);
+
+    /**
+     * @brief Returns whether the texts of the notes are stored compressed
+     */
+    bool textCompression() const;
+
+    static const std::size_t TRAINING_BYTES = 4 * TextBlock::TARGET_BYTES;  /// Texts the dictionary is trained on
+
+    /**
+     * @brief Sets a memory budget, past which the texts of the notes are moved to a segment file on disk. There is no
+     * budget by default.
+     * @details The budget covers the notes with their titles and texts, i.e. MemoryUsage::notes, titles and texts.
+     * When adds take them over the budget, the texts that are not in blocks yet are grouped into blocks, compressed if
+     * text compression is enabled, and the blocks that were read the least recently, then the oldest, are appended to
+     * the segment file until the notes are back to 7/8 of the budget. Only the offsets of the texts of a spilled block
+     * stay in memory.
+     *
+     * Titles, tags and indexes stay in memory, so only text queries and the notes returned by queries read the file, a
+     * block at a time, see TextBlock::text(). Removing the budget reads the spilled texts back.
+     * @param[in] bytes : budget, 0 removes it
+     * @param[in] directory : directory the segment file is created in, ignored if bytes is 0
+     * @throw std::runtime_error if the segment file cannot be created
+     */
+    void setMemoryBudget(std::size_t bytes, const std::string& directory);
+
+    /**
+     * @brief Returns the memory budget, 0 if there is none
+     */
+    std::size_t memoryBudget() const;
+
+    /**
+     * @brief Returns the memory used by the Storyboard
+     * @details The counters are maintained as notes are added and deleted, so the cost does not depend on the number
+     * of notes.
+     * @return memory usage
+     */
+    MemoryUsage memoryUsage() const;
 
 private:
-    note_cont_t m_notes;  /// Container of Note objects
+    /**
+     * @brief Runs a query, using the query cache if it is enabled
+     * @param[in] kind : kind of the query
+     * @param[in] key : key of the query in the query cache
+     * @param[in] makePredicate : returns the predicate that is true for notes that match the query. It is only called
+     * if the results are not in the cache, since building a tag predicate already computes the matches.
+     * @param[in] sink : called for each matching note
+     * @return number of search results
+     */
+    template <typename MakePredicate, typename Sink>
+    int runQuery(QueryKind kind, query::Key key, MakePredicate&& makePredicate, Sink&& sink);
+
+    /**
+     * @brief Counts the results of a query without copying the matching notes
+     * @param[in] kind : kind of the query
+     * @param[in] key : key of the query in the query cache
+     * @param[in] predicate : returns true for notes that match the query
+     * @return number of matching notes
+     */
+    template <typename Predicate>
+    int runCount(QueryKind kind, query::Key key, Predicate&& predicate);
+
+    /**
+     * @brief Counts, in one pass, the tags of the notes that match a predicate
+     * @param[in] predicate : returns true for notes that match the query
+     * @param[in,out] container : (tag, number of matching notes) pairs are added into this container
+     * @return number of distinct tags among the matching notes
+     */
+    template <typename Predicate>
+    int runFacets(Predicate&& predicate, tag_stats_cont_t& container);
+
+    /**
+     * @brief Calls fn(note, index) for each note that matches a predicate. Predicates that know their matches, i.e.
+     * tag queries, do not scan the notes.
+     */
+    template <typename Predicate, typename Fn>
+    void forEachMatch(Predicate& predicate, Fn&& fn);
+
+    /**
+     * @brief Calls fn(note, index) for each note that is not a tombstone, skipping the blocks whose filter rules out
+     * all the keys. Without keys, all the notes are visited.
+     */
+    template <typename Fn>
+    void scanNotes(const BlockFilter::key_cont_t& keys, Fn&& fn);
+
+    /**
+     * @brief Rebuilds the block filters from the block of the given note on, and adds the filters of new full blocks
+     * @param[in] notes : notes the filters are built for
+     * @param[in] first_moved : index of the first note that has changed place, notes.size() if none has
+     * @param[in,out] filter : filters to update
+     */
+    static void updateBlockFilter(const note_cont_t& notes, std::size_t first_moved, BlockFilter& filter);
+
+    /**
+     * @brief Calls fn once for each distinct tag of a note, with the interned tag
+     */
+    template <typename Fn>
+    static void forEachDistinctTag(const Note& note, Fn&& fn);
+
+    /**
+     * @brief Adds or removes the id of a note to or from the postings of its tags and the content index
+     */
+    void indexNote(const Note& note);
+    void unindexNote(const Note& note);
+
+    /**
+     * @brief Prepares the note that has just been appended: normalizes its tags, computes its content hash and places
+     * it, see placeNote()
+     * @param[in] reject_duplicates : whether the note is removed again if it is equal to a stored note
+     * @return false if the note has been removed again
+     */
+    bool admitNote(bool reject_duplicates);
+
+    /**
+     * @brief Gives the next id to the note that has just been appended, and indexes it
+     * @details All the notes are renumbered when the ids run out.
+     */
+    void placeNote();
+
+    /**
+     * @brief Returns true if a note equal to the given, normalized and hashed, note is stored
+     */
+    bool isStored(const Note& note) const;
+
+    /**
+     * @brief Content hash of a note, over its title, text and normalized tags
+     */
+    static std::uint64_t contentHash(const std::string& title, const std::string& text, const TagList& tags);
+
+    /**
+     * @brief Position of the note with the given id, which has to be stored in the Storyboard
+     */
+    std::size_t positionOf(std::uint32_t id) const;
+
+    /**
+     * @brief Adds the ids of the notes that have the given content hash and match the predicate to ids
+     */
+    template <typename Predicate>
+    void findByHash(std::uint64_t hash, const Predicate& predicate, RoaringBitmap& ids) const;
+    /**
+     * @brief Deletes the notes that match a predicate, according to the delete mode
+     * @param[in] predicate : returns true for notes that are deleted
+     * @return number of notes that were deleted
+     */
+    template <typename Predicate>
+    int runDelete(Predicate&& predicate);
+
+    /**
+     * @brief Marks the notes that match a predicate as tombstones
+     * @param[in] predicate : returns true for notes that are deleted
+     * @return number of notes that were marked
+     */
+    template <typename Predicate>
+    int runTombstone(Predicate&& predicate);
+
+    /**
+     * @brief Compresses and spills the texts as configured, after notes were added
+     */
+    void storeTexts();
+
+    /**
+     * @brief Compresses the uncompressed texts of the notes that are not tombstones, if they fill at least a block
+     * @details Trains the dictionary first if there is none. The texts that do not fill a block stay uncompressed.
+     */
+    void compressTexts();
+
+    /**
+     * @brief Moves texts to the segment file while the notes are over the memory budget, see setMemoryBudget()
+     */
+    void spillTexts();
+
+    /**
+     * @brief Returns the notes that are not tombstones and whose text is not in a block, in order
+     */
+    std::vector<Note*> plainNotes();
+
+    /**
+     * @brief Groups texts into blocks of about TextBlock::TARGET_BYTES, compressed with the dictionary if there is one
+     * @param[in] notes : notes whose texts are not in blocks, in order. The texts that do not fill a block stay as
+     * they are.
+     */
+    void sealTexts(const std::vector<Note*>& notes);
+
+    /**
+     * @brief Makes the notes that are not tombstones refer to other blocks
+     * @param[in] blocks : new block of each block that is replaced
+     */
+    void replaceBlocks(const std::unordered_map<const TextBlock*, std::shared_ptr<const TextBlock>>& blocks);
+
+    /**
+     * @brief Memory counted against the memory budget
+     */
+    std::size_t budgetedBytes() const;
+
+    void addMemoryUsage(const Note& note);
+    void removeMemoryUsage(const Note& note);
+
+    static std::size_t noteBytes(const Note& note);
+    static std::size_t textBytes(const Note& note);
+
+    // Tags are interned, so the counts and the postings are keyed by the interned pointer
+    using tag_counts_t    = std::unordered_map<const std::string*, int>;
+    using tag_postings_t  = std::unordered_map<const std::string*, RoaringBitmap>;
+    using content_index_t = std::unordered_multimap<std::uint64_t, std::uint32_t>;
+
+    static auto        matchTitle(query::Key title);
+    static auto        matchText(query::Key text);
+    auto               matchTags(const tag_cont_t& tags, TagMatch match) const;
+    static std::string tagsKey(const tag_cont_t& tags);
+
+    note_cont_t     m_notes;                                 /// Container of Note objects
+    std::uint64_t   m_generation       = 0;                  /// Incremented when m_notes changes
+    QueryCache      m_queryCache;                            /// Cache of query results
+    tag_postings_t  m_postings;                              /// Ids of the notes carrying each tag
+    std::size_t     m_postingBytes     = 0;                  /// Containers of the postings, see RoaringBitmap::bytes()
+    std::uint32_t   m_nextId           = 0;                  /// Id of the next note added
+    content_index_t m_contentIndex;                          /// Ids of the notes by content hash
+    std::size_t     m_tagArrayBytes    = 0;                  /// Tag arrays that did not fit inline
+    std::size_t     m_titleBytes       = 0;                  /// Title payloads of the notes
+    std::size_t     m_textBytes        = 0;                  /// Text payloads of the notes
+    std::size_t     m_tagBytes         = 0;                  /// Interned tags of the notes, see TagTable::bytes()
+    DeleteMode      m_deleteMode       = DeleteMode::Erase;  /// How deleteNote removes notes
+    bool            m_rejectDuplicates = false;              /// Whether notes equal to a stored one are rejected
+    int             m_nrTombstones     = 0;                  /// Notes marked as deleted
+    std::size_t     m_tombstoneBytes   = 0;                  /// Memory held by the tombstones
+    BlockFilter     m_blockFilter;                           /// Bloom filters over the titles of blocks of notes
+    bool            m_compressTexts    = false;              /// Whether the texts are stored compressed
+    std::size_t     m_plainTexts       = 0;                  /// Notes whose text is not compressed
+    std::size_t     m_plainTextBytes   = 0;                  /// Uncompressed texts of the notes
+    std::size_t     m_memoryBudget     = 0;                  /// Memory past which texts are spilled, 0 if none
+    std::size_t     m_spilledTextBytes = 0;                  /// Memory left to the texts that are spilled
+    std::size_t     m_spilledBytes     = 0;                  /// Segment file bytes of the texts that are spilled
+
+    std::shared_ptr<const TextDictionary> m_dictionary;  /// Dictionary of the compressed texts, trained once
+    std::shared_ptr<SegmentFile>          m_segment;     /// File the texts are spilled to, if there is a budget
 };
 
+template <typename Predicate, typename Sink>
+int Storyboard::search(Predicate&& predicate, Sink&& sink) const
+{
+    int nr_results = 0;
+    addNotesScanned(m_notes.size());
+
+    for (auto& note : m_notes)
+    {
+        if (!note.m_tombstone && predicate(note))
+        {
+            sink(note);
+            nr_results++;
+        }
+    }
+
+    return nr_results;
+}
+
 }  // End of namespace storyboard
@@ -13,6 +13,18 @@ extern "C" {
 //-----------------------
 typedef struct error* error_t_;
 
+/**
+ * @brief Error codes
+ */
+typedef enum storyboard_status
+{
+    STORYBOARD_OK                     = 0,
+    STORYBOARD_ERROR_INVALID_ARGUMENT = 1,  /// An argument was NULL or out of range
+    STORYBOARD_ERROR_OUT_OF_MEMORY    = 2,  /// Memory allocation failed
+    STORYBOARD_ERROR_INTERNAL         = 3,  /// Any other failure inside the library
+    STORYBOARD_ERROR_CANCELLED        = 4   /// The operation was cancelled before it finished
+} storyboard_status;
+
 /**
  * @brief Returns error message of the @error_t_ object
  * @param[in, out] out_error : error object
@@ -37,6 +49,51 @@ error_t_ error_destruct(error_t_ error);
 STORYBOARD_EXPORT
 const char* error_get_string(error_t_ error);
 
+/**
+ * @brief Returns error code of the @error_t_ object
+ * @param[in] error : error object
+ * @return error code
+ */
+STORYBOARD_EXPORT
+storyboard_status error_get_code(error_t_ error);
+
+/**
+ * @brief Returns the code of the most recent error on the calling thread
+ * @details Every failure is recorded in thread-local storage, whether or not an error object was requested. Passing a
+ * NULL out_error to any function selects the allocation-free mode: no error object is created, and the failure is only
+ * available through storyboard_last_error_code() and storyboard_last_error_message(). The record is only written on
+ * failure, successful calls leave it as it is. A caller that checks it after a call must reset it before the call with
+ * storyboard_clear_last_error(). The hot ingest calls also have variants that return their status directly, e.g.
+ * storyboard_add_note_status().
+ * @return error code, STORYBOARD_OK if no error has been recorded since the last reset
+ */
+STORYBOARD_EXPORT
+storyboard_status storyboard_last_error_code(void);
+
+/**
+ * @brief Returns the message of the most recent error on the calling thread
+ * @details The message is truncated to fit the message buffer of the thread, see storyboard_set_error_buffer().
+ * @return Pointer to the error message, an empty string if no error has been recorded since the last reset
+ */
+STORYBOARD_EXPORT
+const char* storyboard_last_error_message(void);
+
+/**
+ * @brief Resets the error record of the calling thread to STORYBOARD_OK
+ */
+STORYBOARD_EXPORT
+void storyboard_clear_last_error(void);
+
+/**
+ * @brief Sets a caller-provided buffer for the error messages of the calling thread
+ * @details The buffer must stay valid until it is replaced or the thread exits. By default a library-owned buffer of
+ * 256 characters is used.
+ * @param[in] buffer : message buffer, NULL restores the library-owned buffer
+ * @param[in] buffer_size : size of the buffer in characters, including the NUL-terminator
+ */
+STORYBOARD_EXPORT
+void storyboard_set_error_buffer(char* buffer, int32_t buffer_size);
+
 //-------------
 // --- Note ---
 //-------------
@@ -54,6 +111,43 @@ typedef struct note* note_t;
 STORYBOARD_EXPORT
 note_t note_construct(const char* title, const char* text, const char* tags[], int32_t nr_tags, error_t_* out_error);
 
+/**
+ * @brief Constructs a new note from length-delimited strings
+ * @details The strings are not required to be NUL-terminated and may contain NUL characters, so they can be slices of
+ * larger buffers or binary data. A string can be NULL if its length is 0.
+ * @param[in] title : Title of the note
+ * @param[in] title_length : Length of the title
+ * @param[in] text : Text of the note
+ * @param[in] text_length : Length of the text
+ * @param[in] tags : Tags for the note
+ * @param[in] tag_lengths : Lengths of the tags
+ * @param[in] nr_tags : Number of tags being passed
+ * @param[in, out] out_error : error object
+ * @return a new @note_t object
+ */
+STORYBOARD_EXPORT
+note_t note_construct_n(const char* title, int32_t title_length, const char* text, int32_t text_length,
+                        const char* const* tags, const int32_t* tag_lengths, int32_t nr_tags, error_t_* out_error);
+
+/**
+ * @brief Same as note_construct_n(), returning the status instead of filling an error object
+ * @details Failures do not allocate. The message of a failure is in the thread-local error record, see
+ * storyboard_last_error_message().
+ * @param[in] title : Title of the note
+ * @param[in] title_length : Length of the title
+ * @param[in] text : Text of the note
+ * @param[in] text_length : Length of the text
+ * @param[in] tags : Tags for the note
+ * @param[in] tag_lengths : Lengths of the tags
+ * @param[in] nr_tags : Number of tags being passed
+ * @param[out] out_note : receives the new @note_t object, NULL on failure
+ * @return STORYBOARD_OK, or the code of the error
+ */
+STORYBOARD_EXPORT
+storyboard_status note_construct_n_status(const char* title, int32_t title_length, const char* text,
+                                          int32_t text_length, const char* const* tags, const int32_t* tag_lengths,
+                                          int32_t nr_tags, note_t* out_note);
+
 /**
  * @brief Destructs a note object
  * @param[in] note_in : a note that is being destructed
@@ -80,6 +174,17 @@ note_t note_copy(const note_t note_in, error_t_* out_error);
 STORYBOARD_EXPORT
 const char* note_get_title(const note_t note_in, error_t_* out_error);
 
+/**
+ * @brief Get note's title and its length
+ * @details The title is NUL-terminated as well, but may contain NUL characters if it was given with its length.
+ * @param[in] note_in : note being queried
+ * @param[out] out_length : length of the title, excluding the NUL-terminator
+ * @param[in, out] out_error : error object
+ * @return Pointer to the title, valid until the note is destructed
+ */
+STORYBOARD_EXPORT
+const char* note_get_title_n(const note_t note_in, int32_t* out_length, error_t_* out_error);
+
 /**
  * @brief Get note's title
  * @param[in] note_in : note being queried
@@ -89,6 +194,17 @@ const char* note_get_title(const note_t note_in, error_t_* out_error);
 STORYBOARD_EXPORT
 const char* note_get_text(const note_t note_in, error_t_* out_error);
 
+/**
+ * @brief Get note's text and its length
+ * @details The text is NUL-terminated as well, but may contain NUL characters if it was given with its length.
+ * @param[in] note_in : note being queried
+ * @param[out] out_length : length of the text, excluding the NUL-terminator
+ * @param[in, out] out_error : error object
+ * @return Pointer to the text, valid until the note is destructed
+ */
+STORYBOARD_EXPORT
+const char* note_get_text_n(const note_t note_in, int32_t* out_length, error_t_* out_error);
+
 /**
  * @brief Note query handler type. Used for querying note's tags.
  * @param[in] client_data : void pointer to client data object that is passed to the handler
@@ -108,9 +224,28 @@ typedef void (*note_query_handler)(void* client_data, const char* tag);
 STORYBOARD_EXPORT
 int32_t note_get_tags(const note_t note_in, note_query_handler handler, void* client_data, error_t_* out_error);
 
+/**
+ * @brief Get note's tags as an array
+ * @details Returns pointers into the note's own storage, nothing is copied. The pointers remain valid until the note is
+ * destructed.
+ * @param[in] note_in : note being queried
+ * @param[out] out_tags : pointer to an array of NUL-terminated tags
+ * @param[out] out_lengths : pointer to an array of tag lengths, excluding the NUL-terminator. Can be NULL.
+ * @param[in, out] out_error : error object
+ * @return number of tags
+ */
+STORYBOARD_EXPORT
+int32_t note_get_tags_array(const note_t note_in, const char* const** out_tags, const int32_t** out_lengths,
+                            error_t_* out_error);
+
 //-------------------
 // --- Storyboard ---
 //-------------------
+/**
+ * @brief Opaque storyboard object
+ * @details A board can be shared between threads. Searches and other queries run concurrently, while adds, deletes
+ * and configuration changes are exclusive. Query handlers must not modify the board they are called for.
+ */
 typedef struct board* board_t;
 
 /**
@@ -121,6 +256,17 @@ typedef struct board* board_t;
 STORYBOARD_EXPORT
 board_t storyboard_construct(error_t_* out_error);
 
+/**
+ * @brief Constructs a storyboard object whose notes are split into shards by the hash of their title
+ * @details Each shard has its own lock, so adds and deletes of notes in different shards do not contend. Searches by
+ * title visit one shard, other searches run on the shards in parallel and the results are returned shard by shard.
+ * @param[in] nr_shards : number of shards, at least 1
+ * @param[in, out] out_error : error object
+ * @return new board
+ */
+STORYBOARD_EXPORT
+board_t storyboard_construct_sharded(int32_t nr_shards, error_t_* out_error);
+
 /**
  * @brief Destructs a storyboard object
  * @param[in] board_in : board to be destructed
@@ -143,11 +289,132 @@ board_t storyboard_copy(const board_t board_in, error_t_* out_error);
  * @param[in] board_in : board where the note is added
  * @param[in] note_in : note that is added to the board
  * @param[in, out] out_error : error object
- * @return
  */
 STORYBOARD_EXPORT
 void storyboard_add_note(board_t board_in, const note_t note_in, error_t_* out_error);
 
+/**
+ * @brief Adds a note to a board, and tells whether it was added
+ * @param[in] board_in : board where the note is added
+ * @param[in] note_in : note that is added to the board
+ * @param[in, out] out_error : error object
+ * @return 1 if the note was added, 0 if it was rejected as a duplicate, see storyboard_set_reject_duplicates()
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_add_note_checked(board_t board_in, const note_t note_in, error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_add_note_checked(), returning the status instead of filling an error object
+ * @details Failures do not allocate. The message of a failure is in the thread-local error record, see
+ * storyboard_last_error_message().
+ * @param[in] board_in : board where the note is added
+ * @param[in] note_in : note that is added to the board
+ * @param[out] out_added : receives 1 if the note was added, 0 otherwise, can be NULL
+ * @return STORYBOARD_OK, or the code of the error
+ */
+STORYBOARD_EXPORT
+storyboard_status storyboard_add_note_status(board_t board_in, const note_t note_in, int32_t* out_added);
+
+/**
+ * @brief Sets whether a board rejects notes that are equal to a note it already stores
+ * @details Duplicates are accepted by default. Equal notes are found through content hashes, so the check costs about
+ * one hash lookup per added note. Queued notes that are duplicates are dropped when the queue is applied.
+ * @param[in] board_in : board that is configured
+ * @param[in] reject : non-zero to reject duplicates
+ * @param[in, out] out_error : error object
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_set_reject_duplicates(board_t board_in, int32_t reject, error_t_* out_error);
+
+/**
+ * @brief How storyboard_merge() treats the notes that the destination board already stores
+ */
+typedef enum storyboard_merge_policy
+{
+    STORYBOARD_MERGE_KEEP_ALL        = 0,  /// All the notes are appended
+    STORYBOARD_MERGE_SKIP_DUPLICATES = 1   /// Notes equal to a stored or a previously merged note are skipped
+} storyboard_merge_policy;
+
+/**
+ * @brief Appends copies of the notes of a board to another board
+ * @details The content hashes of the source notes are reused, so the merge costs about one hash lookup per note and
+ * does not compare the texts of different notes. Duplicates are also skipped if the destination board rejects them,
+ * see storyboard_set_reject_duplicates(). Notes queued on either board are not included until they are flushed.
+ * @param[in] board_in : board where the notes are appended
+ * @param[in] source_in : board whose notes are copied, can be board_in
+ * @param[in] policy : one of storyboard_merge_policy, whether notes equal to a stored note are skipped
+ * @param[in, out] out_error : error object
+ * @return number of notes appended
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_merge(board_t board_in, const board_t source_in, int32_t policy, error_t_* out_error);
+
+/**
+ * @brief Side of a difference reported by storyboard_diff()
+ */
+typedef enum storyboard_diff_kind
+{
+    STORYBOARD_DIFF_ADDED   = 0,  /// The note is only in the second board
+    STORYBOARD_DIFF_REMOVED = 1   /// The note is only in the first board
+} storyboard_diff_kind;
+
+/**
+ * @brief Signature of a function that receives the differences between two boards, with the lengths of the strings
+ */
+typedef void (*storyboard_diff_handler)(void* client_data, storyboard_diff_kind kind, const char* title,
+                                        int32_t title_length, const char* text, int32_t text_length,
+                                        const char* const* tags, const int32_t* tag_lengths, int32_t nr_tags);
+
+/**
+ * @brief Reports the notes that turn a board into another one
+ * @details The boards are compared as multisets of notes: a note stored twice in board_b and once in board_a is
+ * reported as added once. Notes are paired through their content hashes, in expected linear time. The added notes are
+ * reported first, in the order of board_b, then the removed ones in the order of board_a. Both boards are locked for
+ * reading during the diff, so the handler must not modify them.
+ * @param[in] board_a : board before
+ * @param[in] board_b : board after
+ * @param[in] handler : called for each note that is only in one of the boards
+ * @param[in] client_data : client data that is passed to the handler
+ * @param[in, out] out_error : error object
+ * @return number of notes reported
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_diff(const board_t board_a, const board_t board_b, storyboard_diff_handler handler,
+                        void* client_data, error_t_* out_error);
+
+/**
+ * @brief Queues a note for adding to a board, without waiting for the board
+ * @details Any number of threads can queue notes at the same time. The queued notes are added in batches by a
+ * background thread, so they become visible to searches some time after this call returns; call storyboard_flush()
+ * to wait for them. Queued notes are not ordered with storyboard_add_note() and the delete functions.
+ * @param[in] board_in : board where the note is added
+ * @param[in] note_in : note that is added to the board
+ * @param[in, out] out_error : error object
+ */
+STORYBOARD_EXPORT
+void storyboard_enqueue_note(board_t board_in, const note_t note_in, error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_enqueue_note(), returning the status instead of filling an error object
+ * @details Failures do not allocate. The message of a failure is in the thread-local error record, see
+ * storyboard_last_error_message().
+ * @param[in] board_in : board where the note is added
+ * @param[in] note_in : note that is added to the board
+ * @return STORYBOARD_OK, or the code of the error
+ */
+STORYBOARD_EXPORT
+storyboard_status storyboard_enqueue_note_status(board_t board_in, const note_t note_in);
+
+/**
+ * @brief Waits until the notes queued by the calling thread with storyboard_enqueue_note() are visible to searches
+ * @details Reports an error if adding a batch of queued notes has failed since the last flush.
+ * @param[in] board_in : board whose queue is flushed
+ * @param[in, out] out_error : error object
+ */
+STORYBOARD_EXPORT
+void storyboard_flush(board_t board_in, error_t_* out_error);
+
 /**
  * @brief Deletes a note
  * @param[in] board_in : board from which the note is deleted
@@ -158,6 +425,70 @@ void storyboard_add_note(board_t board_in, const note_t note_in, error_t_* out_e
 STORYBOARD_EXPORT
 int32_t storyboard_delete_note(board_t board_in, const note_t note_in, error_t_* out_error);
 
+/**
+ * @brief Deletes, in one pass over the board, all the notes whose title is the given string
+ * @param[in] board_in : board from which the notes are deleted
+ * @param[in] title : title that is matched
+ * @param[in, out] out_error : error object
+ * @return number of notes deleted
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_delete_by_title(board_t board_in, const char* title, error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_delete_by_title(), with a length-delimited title that is not copied
+ * @param[in] board_in : board from which the notes are deleted
+ * @param[in] title : title that is matched, can be NULL if title_length is 0
+ * @param[in] title_length : length of the title
+ * @param[in, out] out_error : error object
+ * @return number of notes deleted
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_delete_by_title_n(board_t board_in, const char* title, int32_t title_length, error_t_* out_error);
+
+/**
+ * @brief Deletes, in one pass over the board, all the notes whose text contains the given string
+ * @param[in] board_in : board from which the notes are deleted
+ * @param[in] text : text that is matched
+ * @param[in, out] out_error : error object
+ * @return number of notes deleted
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_delete_by_text(board_t board_in, const char* text, error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_delete_by_text(), with a length-delimited text that is not copied
+ * @param[in] board_in : board from which the notes are deleted
+ * @param[in] text : text that is matched, can be NULL if text_length is 0
+ * @param[in] text_length : length of the text
+ * @param[in, out] out_error : error object
+ * @return number of notes deleted
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_delete_by_text_n(board_t board_in, const char* text, int32_t text_length, error_t_* out_error);
+
+/**
+ * @brief Deletes, in one pass over the board, all the notes that carry the given tag
+ * @details The board is not scanned at all if no note carries the tag.
+ * @param[in] board_in : board from which the notes are deleted
+ * @param[in] tag : tag that is matched
+ * @param[in, out] out_error : error object
+ * @return number of notes deleted
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_delete_by_tag(board_t board_in, const char* tag, error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_delete_by_tag(), with a length-delimited tag
+ * @param[in] board_in : board from which the notes are deleted
+ * @param[in] tag : tag that is matched, can be NULL if tag_length is 0
+ * @param[in] tag_length : length of the tag
+ * @param[in, out] out_error : error object
+ * @return number of notes deleted
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_delete_by_tag_n(board_t board_in, const char* tag, int32_t tag_length, error_t_* out_error);
+
 /**
  * @brief Storyboard query handler type
  * @param[in] client_data : void pointer to client data object that is passed to the handler
@@ -169,6 +500,23 @@ int32_t storyboard_delete_note(board_t board_in, const note_t note_in, error_t_*
 typedef void (*storyboard_query_handler)(void* client_data, const char* title, const char* text, const char* tags[],
                                          int32_t nr_tags);
 
+/**
+ * @brief Storyboard query handler type that gets the lengths of the strings
+ * @details The strings are NUL-terminated as well, but may contain NUL characters if the note was constructed with
+ * note_construct_n().
+ * @param[in] client_data : void pointer to client data object that is passed to the handler
+ * @param[in] title : Title of the note
+ * @param[in] title_length : Length of the title
+ * @param[in] text : Text of the note
+ * @param[in] text_length : Length of the text
+ * @param[in] tags : Tags of the note
+ * @param[in] tag_lengths : Lengths of the tags
+ * @param[in] nr_tags : Number of tags that the note contains
+ */
+typedef void (*storyboard_query_handler_n)(void* client_data, const char* title, int32_t title_length,
+                                           const char* text, int32_t text_length, const char* const* tags,
+                                           const int32_t* tag_lengths, int32_t nr_tags);
+
 /**
  * @brief Search notes based on the title
  * @param[in] board_in : board that is being queried
@@ -182,6 +530,21 @@ STORYBOARD_EXPORT
 int32_t storyboard_search_by_title(const board_t board_in, const char* title, storyboard_query_handler handler,
                                    void* client_data, error_t_* out_error);
 
+/**
+ * @brief Same as storyboard_search_by_title(), with a length-delimited title and a handler that gets the lengths
+ * @details The title is matched in place, without being copied.
+ * @param[in] board_in : board that is being queried
+ * @param[in] title : title being queried, can be NULL if title_length is 0
+ * @param[in] title_length : length of the title
+ * @param[in] handler : query handler
+ * @param[in] client_data : client data that is passed to the query handler
+ * @param[in, out] out_error : error object
+ * @return number of search results
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_search_by_title_n(const board_t board_in, const char* title, int32_t title_length,
+                                     storyboard_query_handler_n handler, void* client_data, error_t_* out_error);
+
 /**
  * @brief Search notes based on the text
  * @param[in] board_in : board that is being queried
@@ -195,6 +558,21 @@ STORYBOARD_EXPORT
 int32_t storyboard_search_by_text(const board_t board_in, const char* text, storyboard_query_handler handler,
                                   void* client_data, error_t_* out_error);
 
+/**
+ * @brief Same as storyboard_search_by_text(), with a length-delimited text and a handler that gets the lengths
+ * @details The text is matched in place, without being copied.
+ * @param[in] board_in : board that is being queried
+ * @param[in] text : text being queried, can be NULL if text_length is 0
+ * @param[in] text_length : length of the text
+ * @param[in] handler : query handler
+ * @param[in] client_data : client data that is passed to the query handler
+ * @param[in, out] out_error : error object
+ * @return number of search results
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_search_by_text_n(const board_t board_in, const char* text, int32_t text_length,
+                                    storyboard_query_handler_n handler, void* client_data, error_t_* out_error);
+
 /**
  * @brief Search notes based on the tag
  * @param[in] board_in : board that is being queried
@@ -208,6 +586,154 @@ STORYBOARD_EXPORT
 int32_t storyboard_search_by_tag(const board_t board_in, const char* tag, storyboard_query_handler handler,
                                  void* client_data, error_t_* out_error);
 
+/**
+ * @brief Same as storyboard_search_by_tag(), with a length-delimited tag and a handler that gets the lengths
+ * @param[in] board_in : board that is being queried
+ * @param[in] tag : tag being queried, can be NULL if tag_length is 0
+ * @param[in] tag_length : length of the tag
+ * @param[in] handler : query handler
+ * @param[in] client_data : client data that is passed to the query handler
+ * @param[in, out] out_error : error object
+ * @return number of search results
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_search_by_tag_n(const board_t board_in, const char* tag, int32_t tag_length,
+                                   storyboard_query_handler_n handler, void* client_data, error_t_* out_error);
+
+/**
+ * @brief Counts notes based on the title without returning them
+ * @param[in] board_in : board that is being queried
+ * @param[in] title : title/name being queried
+ * @param[in, out] out_error : error object
+ * @return number of matching notes
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_count_by_title(const board_t board_in, const char* title, error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_count_by_title(), with a length-delimited title that is not copied
+ * @param[in] board_in : board that is being queried
+ * @param[in] title : title being queried, can be NULL if title_length is 0
+ * @param[in] title_length : length of the title
+ * @param[in, out] out_error : error object
+ * @return number of matching notes
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_count_by_title_n(const board_t board_in, const char* title, int32_t title_length,
+                                    error_t_* out_error);
+
+/**
+ * @brief Counts notes based on the text without returning them
+ * @param[in] board_in : board that is being queried
+ * @param[in] text : text being queried
+ * @param[in, out] out_error : error object
+ * @return number of matching notes
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_count_by_text(const board_t board_in, const char* text, error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_count_by_text(), with a length-delimited text that is not copied
+ * @param[in] board_in : board that is being queried
+ * @param[in] text : text being queried, can be NULL if text_length is 0
+ * @param[in] text_length : length of the text
+ * @param[in, out] out_error : error object
+ * @return number of matching notes
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_count_by_text_n(const board_t board_in, const char* text, int32_t text_length, error_t_* out_error);
+
+/**
+ * @brief Counts notes based on the tag without returning them
+ * @param[in] board_in : board that is being queried
+ * @param[in] tag : tag being queried
+ * @param[in, out] out_error : error object
+ * @return number of matching notes
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_count_by_tag(const board_t board_in, const char* tag, error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_count_by_tag(), with a length-delimited tag
+ * @param[in] board_in : board that is being queried
+ * @param[in] tag : tag being queried, can be NULL if tag_length is 0
+ * @param[in] tag_length : length of the tag
+ * @param[in, out] out_error : error object
+ * @return number of matching notes
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_count_by_tag_n(const board_t board_in, const char* tag, int32_t tag_length, error_t_* out_error);
+
+/**
+ * @brief How a note has to carry the tags of a multi-tag query to match it
+ */
+typedef enum storyboard_tag_match
+{
+    STORYBOARD_TAG_MATCH_ANY = 0,  /// At least one of the tags
+    STORYBOARD_TAG_MATCH_ALL = 1   /// Every one of the tags
+} storyboard_tag_match;
+
+/**
+ * @brief Search notes that carry any or all of the given tags
+ * @details The order and the repetitions of the query tags do not matter. The tags of the stored notes are sorted and
+ * deduplicated, so the handler gets them in that form.
+ * @param[in] board_in : board that is being queried
+ * @param[in] tags : tags being queried
+ * @param[in] nr_tags : number of tags
+ * @param[in] match : one of storyboard_tag_match, whether a note has to carry any or all of the tags
+ * @param[in] handler : query handler
+ * @param[in] client_data : client data that is passed to the query handler
+ * @param[in, out] out_error : error object
+ * @return number of search results
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_search_by_tags(const board_t board_in, const char* const* tags, int32_t nr_tags, int32_t match,
+                                  storyboard_query_handler handler, void* client_data, error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_search_by_tags(), with length-delimited tags and a handler that gets the lengths
+ * @param[in] board_in : board that is being queried
+ * @param[in] tags : tags being queried
+ * @param[in] tag_lengths : lengths of the tags
+ * @param[in] nr_tags : number of tags
+ * @param[in] match : one of storyboard_tag_match, whether a note has to carry any or all of the tags
+ * @param[in] handler : query handler
+ * @param[in] client_data : client data that is passed to the query handler
+ * @param[in, out] out_error : error object
+ * @return number of search results
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_search_by_tags_n(const board_t board_in, const char* const* tags, const int32_t* tag_lengths,
+                                    int32_t nr_tags, int32_t match, storyboard_query_handler_n handler,
+                                    void* client_data, error_t_* out_error);
+
+/**
+ * @brief Counts notes that carry any or all of the given tags, without returning them
+ * @param[in] board_in : board that is being queried
+ * @param[in] tags : tags being queried
+ * @param[in] nr_tags : number of tags
+ * @param[in] match : one of storyboard_tag_match, whether a note has to carry any or all of the tags
+ * @param[in, out] out_error : error object
+ * @return number of matching notes
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_count_by_tags(const board_t board_in, const char* const* tags, int32_t nr_tags, int32_t match,
+                                 error_t_* out_error);
+
+/**
+ * @brief Same as storyboard_count_by_tags(), with length-delimited tags
+ * @param[in] board_in : board that is being queried
+ * @param[in] tags : tags being queried
+ * @param[in] tag_lengths : lengths of the tags
+ * @param[in] nr_tags : number of tags
+ * @param[in] match : one of storyboard_tag_match, whether a note has to carry any or all of the tags
+ * @param[in, out] out_error : error object
+ * @return number of matching notes
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_count_by_tags_n(const board_t board_in, const char* const* tags, const int32_t* tag_lengths,
+                                   int32_t nr_tags, int32_t match, error_t_* out_error);
+
 /**
  * @brief Number of notes that the board contains
  * @param[in] board_in : board that is being queried
@@ -217,6 +743,366 @@ int32_t storyboard_search_by_tag(const board_t board_in, const char* tag, storyb
 STORYBOARD_EXPORT
 int32_t storyboard_get_nr_notes(const board_t board_in, error_t_* out_error);
 
+/**
+ * @brief Kinds of queries supported by the board
+ */
+typedef enum storyboard_query_kind
+{
+    STORYBOARD_QUERY_BY_TITLE = 0,
+    STORYBOARD_QUERY_BY_TEXT  = 1,
+    STORYBOARD_QUERY_BY_TAG   = 2
+} storyboard_query_kind;
+
+/**
+ * @brief Handle of an asynchronous search
+ */
+typedef struct search* search_t;
+
+/**
+ * @brief Completion handler type of an asynchronous search
+ * @details Called exactly once for each search, on a worker thread. The notes are owned by the library and are only
+ * valid during the call, use note_copy() to keep them. The handler must not destruct the board that is searched.
+ * @param[in] user_data : user data that was passed to storyboard_search_async()
+ * @param[in] status : STORYBOARD_OK, STORYBOARD_ERROR_CANCELLED if the search was cancelled, or the error of the query
+ * @param[in] notes : matching notes, NULL if there are none or the status is not STORYBOARD_OK
+ * @param[in] nr_notes : number of matching notes
+ */
+typedef void (*storyboard_search_completion)(void* user_data, storyboard_status status, const note_t* notes,
+                                             int32_t nr_notes);
+
+/**
+ * @brief Starts a search that runs on a worker thread managed by the library, and returns without waiting for it
+ * @details The board waits for its searches to finish when it is destructed. Destructing the handle does not cancel
+ * the search.
+ * @param[in] board_in : board that is being queried
+ * @param[in] kind : one of storyboard_query_kind
+ * @param[in] key : title, text or tag being queried
+ * @param[in] completion : handler that receives the results
+ * @param[in] user_data : user data that is passed to the completion handler
+ * @param[in, out] out_error : error object
+ * @return handle of the search, NULL if the search could not be started
+ */
+STORYBOARD_EXPORT
+search_t storyboard_search_async(const board_t board_in, int32_t kind, const char* key,
+                                 storyboard_search_completion completion, void* user_data, error_t_* out_error);
+
+/**
+ * @brief Cancels an asynchronous search. A search that has not started yet does not run at all.
+ * @param[in] search_in : search that is cancelled
+ * @param[in, out] out_error : error object
+ * @return 1 if the completion handler will be called with STORYBOARD_ERROR_CANCELLED, 0 if the results have already
+ * been delivered
+ */
+STORYBOARD_EXPORT
+int32_t search_cancel(search_t search_in, error_t_* out_error);
+
+/**
+ * @brief Waits until the completion handler of an asynchronous search has returned
+ * @param[in] search_in : search that is waited for
+ * @param[in, out] out_error : error object
+ */
+STORYBOARD_EXPORT
+void search_wait(search_t search_in, error_t_* out_error);
+
+/**
+ * @brief Deletes the search handle. The search itself keeps running.
+ * @param[in] search_in : search handle
+ * @return nullptr
+ */
+STORYBOARD_EXPORT
+search_t search_destruct(search_t search_in);
+
+/**
+ * @brief Tag statistics handler type
+ * @param[in] client_data : void pointer to client data object that is passed to the handler
+ * @param[in] tag : Tag
+ * @param[in] nr_notes : Number of notes carrying the tag
+ */
+typedef void (*storyboard_tag_stats_handler)(void* client_data, const char* tag, int32_t nr_notes);
+
+/**
+ * @brief Returns the number of notes carrying each tag
+ * @details The counts are maintained as notes are added and deleted, so this does not scan the notes. The handler is
+ * called once for each distinct tag, in unspecified order.
+ * @param[in] board_in : board that is being queried
+ * @param[in] handler : tag statistics handler
+ * @param[in] client_data : client data that is passed to the handler
+ * @param[in, out] out_error : error object
+ * @return number of distinct tags
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_get_tag_stats(const board_t board_in, storyboard_tag_stats_handler handler, void* client_data,
+                                 error_t_* out_error);
+
+/**
+ * @brief Returns the number of notes carrying each tag, restricted to the notes matching a query
+ * @details The facets are computed in one pass over the board. The handler is called once for each distinct tag among
+ * the matching notes, in unspecified order.
+ * @param[in] board_in : board that is being queried
+ * @param[in] kind : one of storyboard_query_kind
+ * @param[in] key : title, text or tag being queried
+ * @param[in] handler : tag statistics handler
+ * @param[in] client_data : client data that is passed to the handler
+ * @param[in, out] out_error : error object
+ * @return number of distinct tags among the matching notes
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_get_tag_facets(const board_t board_in, int32_t kind, const char* key,
+                                  storyboard_tag_stats_handler handler, void* client_data, error_t_* out_error);
+
+/**
+ * @brief Statistics of the query result cache of a board
+ */
+typedef struct storyboard_cache_stats
+{
+    uint64_t hits;          /// Queries that were served from the cache
+    uint64_t misses;        /// Queries that had to scan the board
+    uint64_t evictions;     /// Results dropped because the cache was full
+    uint64_t entries;       /// Number of results currently cached
+    uint64_t capacity;      /// Maximum number of cached results, 0 if caching is disabled
+    uint64_t memory_bytes;  /// Approximate memory used by the cached results
+} storyboard_cache_stats;
+
+/**
+ * @brief Sets the maximum number of query results that the board caches
+ * @details Caching is disabled by default. Cached results are invalidated whenever notes are added or deleted.
+ * @param[in] board_in : board whose cache is configured
+ * @param[in] capacity : maximum number of cached query results, 0 disables the cache
+ * @param[in, out] out_error : error object
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_set_query_cache_capacity(board_t board_in, int32_t capacity, error_t_* out_error);
+
+/**
+ * @brief Returns the statistics of the query result cache
+ * @param[in] board_in : board that is being queried
+ * @param[out] out_stats : statistics are written here
+ * @param[in, out] out_error : error object
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_get_query_cache_stats(const board_t board_in, storyboard_cache_stats* out_stats, error_t_* out_error);
+
+/**
+ * @brief Enables Bloom filters over blocks of consecutive notes, so that searching, counting and deleting by title skip
+ * the blocks that cannot contain a match
+ * @details The filters are disabled by default. They are a cheaper alternative to an index for boards that are short on
+ * memory: the title of each note costs about 1.44 * log2(1 / false_positive_rate) bits. Tag queries use the tag
+ * postings and text queries always scan all the notes.
+ * @param[in] board_in : board that is configured
+ * @param[in] block_size : number of notes per block, 0 disables the filters
+ * @param[in] false_positive_rate : target rate of blocks that are scanned without containing a match, in (0, 1)
+ * @param[in, out] out_error : error object
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_set_block_filter(board_t board_in, int32_t block_size, double false_positive_rate, error_t_* out_error);
+
+/**
+ * @brief Sets whether a board stores the texts of its notes compressed
+ * @details Texts are not compressed by default. The texts are compressed in blocks, with a dictionary that each shard
+ * trains on its first texts, so boilerplate that recurs across the notes is stored about once. Enabling compresses the
+ * texts that are stored, disabling decompresses them. Small boards are not compressed, since there is not enough text
+ * to train the dictionary. Title and tag queries do not decompress anything. Text queries and the notes returned by
+ * queries decompress the texts a block at a time, and each thread keeps its most recently used blocks decompressed.
+ * @param[in] board_in : board that is configured
+ * @param[in] enable : non-zero to compress the texts
+ * @param[in, out] out_error : error object
+ */
+STORYBOARD_EXPORT
+void storyboard_set_text_compression(board_t board_in, int32_t enable, error_t_* out_error);
+
+/**
+ * @brief Sets a memory budget for a board, past which the texts of its notes are moved to files on disk
+ * @details There is no budget by default. The budget covers the notes with their titles and texts, and is split evenly
+ * between the shards. When adds take a shard over its share, its least recently read texts are appended, a block at a
+ * time and compressed if storyboard_set_text_compression is enabled, to a segment file of the shard, until the shard
+ * is back to 7/8 of its share. Titles, tags and indexes stay in memory, so title and tag queries never read the
+ * files. Text queries and the notes returned by queries read the spilled texts back a block at a time, and each
+ * thread keeps its most recently used blocks in memory. The files are removed when the board is destroyed. Removing
+ * the budget reads the spilled texts back.
+ * @param[in] board_in : board that is configured
+ * @param[in] budget : budget in bytes, 0 removes it
+ * @param[in] directory : existing directory the segment files are created in, may be NULL if budget is 0
+ * @param[in, out] out_error : error object, STORYBOARD_ERROR_INTERNAL if a segment file cannot be created
+ */
+STORYBOARD_EXPORT
+void storyboard_set_memory_budget(board_t board_in, uint64_t budget, const char* directory, error_t_* out_error);
+
+/**
+ * @brief Approximate memory used by a board, in bytes
+ * @details String payloads are counted by their length, the capacity reserved by the string implementation is not
+ * included.
+ */
+typedef struct storyboard_memory_stats
+{
+    uint64_t notes;          /// Note objects and the arrays holding their tags
+    uint64_t titles;         /// Title payloads
+    uint64_t texts;          /// Text payloads
+    uint64_t tags;           /// Distinct tags, i.e. their payloads and entries in the table of interned tags
+    uint64_t slack;          /// Unused capacity of the note container
+    uint64_t tag_index;      /// Per-tag postings, i.e. compressed bitmaps of the notes carrying each tag
+    uint64_t query_cache;    /// Cached query results
+    uint64_t tombstones;     /// Deleted notes that have not been compacted yet
+    uint64_t filters;        /// Per-block Bloom filters, see storyboard_set_block_filter
+    uint64_t content_index;  /// Content hashes of the notes, used to find equal notes
+    uint64_t dictionary;     /// Dictionaries of the compressed texts, see storyboard_set_text_compression
+    uint64_t total;          /// Sum of the above
+    uint64_t spilled;        /// Texts moved to disk, not included in the total, see storyboard_set_memory_budget
+} storyboard_memory_stats;
+
+/**
+ * @brief Returns the memory used by a board
+ * @details The counters are maintained as notes are added and deleted, so the call is cheap enough to be polled.
+ * @param[in] board_in : board that is being queried
+ * @param[out] out_stats : memory usage of the board
+ * @param[in, out] out_error : error object
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_memory_usage(const board_t board_in, storyboard_memory_stats* out_stats, error_t_* out_error);
+
+/**
+ * @brief How storyboard_delete_note and the storyboard_delete_by_* functions remove notes
+ */
+typedef enum storyboard_delete_mode
+{
+    STORYBOARD_DELETE_ERASE     = 0,  /// Notes are erased immediately, moving the notes stored after them
+    STORYBOARD_DELETE_TOMBSTONE = 1   /// Notes are marked as deleted and their memory is reclaimed by compaction
+} storyboard_delete_mode;
+
+/**
+ * @brief Sets how notes are deleted from a board. STORYBOARD_DELETE_ERASE is the default.
+ * @param[in] board_in : board that is configured
+ * @param[in] mode : one of storyboard_delete_mode
+ * @param[in, out] out_error : error object
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_set_delete_mode(board_t board_in, int32_t mode, error_t_* out_error);
+
+/**
+ * @brief Removes the notes that were deleted in STORYBOARD_DELETE_TOMBSTONE mode and releases their memory
+ * @details Searches can run while the board is being compacted; adds and deletes wait only while the compacted notes
+ * are being swapped in.
+ * @param[in] board_in : board that is compacted
+ * @param[in, out] out_error : error object
+ * @return number of deleted notes that were removed
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_compact(board_t board_in, error_t_* out_error);
+
+/**
+ * @brief Enables compacting a board on a background thread
+ * @details After each delete, the board is compacted in the background if the ratio of deleted notes to all the
+ * stored notes is at least the threshold.
+ * @param[in] board_in : board that is configured
+ * @param[in] threshold : ratio between 0 and 1 that triggers a compaction, 0 disables background compaction
+ * @param[in, out] out_error : error object
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_set_auto_compaction(board_t board_in, double threshold, error_t_* out_error);
+
+/**
+ * @brief Number of buckets in the latency histograms
+ */
+#define STORYBOARD_LATENCY_BUCKETS 32
+
+/**
+ * @brief Statistics of one storyboard_* entry point of a board
+ */
+typedef struct storyboard_op_stats
+{
+    const char* operation;         /// Name of the entry point, e.g. "storyboard_search_by_tag"
+    uint64_t    calls;             /// Number of calls
+    uint64_t    errors;            /// Number of calls that reported an error
+    uint64_t    results;           /// Total number of results returned
+    uint64_t    notes_scanned;     /// Total number of notes examined
+    uint64_t    total_latency_ns;  /// Total duration of the calls in nanoseconds
+    /// Bucket i counts the calls that took [2^i, 2^(i+1)) nanoseconds, the last bucket also counts longer calls
+    uint64_t latency_buckets[STORYBOARD_LATENCY_BUCKETS];
+} storyboard_op_stats;
+
+/**
+ * @brief Statistics handler type
+ * @param[in] client_data : void pointer to client data object that is passed to the handler
+ * @param[in] stats : statistics of one entry point, only valid during the call
+ */
+typedef void (*storyboard_stats_handler)(void* client_data, const storyboard_op_stats* stats);
+
+/**
+ * @brief Enables or disables collecting operation statistics for a board
+ * @details Statistics are disabled by default. When disabled, the overhead is one branch per call.
+ * @param[in] board_in : board whose statistics are configured
+ * @param[in] enable : non-zero enables, zero disables collecting statistics
+ * @param[in, out] out_error : error object
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_enable_stats(board_t board_in, int32_t enable, error_t_* out_error);
+
+/**
+ * @brief Returns the operation statistics of a board
+ * @details The handler is called once for each entry point that has been called on the board while statistics were
+ * enabled.
+ * @param[in] board_in : board that is being queried
+ * @param[in] handler : statistics handler
+ * @param[in] client_data : client data that is passed to the handler
+ * @param[in, out] out_error : error object
+ * @return number of entry points reported
+ */
+STORYBOARD_EXPORT
+int32_t storyboard_get_stats(const board_t board_in, storyboard_stats_handler handler, void* client_data,
+                             error_t_* out_error);
+
+/**
+ * @brief Sets the operation statistics of a board to zero
+ * @param[in] board_in : board whose statistics are reset
+ * @param[in, out] out_error : error object
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_reset_stats(board_t board_in, error_t_* out_error);
+
+/**
+ * @brief Trace hook that is called when a note_* or storyboard_* entry point is entered
+ * @param[in] user_data : user data that was given when the hooks were registered
+ * @param[in] operation : name of the entry point, e.g. "storyboard_search_by_tag"
+ * @param[in] board : board the call operates on, NULL for note_* entry points
+ * @return span pointer that is passed to the end hook of the same call, can be NULL
+ */
+typedef void* (*storyboard_trace_begin_handler)(void* user_data, const char* operation, const board_t board);
+
+/**
+ * @brief Trace hook that is called when a note_* or storyboard_* entry point returns
+ * @param[in] user_data : user data that was given when the hooks were registered
+ * @param[in] span : span pointer returned by the begin hook of the same call
+ * @param[in] operation : name of the entry point
+ * @param[in] board : board the call operates on, NULL for note_* entry points
+ * @param[in] nr_results : number of results returned by the call
+ * @param[in] notes_scanned : number of notes examined by the call
+ */
+typedef void (*storyboard_trace_end_handler)(void* user_data, void* span, const char* operation, const board_t board,
+                                             int64_t nr_results, uint64_t notes_scanned);
+
+/**
+ * @brief Registers process wide trace hooks around the note_* and storyboard_* entry points
+ * @details The hooks are called on the thread that makes the call, and they must be thread safe. Either hook can be
+ * NULL. Passing NULL for both removes the hooks, after which the overhead is one branch per call. Calls that are in
+ * progress when the hooks are replaced finish with the hooks they started with. The error reporting functions and
+ * storyboard_set_trace_hooks itself are not traced. If registering fails, the error is available from
+ * storyboard_last_error_code.
+ * @param[in] begin_cb : hook called when an entry point is entered
+ * @param[in] end_cb : hook called when an entry point returns
+ * @param[in] user_data : user data that is passed to the hooks
+ * @return
+ */
+STORYBOARD_EXPORT
+void storyboard_set_trace_hooks(storyboard_trace_begin_handler begin_cb, storyboard_trace_end_handler end_cb,
+                                void* user_data);
+
 #ifdef __cplusplus
 }  // End of extern "C"
 #endif
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <ostream>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <string>
 
@@ -8,8 +14,11 @@
 
 class Note;
 
-using tag_cont_t  = std::vector<std::string>;
-using note_cont_t = std::vector<Note>;
+using tag_cont_t       = std::vector<std::string>;
+using note_cont_t      = std::vector<Note>;
+using tag_stats_cont_t = std::vector<std::pair<std::string, int>>;
+
+using search_completion_t = std::function<void(storyboard_status, note_cont_t&&)>;
 
 /**
  * @class Error
@@ -56,6 +65,212 @@ private:
     Error m_error;
 };
 
+/**
+ * @class StringRef
+ * @brief A non-owning reference to a string, i.e. a pointer and a length
+ */
+class StringRef
+{
+public:
+    /**
+     * @brief Constructor, refers to an empty string
+     */
+    StringRef() : m_data(""), m_size(0)
+    {
+    }
+
+    /**
+     * @brief Constructor with parameters
+     * @param[in] data : pointer to the first character
+     * @param[in] size : number of characters
+     */
+    StringRef(const char* data, std::size_t size) : m_data(data), m_size(size)
+    {
+    }
+
+    /**
+     * @brief Constructor from a NUL-terminated string
+     * @param[in] data : NUL-terminated string
+     */
+    StringRef(const char* data) : m_data(data), m_size(std::strlen(data))
+    {
+    }
+
+    /**
+     * @brief Constructor from a std::string. The string must outlive the reference.
+     * @param[in] str : referenced string
+     */
+    StringRef(const std::string& str) : m_data(str.data()), m_size(str.size())
+    {
+    }
+
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    /**
+     * @brief Copies the referenced characters into a std::string
+     */
+    std::string str() const
+    {
+        return std::string(m_data, m_size);
+    }
+
+    friend bool operator==(const StringRef& lhs, const StringRef& rhs)
+    {
+        return (lhs.m_size == rhs.m_size) && (std::memcmp(lhs.m_data, rhs.m_data, lhs.m_size) == 0);
+    }
+
+    friend bool operator!=(const StringRef& lhs, const StringRef& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const StringRef& ref)
+    {
+        return os.write(ref.m_data, ref.m_size);
+    }
+
+private:
+    const char* m_data;
+    std::size_t m_size;
+};
+
+/**
+ * @class TagsView
+ * @brief A non-owning view of the tags of a note. Valid as long as the storage it refers to is.
+ */
+class TagsView
+{
+public:
+    /**
+     * @class const_iterator
+     * @brief Iterates over the tags as StringRef objects
+     */
+    class const_iterator
+    {
+    public:
+        const_iterator(const TagsView* view, std::size_t index) : m_view(view), m_index(index)
+        {
+        }
+
+        StringRef operator*() const
+        {
+            return (*m_view)[m_index];
+        }
+
+        const_iterator& operator++()
+        {
+            m_index++;
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            return m_index == other.m_index;
+        }
+
+        bool operator!=(const const_iterator& other) const
+        {
+            return m_index != other.m_index;
+        }
+
+    private:
+        const TagsView* m_view;
+        std::size_t     m_index;
+    };
+
+    /**
+     * @brief Constructor, refers to an empty list of tags
+     */
+    TagsView() : m_tags(nullptr), m_lengths(nullptr), m_size(0)
+    {
+    }
+
+    /**
+     * @brief Constructor with parameters
+     * @param[in] tags : array of NUL-terminated tags
+     * @param[in] lengths : array of tag lengths, can be nullptr in which case the lengths are computed on access
+     * @param[in] size : number of tags
+     */
+    TagsView(const char* const* tags, const int32_t* lengths, std::size_t size)
+        : m_tags(tags), m_lengths(lengths), m_size(size)
+    {
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    StringRef operator[](std::size_t index) const
+    {
+        return m_lengths ? StringRef(m_tags[index], m_lengths[index]) : StringRef(m_tags[index]);
+    }
+
+    /**
+     * @brief Returns a tag, with bounds checking
+     * @param[in] index : index of the tag
+     * @return reference to the tag
+     */
+    StringRef at(std::size_t index) const
+    {
+        if (index >= m_size)
+        {
+            throw std::out_of_range("TagsView::at");
+        }
+
+        return (*this)[index];
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, m_size);
+    }
+
+    /**
+     * @brief Copies the tags into a container
+     */
+    tag_cont_t toVector() const
+    {
+        tag_cont_t result;
+        result.reserve(m_size);
+
+        for (std::size_t index = 0; index < m_size; index++)
+        {
+            result.push_back((*this)[index].str());
+        }
+
+        return result;
+    }
+
+private:
+    const char* const* m_tags;
+    const int32_t*     m_lengths;
+    std::size_t        m_size;
+};
+
 /**
  * @class Note
  * @brief A header only C++ API, based on the C API, for the Note object
@@ -76,18 +291,14 @@ public:
      * @param[in] text : Note's text
      * @param[in] tags : Note's tags
      */
-    Note(const std::string& title, const std::string& text, tag_cont_t const& tags)
+    Note(StringRef title, StringRef text, tag_cont_t const& tags)
     {
-        const char** temp = new const char*[tags.size()];
-
-        for (std::size_t index = 0; index < tags.size(); index++)
-        {
-            temp[index] = tags.at(index).c_str();
-        }
+        std::vector<const char*> pointers = tagPointers(tags);
+        std::vector<int32_t>     lengths  = tagLengths(tags);
 
-        m_opaque = note_construct(title.c_str(), text.c_str(), temp, tags.size(), ThrowOnError{});
-
-        delete[] temp;
+        m_opaque = note_construct_n(title.data(), static_cast<int32_t>(title.size()), text.data(),
+                                    static_cast<int32_t>(text.size()), pointers.data(), lengths.data(),
+                                    static_cast<int32_t>(tags.size()), ThrowOnError{});
     }
 
     /**
@@ -137,15 +348,21 @@ public:
      */
     tag_cont_t getTags() const
     {
-        tag_cont_t tags_container;
+        return getTagsView().toVector();
+    }
 
-        auto callback = [](void* client_data, const char* tag) {
-            ((tag_cont_t*)client_data)->push_back(std::string(tag));
-        };
+    /**
+     * @brief Returns a non-owning view of the note's tags
+     * @return view into the note's own storage, valid until the note is destructed or assigned to
+     */
+    TagsView getTagsView() const
+    {
+        const char* const* tags    = nullptr;
+        const int32_t*     lengths = nullptr;
 
-        note_get_tags(m_opaque, callback, &tags_container, ThrowOnError{});
+        int32_t nr_tags = note_get_tags_array(m_opaque, &tags, &lengths, ThrowOnError{});
 
-        return tags_container;
+        return TagsView(tags, lengths, nr_tags);
     }
 
     /**
@@ -154,7 +371,10 @@ public:
      */
     std::string getTitle() const
     {
-        return note_get_title(m_opaque, ThrowOnError{});
+        int32_t     length = 0;
+        const char* title  = note_get_title_n(m_opaque, &length, ThrowOnError{});
+
+        return std::string(title, length);
     }
 
     /**
@@ -163,15 +383,177 @@ public:
      */
     std::string getText() const
     {
-        return note_get_text(m_opaque, ThrowOnError{});
+        int32_t     length = 0;
+        const char* text   = note_get_text_n(m_opaque, &length, ThrowOnError{});
+
+        return std::string(text, length);
     }
 
     friend class StoryBoard;
 
 protected:
+    // The C strings of the tags, valid as long as the tags are
+    static std::vector<const char*> tagPointers(const tag_cont_t& tags)
+    {
+        std::vector<const char*> pointers;
+        pointers.reserve(tags.size());
+
+        for (auto& tag : tags)
+        {
+            pointers.push_back(tag.c_str());
+        }
+
+        return pointers;
+    }
+
+    // The lengths of the tags, in the order of tagPointers()
+    static std::vector<int32_t> tagLengths(const tag_cont_t& tags)
+    {
+        std::vector<int32_t> lengths;
+        lengths.reserve(tags.size());
+
+        for (auto& tag : tags)
+        {
+            lengths.push_back(static_cast<int32_t>(tag.size()));
+        }
+
+        return lengths;
+    }
+
     note_t m_opaque;
 };
 
+/**
+ * @class NoteView
+ * @brief A non-owning view of a note stored in a StoryBoard
+ * @details Search results are passed as NoteView objects that refer directly to the board storage, and are only valid
+ * during the callback they are passed to. Call toNote() to get a copy that outlives the callback.
+ */
+class NoteView
+{
+public:
+    /**
+     * @brief Constructor with parameters
+     * @param[in] title : Note's title
+     * @param[in] text : Note's text
+     * @param[in] tags : Note's tags
+     */
+    NoteView(StringRef title, StringRef text, TagsView tags) : m_title(title), m_text(text), m_tags(tags)
+    {
+    }
+
+    /**
+     * @brief Returns title
+     * @return reference to the note's title
+     */
+    StringRef getTitle() const
+    {
+        return m_title;
+    }
+
+    /**
+     * @brief Returns text
+     * @return reference to the note's text
+     */
+    StringRef getText() const
+    {
+        return m_text;
+    }
+
+    /**
+     * @brief Returns tags
+     * @return view of the note's tags
+     */
+    TagsView getTags() const
+    {
+        return m_tags;
+    }
+
+    /**
+     * @brief Copies the viewed note into a new Note object
+     * @return a Note that is independent of the board
+     */
+    Note toNote() const
+    {
+        return Note(m_title, m_text, m_tags.toVector());
+    }
+
+private:
+    StringRef m_title;
+    StringRef m_text;
+    TagsView  m_tags;
+};
+
+/**
+ * @class SearchHandle
+ * @brief Owns the handle of an asynchronous search. Releasing the handle does not cancel the search.
+ */
+class SearchHandle
+{
+public:
+    /**
+     * @brief Constructor
+     * @param[in] opaque : handle that is owned from now on
+     */
+    explicit SearchHandle(search_t opaque = nullptr) : m_opaque(opaque)
+    {
+    }
+
+    /**
+     * @brief Move constructor
+     * @param[in] other : object being moved
+     */
+    SearchHandle(SearchHandle&& other) : m_opaque(other.m_opaque)
+    {
+        other.m_opaque = nullptr;
+    }
+
+    /**
+     * @brief Move assignment operator
+     * @param[in] other : object being moved
+     * @return this
+     */
+    SearchHandle& operator=(SearchHandle&& other)
+    {
+        std::swap(m_opaque, other.m_opaque);
+        return *this;
+    }
+
+    SearchHandle(const SearchHandle&)            = delete;
+    SearchHandle& operator=(const SearchHandle&) = delete;
+
+    /**
+     * @brief Destructor
+     */
+    ~SearchHandle()
+    {
+        if (m_opaque)
+        {
+            search_destruct(m_opaque);
+        }
+    }
+
+    /**
+     * @brief Cancels the search
+     * @return true if the completion will be called with STORYBOARD_ERROR_CANCELLED
+     */
+    bool cancel()
+    {
+        return search_cancel(m_opaque, ThrowOnError{}) != 0;
+    }
+
+    /**
+     * @brief Waits until the completion has returned
+     */
+    void wait()
+    {
+        search_wait(m_opaque, ThrowOnError{});
+    }
+
+private:
+    search_t m_opaque;
+};
+
 /**
  * @class StoryBoard
  * @brief A header only C++ API, based on the C API, for the StoryBoard object
@@ -187,6 +569,15 @@ public:
         m_opaque = storyboard_construct(ThrowOnError{});
     }
 
+    /**
+     * @brief Constructor of a sharded board
+     * @param[in] nr_shards : number of shards the notes are split into
+     */
+    explicit StoryBoard(int nr_shards)
+    {
+        m_opaque = storyboard_construct_sharded(nr_shards, ThrowOnError{});
+    }
+
     /**
      * @brief Copy constructor
      * @param[in] other : object being copied
@@ -231,10 +622,61 @@ public:
     /**
      * @brief Adds a new note object into the Storyboard
      * @param[in] : newNote note to be added into the Storyboard
+     * @return false if the note was rejected as a duplicate, see setRejectDuplicates()
+     */
+    bool addNote(const Note& newNote)
+    {
+        return storyboard_add_note_checked(m_opaque, newNote.m_opaque, ThrowOnError{}) != 0;
+    }
+
+    /**
+     * @brief Sets whether the board rejects notes that are equal to a note it already stores
+     * @param[in] reject : true to reject duplicates, they are accepted by default
      */
-    void addNote(const Note& newNote)
+    void setRejectDuplicates(bool reject)
     {
-        storyboard_add_note(m_opaque, newNote.m_opaque, ThrowOnError{});
+        storyboard_set_reject_duplicates(m_opaque, reject, ThrowOnError{});
+    }
+
+    /**
+     * @brief Appends copies of the notes of another board
+     * @param[in] source : board whose notes are copied, can be this one
+     * @param[in] policy : whether notes equal to a stored note are skipped
+     * @return number of notes appended
+     */
+    int merge(const StoryBoard& source, storyboard_merge_policy policy = STORYBOARD_MERGE_KEEP_ALL)
+    {
+        return storyboard_merge(m_opaque, source.m_opaque, policy, ThrowOnError{});
+    }
+
+    /**
+     * @brief Reports the notes that turn this board into another one, see storyboard_diff()
+     * @param[in] other : board compared with this one
+     * @param[in] fn : called with the kind of the difference and a NoteView for each note that is only in one of the
+     * boards. The view is only valid during the call.
+     * @return number of notes reported
+     */
+    template <typename Fn>
+    int diff(const StoryBoard& other, Fn&& fn) const
+    {
+        return storyboard_diff(m_opaque, other.m_opaque, diffCallback<Fn>, &fn, ThrowOnError{});
+    }
+
+    /**
+     * @brief Queues a note for adding into the Storyboard without waiting. Can be called from many threads at once.
+     * @param[in] : newNote note to be added into the Storyboard
+     */
+    void enqueueNote(const Note& newNote)
+    {
+        storyboard_enqueue_note(m_opaque, newNote.m_opaque, ThrowOnError{});
+    }
+
+    /**
+     * @brief Waits until the notes queued by this thread are visible to searches
+     */
+    void flush()
+    {
+        storyboard_flush(m_opaque, ThrowOnError{});
     }
 
     /**
@@ -248,27 +690,58 @@ public:
         return storyboard_delete_note(m_opaque, deleteMe.m_opaque, ThrowOnError{});
     }
 
+    /**
+     * @brief Removes all the notes whose title is the given string
+     * @param[in] title : title that is matched
+     * @return number of elements that were deleted
+     */
+    int deleteByTitle(StringRef title)
+    {
+        return storyboard_delete_by_title_n(m_opaque, title.data(), static_cast<int32_t>(title.size()), ThrowOnError{});
+    }
+
+    /**
+     * @brief Removes all the notes whose text contains the given string
+     * @param[in] text : text that is matched
+     * @return number of elements that were deleted
+     */
+    int deleteByText(StringRef text)
+    {
+        return storyboard_delete_by_text_n(m_opaque, text.data(), static_cast<int32_t>(text.size()), ThrowOnError{});
+    }
+
+    /**
+     * @brief Removes all the notes that carry the given tag
+     * @param[in] tag : tag that is matched
+     * @return number of elements that were deleted
+     */
+    int deleteByTag(StringRef tag)
+    {
+        return storyboard_delete_by_tag_n(m_opaque, tag.data(), static_cast<int32_t>(tag.size()), ThrowOnError{});
+    }
+
     /**
      * @brief Search the Storyboard for notes that contain the given string in the title field
      * @param[in] title : string that is matched
      * @param[in,out] container : notes in the Storyboard that contain the matched field are added into this container
      * @return number of results
      */
-    int searchByTitle(const std::string& title, note_cont_t& container)
+    int searchByTitle(StringRef title, note_cont_t& container)
     {
-        // A callback function that is called for each query result
-        auto callback = [](void* client_data, const char* name, const char* text, const char* tags[], int32_t nr_tags) {
-            std::vector<std::string> tags_vector;
-
-            for (size_t index = 0; index < nr_tags; index++)
-            {
-                tags_vector.push_back(std::string(tags[index]));
-            }
-
-            ((note_cont_t*)client_data)->push_back(Note{std::string(name), std::string(text), tags_vector});
-        };
+        return searchByTitle(title, [&container](const NoteView& view) { container.push_back(view.toNote()); });
+    }
 
-        return storyboard_search_by_title(m_opaque, title.c_str(), callback, &container, ThrowOnError{});
+    /**
+     * @brief Search the Storyboard for notes that contain the given string in the title field, without copying them
+     * @param[in] title : string that is matched
+     * @param[in] fn : called with a NoteView for each matching note. The view is only valid during the call.
+     * @return number of results
+     */
+    template <typename Fn>
+    int searchByTitle(StringRef title, Fn&& fn)
+    {
+        return storyboard_search_by_title_n(m_opaque, title.data(), static_cast<int32_t>(title.size()),
+                                            viewCallback<Fn>, &fn, ThrowOnError{});
     }
 
     /**
@@ -277,21 +750,22 @@ public:
      * @param[in,out] container : notes in the Storyboard that contain the matched field are added into this container
      * @return number of results
      */
-    int searchByText(const std::string& text, note_cont_t& container)
+    int searchByText(StringRef text, note_cont_t& container)
     {
-        // A callback function that is called for each query result
-        auto callback = [](void* client_data, const char* name, const char* text, const char* tags[], int32_t nr_tags) {
-            std::vector<std::string> tags_vector;
-
-            for (size_t index = 0; index < nr_tags; index++)
-            {
-                tags_vector.push_back(std::string(tags[index]));
-            }
-
-            ((note_cont_t*)client_data)->push_back(Note{std::string(name), std::string(text), tags_vector});
-        };
+        return searchByText(text, [&container](const NoteView& view) { container.push_back(view.toNote()); });
+    }
 
-        return storyboard_search_by_text(m_opaque, text.c_str(), callback, &container, ThrowOnError{});
+    /**
+     * @brief Search the Storyboard for notes that contain the given string in the text field, without copying them
+     * @param[in] text : string that is matched
+     * @param[in] fn : called with a NoteView for each matching note. The view is only valid during the call.
+     * @return number of results
+     */
+    template <typename Fn>
+    int searchByText(StringRef text, Fn&& fn)
+    {
+        return storyboard_search_by_text_n(m_opaque, text.data(), static_cast<int32_t>(text.size()),
+                                           viewCallback<Fn>, &fn, ThrowOnError{});
     }
 
     /**
@@ -300,21 +774,140 @@ public:
      * @param[in,out] container : notes in the Storyboard that contain the matched field are added into this container
      * @return number of results
      */
-    int searchByTag(const std::string& tag, note_cont_t& container)
+    int searchByTag(StringRef tag, note_cont_t& container)
     {
-        // A callback function that is called for each query result
-        auto callback = [](void* client_data, const char* name, const char* text, const char* tags[], int32_t nr_tags) {
-            std::vector<std::string> tags_vector;
+        return searchByTag(tag, [&container](const NoteView& view) { container.push_back(view.toNote()); });
+    }
 
-            for (size_t index = 0; index < nr_tags; index++)
-            {
-                tags_vector.push_back(std::string(tags[index]));
-            }
+    /**
+     * @brief Search the Storyboard for notes that contain the given string in the tag field, without copying them
+     * @param[in] tag : string that is matched
+     * @param[in] fn : called with a NoteView for each matching note. The view is only valid during the call.
+     * @return number of results
+     */
+    template <typename Fn>
+    int searchByTag(StringRef tag, Fn&& fn)
+    {
+        return storyboard_search_by_tag_n(m_opaque, tag.data(), static_cast<int32_t>(tag.size()),
+                                          viewCallback<Fn>, &fn, ThrowOnError{});
+    }
 
-            ((note_cont_t*)client_data)->push_back(Note{std::string(name), std::string(text), tags_vector});
-        };
+    /**
+     * @brief Search the Storyboard container for notes that carry any or all of the given tags
+     * @param[in] tags : tags that are matched
+     * @param[in] match : whether a note has to carry any or all of the tags
+     * @param[in,out] container : notes in the Storyboard that match are added into this container
+     * @return number of results
+     */
+    int searchByTags(const tag_cont_t& tags, storyboard_tag_match match, note_cont_t& container)
+    {
+        return searchByTags(tags, match, [&container](const NoteView& view) { container.push_back(view.toNote()); });
+    }
 
-        return storyboard_search_by_tag(m_opaque, tag.c_str(), callback, &container, ThrowOnError{});
+    /**
+     * @brief Search the Storyboard for notes that carry any or all of the given tags, without copying them
+     * @param[in] tags : tags that are matched
+     * @param[in] match : whether a note has to carry any or all of the tags
+     * @param[in] fn : called with a NoteView for each matching note. The view is only valid during the call.
+     * @return number of results
+     */
+    template <typename Fn>
+    int searchByTags(const tag_cont_t& tags, storyboard_tag_match match, Fn&& fn)
+    {
+        std::vector<const char*> query   = Note::tagPointers(tags);
+        std::vector<int32_t>     lengths = Note::tagLengths(tags);
+
+        return storyboard_search_by_tags_n(m_opaque, query.data(), lengths.data(), static_cast<int32_t>(query.size()),
+                                           match, viewCallback<Fn>, &fn, ThrowOnError{});
+    }
+
+    /**
+     * @brief Starts a search on a worker thread and returns without waiting for it
+     * @param[in] kind : kind of the query
+     * @param[in] key : title, text or tag being queried
+     * @param[in] completion : called once on the worker thread, with copies of the matching notes, or with
+     * STORYBOARD_ERROR_CANCELLED and no notes if the search is cancelled
+     * @return handle of the search
+     */
+    SearchHandle searchAsync(storyboard_query_kind kind, const std::string& key, search_completion_t completion)
+    {
+        std::unique_ptr<search_completion_t> context(new search_completion_t(std::move(completion)));
+
+        SearchHandle handle(storyboard_search_async(m_opaque, kind, key.c_str(), searchCompletionCallback,
+                                                    context.get(), ThrowOnError{}));
+
+        // From now on the context is owned by the callback
+        context.release();
+        return handle;
+    }
+
+    /**
+     * @brief Counts the notes that contain the given string in the title field
+     * @param[in] title : string that is matched
+     * @return number of matching notes
+     */
+    int countByTitle(StringRef title) const
+    {
+        return storyboard_count_by_title_n(m_opaque, title.data(), static_cast<int32_t>(title.size()), ThrowOnError{});
+    }
+
+    /**
+     * @brief Counts the notes that contain the given string in the text field
+     * @param[in] text : string that is matched
+     * @return number of matching notes
+     */
+    int countByText(StringRef text) const
+    {
+        return storyboard_count_by_text_n(m_opaque, text.data(), static_cast<int32_t>(text.size()), ThrowOnError{});
+    }
+
+    /**
+     * @brief Counts the notes that contain the given string in the tag field
+     * @param[in] tag : string that is matched
+     * @return number of matching notes
+     */
+    int countByTag(StringRef tag) const
+    {
+        return storyboard_count_by_tag_n(m_opaque, tag.data(), static_cast<int32_t>(tag.size()), ThrowOnError{});
+    }
+
+    /**
+     * @brief Counts the notes that carry any or all of the given tags
+     * @param[in] tags : tags that are matched
+     * @param[in] match : whether a note has to carry any or all of the tags
+     * @return number of matching notes
+     */
+    int countByTags(const tag_cont_t& tags, storyboard_tag_match match) const
+    {
+        std::vector<const char*> query   = Note::tagPointers(tags);
+        std::vector<int32_t>     lengths = Note::tagLengths(tags);
+
+        return storyboard_count_by_tags_n(m_opaque, query.data(), lengths.data(), static_cast<int32_t>(query.size()),
+                                          match, ThrowOnError{});
+    }
+
+    /**
+     * @brief Returns the number of notes carrying each tag
+     * @return (tag, number of notes) pairs, in unspecified order
+     */
+    tag_stats_cont_t getTagStats() const
+    {
+        tag_stats_cont_t stats;
+        storyboard_get_tag_stats(m_opaque, tagStatsCallback, &stats, ThrowOnError{});
+        return stats;
+    }
+
+    /**
+     * @brief Returns the number of notes carrying each tag, restricted to the notes matching a query
+     * @param[in] kind : kind of the query
+     * @param[in] key : title, text or tag being queried
+     * @return (tag, number of matching notes) pairs, in unspecified order
+     */
+    tag_stats_cont_t getTagFacets(storyboard_query_kind kind, const std::string& key) const
+    {
+        tag_stats_cont_t stats;
+        storyboard_get_tag_facets(m_opaque, kind, key.c_str(), tagStatsCallback, &stats, ThrowOnError{});
+        return stats;
     }
 
     /**
@@ -326,6 +919,169 @@ public:
         return storyboard_get_nr_notes(m_opaque, ThrowOnError{});
     }
 
+    /**
+     * @brief Sets the maximum number of query results that are cached. Caching is disabled by default.
+     * @param[in] capacity : maximum number of cached query results, 0 disables the cache
+     */
+    void setQueryCacheCapacity(int capacity)
+    {
+        storyboard_set_query_cache_capacity(m_opaque, capacity, ThrowOnError{});
+    }
+
+    /**
+     * @brief Returns the statistics of the query result cache
+     * @return query cache statistics
+     */
+    storyboard_cache_stats getQueryCacheStats() const
+    {
+        storyboard_cache_stats stats;
+        storyboard_get_query_cache_stats(m_opaque, &stats, ThrowOnError{});
+        return stats;
+    }
+
+    /**
+     * @brief Enables Bloom filters over blocks of notes, so that title queries skip the blocks that cannot match
+     * @param[in] block_size : number of notes per block, 0 disables the filters
+     * @param[in] false_positive_rate : target rate of blocks that are scanned without containing a match, in (0, 1)
+     */
+    void setBlockFilter(int block_size, double false_positive_rate)
+    {
+        storyboard_set_block_filter(m_opaque, block_size, false_positive_rate, ThrowOnError{});
+    }
+
+    /**
+     * @brief Sets whether the board stores the texts of its notes compressed, see storyboard_set_text_compression()
+     * @param[in] enable : true to compress the texts, they are not compressed by default
+     */
+    void setTextCompression(bool enable)
+    {
+        storyboard_set_text_compression(m_opaque, enable ? 1 : 0, ThrowOnError{});
+    }
+
+    /**
+     * @brief Sets a memory budget, past which texts are moved to disk, see storyboard_set_memory_budget()
+     * @param[in] budget : budget in bytes, 0 removes it
+     * @param[in] directory : existing directory the segment files are created in
+     */
+    void setMemoryBudget(std::uint64_t budget, const std::string& directory)
+    {
+        storyboard_set_memory_budget(m_opaque, budget, directory.c_str(), ThrowOnError{});
+    }
+
+    /**
+     * @brief Sets how notes are deleted from the board
+     * @param[in] mode : STORYBOARD_DELETE_ERASE or STORYBOARD_DELETE_TOMBSTONE
+     */
+    void setDeleteMode(storyboard_delete_mode mode)
+    {
+        storyboard_set_delete_mode(m_opaque, mode, ThrowOnError{});
+    }
+
+    /**
+     * @brief Removes the deleted notes that are waiting for compaction
+     * @return number of deleted notes that were removed
+     */
+    int compact()
+    {
+        return storyboard_compact(m_opaque, ThrowOnError{});
+    }
+
+    /**
+     * @brief Enables compacting the board on a background thread
+     * @param[in] threshold : ratio of deleted notes to all stored notes that triggers a compaction, 0 disables
+     */
+    void setAutoCompaction(double threshold)
+    {
+        storyboard_set_auto_compaction(m_opaque, threshold, ThrowOnError{});
+    }
+
+    /**
+     * @brief Returns the approximate memory used by the board
+     * @return memory usage in bytes
+     */
+    storyboard_memory_stats getMemoryUsage() const
+    {
+        storyboard_memory_stats stats;
+        storyboard_memory_usage(m_opaque, &stats, ThrowOnError{});
+        return stats;
+    }
+
+    /**
+     * @brief Enables or disables collecting operation statistics
+     * @param[in] enable : true enables, false disables collecting statistics
+     */
+    void enableStats(bool enable)
+    {
+        storyboard_enable_stats(m_opaque, enable ? 1 : 0, ThrowOnError{});
+    }
+
+    /**
+     * @brief Returns the operation statistics, one entry for each operation that has been called
+     * @return operation statistics
+     */
+    std::vector<storyboard_op_stats> getStats() const
+    {
+        std::vector<storyboard_op_stats> stats;
+
+        auto callback = [](void* client_data, const storyboard_op_stats* op_stats) {
+            ((std::vector<storyboard_op_stats>*)client_data)->push_back(*op_stats);
+        };
+
+        storyboard_get_stats(m_opaque, callback, &stats, ThrowOnError{});
+        return stats;
+    }
+
+    /**
+     * @brief Sets the operation statistics to zero
+     */
+    void resetStats()
+    {
+        storyboard_reset_stats(m_opaque, ThrowOnError{});
+    }
+
 private:
+    // A callback function that is called for each query result, passes a NoteView to the function object
+    template <typename Fn>
+    static void viewCallback(void* client_data, const char* title, int32_t title_length, const char* text,
+                             int32_t text_length, const char* const* tags, const int32_t* tag_lengths, int32_t nr_tags)
+    {
+        (*(typename std::remove_reference<Fn>::type*)client_data)(NoteView(
+            StringRef(title, title_length), StringRef(text, text_length), TagsView(tags, tag_lengths, nr_tags)));
+    }
+
+    // A callback function that is called for each difference between two boards, see viewCallback
+    template <typename Fn>
+    static void diffCallback(void* client_data, storyboard_diff_kind kind, const char* title, int32_t title_length,
+                             const char* text, int32_t text_length, const char* const* tags,
+                             const int32_t* tag_lengths, int32_t nr_tags)
+    {
+        (*(typename std::remove_reference<Fn>::type*)client_data)(
+            kind, NoteView(StringRef(title, title_length), StringRef(text, text_length),
+                           TagsView(tags, tag_lengths, nr_tags)));
+    }
+
+    // A callback function that is called when an asynchronous search completes, copies the results into Note objects
+    static void searchCompletionCallback(void* user_data, storyboard_status status, const note_t* notes,
+                                         int32_t nr_notes)
+    {
+        std::unique_ptr<search_completion_t> completion((search_completion_t*)user_data);
+        note_cont_t                          results;
+
+        for (int32_t index = 0; index < nr_notes; index++)
+        {
+            Note result;
+            result.m_opaque = note_copy(notes[index], nullptr);
+            results.push_back(std::move(result));
+        }
+
+        (*completion)(status, std::move(results));
+    }
+
+    // A callback function that is called for each tag statistics entry
+    static void tagStatsCallback(void* client_data, const char* tag, int32_t nr_notes)
+    {
+        ((tag_stats_cont_t*)client_data)->push_back(std::make_pair(std::string(tag), nr_notes));
+    }
+
     board_t m_opaque;
 };
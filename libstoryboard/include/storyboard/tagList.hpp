@@ -0,0 +1,451 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace storyboard {
+
+/**
+ * @class TagTable
+ * @brief Process-wide table of interned tags
+ * @details Each distinct tag string is stored once, and notes refer to it by pointer. Two tags are equal if and only if
+ * their interned pointers are equal. Interned tags are reference counted, and a tag leaves the table when its last
+ * reference is released, so the table only holds the tags that are in use. All the functions are thread safe. The
+ * table is split into shards by the hash of the tags, each with its own lock, so that threads interning or looking up
+ * different tags seldom wait for each other.
+ */
+class TagTable
+{
+public:
+    /**
+     * @brief Returns the interned copy of the tag, adding it to the table if needed
+     * @details The caller holds a reference to the tag, see release().
+     */
+    static const std::string* intern(const std::string& tag);
+
+    /**
+     * @brief Returns the interned copy of the tag, or nullptr if no one holds a reference to it
+     * @details The caller holds a reference to the tag if it is found, see release().
+     */
+    static const std::string* find(const std::string& tag);
+
+    /**
+     * @brief Takes another reference to an interned tag the caller already holds a reference to
+     */
+    static void acquire(const std::string* tag)
+    {
+        static_cast<const Entry*>(tag)->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Releases a reference to an interned tag, the tag is removed from the table with its last reference
+     */
+    static void release(const std::string* tag)
+    {
+        std::atomic<std::uint32_t>& refs  = static_cast<const Entry*>(tag)->refs;
+        std::uint32_t               count = refs.load(std::memory_order_relaxed);
+
+        // Only the last reference is released under the lock of the table, so that a lookup never finds a tag that is
+        // being removed
+        while (count > 1)
+        {
+            if (refs.compare_exchange_weak(count, count - 1, std::memory_order_release, std::memory_order_relaxed))
+            {
+                return;
+            }
+        }
+
+        releaseLast(tag);
+    }
+
+    /**
+     * @brief Memory used by the table for an interned tag, i.e. its entry and the payload of the tag
+     */
+    static std::size_t bytes(const std::string* tag);
+
+private:
+    /**
+     * @brief An interned tag and the number of references to it
+     */
+    struct Entry : std::string
+    {
+        explicit Entry(const std::string& tag) : std::string(tag)
+        {
+        }
+
+        mutable std::atomic<std::uint32_t> refs{1};  /// References held by the tag lists and the lookups
+    };
+
+    struct Shard;
+
+    /**
+     * @brief Returns the shard that holds the tag
+     */
+    static Shard& shard(const std::string& tag);
+
+    static void releaseLast(const std::string* tag);
+};
+
+/**
+ * @class TagRef
+ * @brief Holds a reference to an interned tag that is looked up, so that it stays in the table while it is used
+ */
+class TagRef
+{
+public:
+    /**
+     * @brief Looks up the tag without adding it to the table, see TagTable::find()
+     */
+    explicit TagRef(const std::string& tag) : m_tag(TagTable::find(tag))
+    {
+    }
+
+    TagRef(TagRef&& other) noexcept : m_tag(other.m_tag)
+    {
+        other.m_tag = nullptr;
+    }
+
+    ~TagRef()
+    {
+        if (m_tag)
+        {
+            TagTable::release(m_tag);
+        }
+    }
+
+    TagRef(const TagRef&) = delete;
+    TagRef& operator=(const TagRef&) = delete;
+    TagRef& operator=(TagRef&&) = delete;
+
+    /**
+     * @brief Returns the interned tag, or nullptr if it is not in the table
+     */
+    const std::string* get() const
+    {
+        return m_tag;
+    }
+
+private:
+    const std::string* m_tag;  /// Interned tag, nullptr if not found
+};
+
+/**
+ * @class TagList
+ * @brief The tags of a note, as pointers to interned tags
+ * @details Up to INLINE_CAPACITY tags are stored inside the object, so typical notes need no allocation for their tags
+ * and copying them copies a few pointers. The list holds a reference to each of its tags, see TagTable.
+ */
+class TagList
+{
+public:
+    static const std::size_t INLINE_CAPACITY = 4;
+
+    /**
+     * @class const_iterator
+     * @brief Iterates over the tags as strings
+     */
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = std::string;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const std::string*;
+        using reference         = const std::string&;
+
+        explicit const_iterator(const std::string* const* tag = nullptr) : m_tag(tag)
+        {
+        }
+
+        reference operator*() const
+        {
+            return **m_tag;
+        }
+
+        pointer operator->() const
+        {
+            return *m_tag;
+        }
+
+        const_iterator& operator++()
+        {
+            ++m_tag;
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            ++m_tag;
+            return previous;
+        }
+
+        const_iterator& operator--()
+        {
+            --m_tag;
+            return *this;
+        }
+
+        const_iterator& operator+=(difference_type offset)
+        {
+            m_tag += offset;
+            return *this;
+        }
+
+        const_iterator operator+(difference_type offset) const
+        {
+            return const_iterator(m_tag + offset);
+        }
+
+        difference_type operator-(const const_iterator& other) const
+        {
+            return m_tag - other.m_tag;
+        }
+
+        reference operator[](difference_type offset) const
+        {
+            return *m_tag[offset];
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            return m_tag == other.m_tag;
+        }
+
+        bool operator!=(const const_iterator& other) const
+        {
+            return m_tag != other.m_tag;
+        }
+
+        bool operator<(const const_iterator& other) const
+        {
+            return m_tag < other.m_tag;
+        }
+
+    private:
+        const std::string* const* m_tag;
+    };
+
+    TagList()
+    {
+    }
+
+    /**
+     * @brief Constructor, interns the given tags
+     */
+    TagList(const std::vector<std::string>& tags);
+
+    // The copy and move operations are inline, since notes are copied and moved around a lot when a board changes
+    TagList(const TagList& other)
+    {
+        assign(other);
+    }
+
+    TagList(TagList&& other) noexcept
+    {
+        steal(other);
+    }
+
+    ~TagList()
+    {
+        release();
+    }
+
+    TagList& operator=(const TagList& other)
+    {
+        if (this != &other)
+        {
+            release();
+            assign(other);
+        }
+
+        return *this;
+    }
+
+    TagList& operator=(TagList&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            steal(other);
+        }
+
+        return *this;
+    }
+
+    /**
+     * @brief Interns the tag and appends it to the list
+     */
+    void push_back(const std::string& tag);
+
+    /**
+     * @brief Sorts the tags by value and removes the duplicates
+     * @details Two normalized lists can be intersected with a single merge, see before().
+     */
+    void normalize();
+
+    /**
+     * @brief Order of the tags of a normalized list
+     */
+    static bool before(const std::string* lhs, const std::string* rhs)
+    {
+        return *lhs < *rhs;
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(data());
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(data() + m_size);
+    }
+
+    const std::string& operator[](std::size_t index) const
+    {
+        return *data()[index];
+    }
+
+    /**
+     * @brief Returns the interned pointer of a tag
+     */
+    const std::string* interned(std::size_t index) const
+    {
+        return data()[index];
+    }
+
+    /**
+     * @brief Returns true if the list contains the interned tag
+     */
+    bool contains(const std::string* tag) const
+    {
+        const std::string* const* tags = data();
+
+        for (std::uint32_t index = 0; index < m_size; index++)
+        {
+            if (tags[index] == tag)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Bytes allocated outside the object, 0 while the tags fit inline
+     */
+    std::size_t heapBytes() const
+    {
+        return m_capacity > INLINE_CAPACITY ? m_capacity * sizeof(const std::string*) : 0;
+    }
+
+    /**
+     * @brief Copies the tags into a vector of strings
+     */
+    std::vector<std::string> toVector() const
+    {
+        return std::vector<std::string>(begin(), end());
+    }
+
+    friend bool operator==(const TagList& lhs, const TagList& rhs)
+    {
+        return (lhs.m_size == rhs.m_size) && std::equal(lhs.data(), lhs.data() + lhs.m_size, rhs.data());
+    }
+
+    friend bool operator!=(const TagList& lhs, const TagList& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    const std::string* const* data() const
+    {
+        return m_capacity > INLINE_CAPACITY ? m_heap : m_inline;
+    }
+
+    const std::string** data()
+    {
+        return m_capacity > INLINE_CAPACITY ? m_heap : m_inline;
+    }
+
+    void assign(const TagList& other)
+    {
+        std::uint32_t capacity = other.m_size > INLINE_CAPACITY ? other.m_size : INLINE_CAPACITY;
+
+        if (capacity > INLINE_CAPACITY)
+        {
+            m_heap = new const std::string*[capacity];
+        }
+
+        m_size     = other.m_size;
+        m_capacity = capacity;
+        std::copy(other.data(), other.data() + m_size, data());
+
+        for (std::uint32_t index = 0; index < m_size; index++)
+        {
+            TagTable::acquire(data()[index]);
+        }
+    }
+
+    void steal(TagList& other)
+    {
+        m_size     = other.m_size;
+        m_capacity = other.m_capacity;
+
+        if (m_capacity > INLINE_CAPACITY)
+        {
+            m_heap = other.m_heap;
+        }
+        else
+        {
+            std::copy(other.m_inline, other.m_inline + m_size, m_inline);
+        }
+
+        // The heap storage, if any, now belongs to this object
+        other.m_size     = 0;
+        other.m_capacity = INLINE_CAPACITY;
+    }
+
+    void release()
+    {
+        for (std::uint32_t index = 0; index < m_size; index++)
+        {
+            TagTable::release(data()[index]);
+        }
+
+        if (m_capacity > INLINE_CAPACITY)
+        {
+            delete[] m_heap;
+            m_capacity = INLINE_CAPACITY;
+        }
+
+        m_size = 0;
+    }
+
+    std::uint32_t m_size     = 0;                /// Number of tags
+    std::uint32_t m_capacity = INLINE_CAPACITY;  /// Number of tags that fit before the storage has to grow
+    union
+    {
+        const std::string*  m_inline[INLINE_CAPACITY];  /// Tags, while they fit inline
+        const std::string** m_heap;                     /// Tags, after the storage has grown
+    };
+};
+
+}  // End of namespace storyboard
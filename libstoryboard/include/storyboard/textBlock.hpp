@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <storyboard/segmentFile.hpp>
+
+namespace storyboard {
+
+/**
+ * @class TextDictionary
+ * @brief Byte strings that recur in the texts of a Storyboard, used as the initial history of its compressed blocks
+ * @details Trained once from a sample of the texts: the sample is split into as many epochs as the dictionary has
+ * segments, and the segment of each epoch whose 8-byte sequences are the most frequent in the whole sample is kept.
+ * Sequences that are already covered by a kept segment do not count again, so the segments do not repeat each other.
+ */
+class TextDictionary
+{
+public:
+    static const std::size_t MAX_BYTES        = 16 * 1024;    /// Size of a trained dictionary, at most
+    static const std::size_t MAX_SAMPLE_BYTES = 1024 * 1024;  /// Texts beyond this are not sampled
+
+    /**
+     * @brief Trains a dictionary on the given texts
+     * @param[in] texts : sample of the texts, only the first MAX_SAMPLE_BYTES bytes are used
+     */
+    static std::shared_ptr<const TextDictionary> train(const std::vector<const std::string*>& texts);
+
+    const std::string& data() const
+    {
+        return m_data;
+    }
+
+    /**
+     * @brief Memory used by the dictionary
+     */
+    std::size_t bytes() const;
+
+private:
+    std::string m_data;  /// Segments, the most frequent last so that they are matched at the shortest distances
+};
+
+/**
+ * @class TextBlock
+ * @brief The texts of consecutive notes, compressed together
+ * @details The texts are concatenated and compressed with an LZ77 scheme whose history starts with the dictionary, so
+ * that even the first text of a block is matched against the boilerplate of the board. A block is immutable and is
+ * shared by the notes whose texts it holds, and by their copies, so it lives as long as the last of them. A block
+ * without dictionary holds the texts as they are.
+ *
+ * A block can be spilled: its copy keeps only the offsets of the texts in memory, the data being in a SegmentFile.
+ *
+ * Texts are decompressed a block at a time into a small cache of the calling thread. Scanning the notes in order hits
+ * the same block until all its texts have been seen, and the texts of the blocks that queries keep returning stay
+ * decompressed. The cache does not keep the blocks alive, so a block and its segment file go away with the last note
+ * holding them, and the texts of blocks that went away are released by the next miss of the cache.
+ */
+class TextBlock : public std::enable_shared_from_this<TextBlock>
+{
+public:
+    static const std::size_t TARGET_BYTES = 32 * 1024;  /// Texts are grouped into blocks of about this size
+    static const std::size_t CACHE_SIZE   = 8;          /// Decompressed blocks cached by each thread
+
+    /**
+     * @brief Compresses texts into a new block
+     * @param[in] texts : texts of the block, in the order of their notes
+     * @param[in] dictionary : history the compression starts with, nullptr to store the texts uncompressed
+     */
+    static std::shared_ptr<const TextBlock> compress(const std::vector<const std::string*>& texts,
+                                                     std::shared_ptr<const TextDictionary> dictionary);
+
+    /**
+     * @brief Returns a copy of a text of the block, decompressing the block if it is not in the cache of the calling
+     * thread
+     * @details The data of a spilled block is read back from its segment file first.
+     * @param[in] index : position of the text in the block
+     */
+    std::string text(std::uint32_t index) const;
+
+    /**
+     * @brief Returns a text of the block without copying it, decompressing the block like text()
+     * @details The pointer keeps the decompressed texts of the block alive, however many other blocks the calling
+     * thread decompresses meanwhile.
+     * @param[in] index : position of the text in the block
+     */
+    std::shared_ptr<const std::string> pin(std::uint32_t index) const;
+
+    /**
+     * @brief Memory attributed to a text: its share of the block, in proportion to its uncompressed size
+     */
+    std::size_t storedBytes(std::uint32_t index) const;
+
+    /**
+     * @brief Bytes of the segment file attributed to a text, in proportion to its uncompressed size. 0 if the block is
+     * in memory.
+     */
+    std::size_t spilledBytes(std::uint32_t index) const;
+
+    /**
+     * @brief Writes the data of the block to a segment file
+     * @return a block with the same texts, whose data is in the file
+     */
+    std::shared_ptr<const TextBlock> spill(const std::shared_ptr<SegmentFile>& segment) const;
+
+    /**
+     * @brief Reads the data of a spilled block back
+     * @return a block with the same texts, whose data is in memory
+     */
+    std::shared_ptr<const TextBlock> load() const;
+
+    bool spilled() const
+    {
+        return m_segment != nullptr;
+    }
+
+    /**
+     * @brief Value of a global clock when a thread last started reading the texts of the block, 0 if never
+     */
+    std::uint64_t lastRead() const
+    {
+        return m_lastRead.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Number of texts in the block
+     */
+    std::size_t nrTexts() const
+    {
+        return m_offsets.size() - 1;
+    }
+
+    /**
+     * @brief Memory used by the block
+     */
+    std::size_t bytes() const;
+
+private:
+    /**
+     * @brief Decompresses all the texts of the block
+     * @param[in] stored : data of the block, m_data or what was read from the segment file
+     * @param[out] data : receives the uncompressed data, reused between the calls
+     * @param[out] texts : receives the texts, their capacity is reused
+     * @throw std::runtime_error if the data is not a block of this size, e.g. a damaged segment file
+     */
+    void decompress(const std::string& stored, std::string& data, std::vector<std::string>& texts) const;
+
+    /**
+     * @brief Returns the decompressed texts of the block, from the cache of the calling thread
+     */
+    const std::shared_ptr<std::vector<std::string>>& cachedTexts() const;
+
+    /**
+     * @brief Share of bytes attributed to a text, in proportion to its uncompressed size
+     */
+    std::size_t share(std::size_t bytes, std::uint32_t index) const;
+
+    std::shared_ptr<const TextDictionary> m_dictionary;         /// History the compression started with, if any
+    std::string                           m_data;               /// Compressed texts, empty if the block is spilled
+    std::vector<std::uint32_t>            m_offsets;            /// Start of each uncompressed text, and the end
+    std::shared_ptr<SegmentFile>          m_segment;            /// File holding the data, if the block is spilled
+    std::uint64_t                         m_segmentOffset = 0;  /// Offset of the data in m_segment
+    std::size_t                           m_segmentBytes  = 0;  /// Size of the data in m_segment
+    mutable std::atomic<std::uint64_t>    m_lastRead{0};        /// See lastRead()
+};
+
+}  // End of namespace storyboard
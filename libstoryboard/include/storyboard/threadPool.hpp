@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace storyboard {
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads for running the parts of a query in parallel
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Constructor
+     * @param[in] nr_workers : number of worker threads
+     */
+    explicit ThreadPool(std::size_t nr_workers);
+
+    /**
+     * @brief Destructor. Finishes the queued tasks and stops the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Returns the pool that is shared by all the boards. It has one worker less than there are hardware threads,
+     * since the calling thread takes part in the work.
+     */
+    static ThreadPool& shared();
+
+    /**
+     * @brief Calls fn(index) for each index in [0, nr_items), in parallel, and waits for all the calls to finish
+     * @details The calling thread runs items too, so the call makes progress even if all the workers are busy. If any
+     * of the calls throws, the first exception is rethrown after all the calls have finished.
+     * @param[in] nr_items : number of items
+     * @param[in] fn : function that is called for each item
+     */
+    void parallelFor(std::size_t nr_items, const std::function<void(std::size_t)>& fn);
+
+    /**
+     * @brief Queues a task that runs on a worker thread, without waiting for it. A pool with no workers runs the task
+     * on the calling thread.
+     * @param[in] task : task to run, must not throw
+     */
+    void submit(std::function<void()> task);
+
+private:
+    void run();
+
+    std::vector<std::thread>          m_workers;       /// Worker threads
+    std::mutex                        m_mutex;         /// Protects the members below
+    std::condition_variable           m_wakeup;        /// Signalled when tasks are queued and on stop
+    std::deque<std::function<void()>> m_tasks;         /// Queued tasks
+    bool                              m_stop = false;  /// The workers should exit
+};
+
+}  // End of namespace storyboard
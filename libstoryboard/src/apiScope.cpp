@@ -0,0 +1,61 @@
+#include "apiScope.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "storyboard/storyboard.hpp"
+
+std::atomic<const TraceHooks*> g_trace_hooks{nullptr};
+
+namespace {
+
+std::mutex                               g_trace_hooks_mutex;
+std::vector<std::unique_ptr<TraceHooks>> g_retired_trace_hooks;  /// Every hooks object ever published
+
+}  // namespace
+
+void setTraceHooks(storyboard_trace_begin_handler begin, storyboard_trace_end_handler end, void* user_data)
+{
+    std::lock_guard<std::mutex> lock(g_trace_hooks_mutex);
+
+    if (!begin && !end)
+    {
+        g_trace_hooks.store(nullptr, std::memory_order_release);
+        return;
+    }
+
+    // Calls that are in progress may still use the previous hooks, so they are kept until the process exits
+    g_retired_trace_hooks.push_back(std::unique_ptr<TraceHooks>(new TraceHooks{begin, end, user_data}));
+    g_trace_hooks.store(g_retired_trace_hooks.back().get(), std::memory_order_release);
+}
+
+void ApiScope::begin()
+{
+    m_scanned = storyboard::Storyboard::notesScanned();
+    m_errors  = errorsReported();
+
+    if (m_hooks && m_hooks->begin)
+    {
+        m_span = m_hooks->begin(m_hooks->user_data, apiOpName(m_op), m_board);
+    }
+
+    m_start = std::chrono::steady_clock::now();
+}
+
+void ApiScope::end()
+{
+    auto          now     = std::chrono::steady_clock::now();
+    auto          latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start);
+    std::uint64_t scanned = storyboard::Storyboard::notesScanned() - m_scanned;
+
+    if (m_stats)
+    {
+        m_stats->record(m_op, errorsReported() != m_errors, m_results > 0 ? m_results : 0, scanned, latency.count());
+    }
+
+    if (m_hooks && m_hooks->end)
+    {
+        m_hooks->end(m_hooks->user_data, m_span, apiOpName(m_op), m_board, m_results, scanned);
+    }
+}
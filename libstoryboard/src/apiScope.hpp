@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "boardStats.hpp"
+#include "storyboard/storyboardCAPI.h"
+
+/**
+ * @brief Trace hooks registered with storyboard_set_trace_hooks. Never modified after they have been published.
+ */
+struct TraceHooks
+{
+    storyboard_trace_begin_handler begin;      /// Called when an entry point is entered, can be NULL
+    storyboard_trace_end_handler   end;        /// Called when an entry point returns, can be NULL
+    void*                          user_data;  /// Passed to both hooks
+};
+
+/**
+ * @brief Replaces the registered trace hooks. Previous hooks are retired but kept alive for calls still using them.
+ */
+void setTraceHooks(storyboard_trace_begin_handler begin, storyboard_trace_end_handler end, void* user_data);
+
+/**
+ * @brief Currently registered trace hooks, nullptr if there are none
+ */
+extern std::atomic<const TraceHooks*> g_trace_hooks;
+
+/**
+ * @class ApiScope
+ * @brief Measures one call of a C API entry point. When the call ends, the measurement is recorded into the statistics
+ * of the board and passed to the trace hooks.
+ * @details If neither statistics nor trace hooks are active, nothing is measured.
+ */
+class ApiScope
+{
+public:
+    /**
+     * @brief Constructor
+     * @param[in] op : operation being called
+     * @param[in] board_in : board the call operates on, can be NULL
+     * @param[in] stats : statistics of the board, can be nullptr
+     */
+    ApiScope(ApiOp op, board_t board_in = nullptr, BoardStats* stats = nullptr)
+        : m_stats(stats && stats->enabled() ? stats : nullptr),
+          m_hooks(g_trace_hooks.load(std::memory_order_acquire)),
+          m_op(op),
+          m_board(board_in)
+    {
+        if (m_stats || m_hooks)
+        {
+            begin();
+        }
+    }
+
+    ~ApiScope()
+    {
+        if (m_stats || m_hooks)
+        {
+            end();
+        }
+    }
+
+    ApiScope(const ApiScope&)            = delete;
+    ApiScope& operator=(const ApiScope&) = delete;
+
+    /**
+     * @brief Sets the number of results returned by the call
+     */
+    void setResults(std::int64_t nr_results)
+    {
+        m_results = nr_results;
+    }
+
+private:
+    void begin();
+    void end();
+
+    BoardStats*                           m_stats;              /// nullptr if statistics are not being collected
+    const TraceHooks*                     m_hooks;              /// nullptr if the call is not traced
+    ApiOp                                 m_op;                 /// Operation being called
+    board_t                               m_board;              /// Board the call operates on
+    void*                                 m_span    = nullptr;  /// Span returned by the begin hook
+    std::int64_t                          m_results = 0;        /// Number of results returned by the call
+    std::uint64_t                         m_scanned = 0;        /// Notes scanned on this thread when the call started
+    std::uint64_t                         m_errors  = 0;        /// Errors reported on this thread when the call started
+    std::chrono::steady_clock::time_point m_start;              /// Start time of the call
+};
+
+/**
+ * @brief Number of errors reported on the calling thread. Used for detecting failed calls.
+ */
+std::uint64_t errorsReported();
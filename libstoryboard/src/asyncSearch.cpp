@@ -0,0 +1,59 @@
+#include "asyncSearch.hpp"
+
+bool AsyncSearch::cancel()
+{
+    State expected = State::Pending;
+
+    return m_state.compare_exchange_strong(expected, State::Cancelled) || (expected == State::Cancelled);
+}
+
+bool AsyncSearch::cancelled() const
+{
+    return m_state.load() == State::Cancelled;
+}
+
+bool AsyncSearch::beginCompletion()
+{
+    State expected = State::Pending;
+
+    return m_state.compare_exchange_strong(expected, State::Completing);
+}
+
+void AsyncSearch::finish()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_done = true;
+    m_finished.notify_all();
+}
+
+void AsyncSearch::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_finished.wait(lock, [this] { return m_done; });
+}
+
+SearchTracker::~SearchTracker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_finished.wait(lock, [this] { return m_pending == 0; });
+}
+
+void SearchTracker::add()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending++;
+}
+
+void SearchTracker::remove()
+{
+    // Notified under the lock, since the tracker may be destroyed as soon as the count reaches zero
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (--m_pending == 0)
+    {
+        m_finished.notify_all();
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * @class AsyncSearch
+ * @brief Shared state of a search that runs on a worker thread
+ * @details The completion is called exactly once: with the results, or without them if the search was cancelled before
+ * the results were delivered.
+ */
+class AsyncSearch
+{
+public:
+    /**
+     * @brief Cancels the search unless its completion has already started
+     * @return true if the results will not be delivered
+     */
+    bool cancel();
+
+    /**
+     * @brief Returns true if the search has been cancelled, so the worker can skip the query
+     */
+    bool cancelled() const;
+
+    /**
+     * @brief Called by the worker before it delivers the results
+     * @return false if the search was cancelled, in which case the results must not be delivered
+     */
+    bool beginCompletion();
+
+    /**
+     * @brief Called by the worker after the completion has returned
+     */
+    void finish();
+
+    /**
+     * @brief Waits until the completion has returned
+     */
+    void wait();
+
+private:
+    enum class State : int
+    {
+        Pending,
+        Completing,
+        Cancelled
+    };
+
+    std::atomic<State>      m_state{State::Pending};  /// Decides whether the results are delivered
+    std::mutex              m_mutex;                  /// Protects m_done
+    std::condition_variable m_finished;               /// Signalled when the completion has returned
+    bool                    m_done = false;           /// The completion has returned
+};
+
+/**
+ * @class SearchTracker
+ * @brief Counts the searches of a board that have not finished, so the board can wait for them before it goes away
+ */
+class SearchTracker
+{
+public:
+    SearchTracker() = default;
+
+    /**
+     * @brief Destructor. Waits for the searches that have not finished.
+     */
+    ~SearchTracker();
+
+    SearchTracker(const SearchTracker&)            = delete;
+    SearchTracker& operator=(const SearchTracker&) = delete;
+
+    void add();
+    void remove();
+
+private:
+    std::mutex              m_mutex;        /// Protects m_pending
+    std::condition_variable m_finished;     /// Signalled when the last search finishes
+    int                     m_pending = 0;  /// Searches that have not finished
+};
@@ -0,0 +1,80 @@
+#include "backgroundCompactor.hpp"
+
+BackgroundCompactor::~BackgroundCompactor()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wakeup.notify_one();
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void BackgroundCompactor::setThreshold(double threshold)
+{
+    m_threshold.store(threshold);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if ((threshold > 0.0) && !m_thread.joinable())
+    {
+        m_thread = std::thread([this] { run(); });
+    }
+}
+
+bool BackgroundCompactor::shouldCompact(int nr_stored, int nr_tombstones) const
+{
+    double threshold = m_threshold.load(std::memory_order_relaxed);
+
+    return (threshold > 0.0) && (nr_tombstones > 0) && (nr_tombstones >= threshold * nr_stored);
+}
+
+void BackgroundCompactor::request()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_thread.joinable())
+        {
+            return;
+        }
+
+        m_requested = true;
+    }
+
+    m_wakeup.notify_one();
+}
+
+void BackgroundCompactor::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_wakeup.wait(lock, [this] { return m_requested || m_stop; });
+
+        if (m_stop)
+        {
+            return;
+        }
+
+        m_requested = false;
+        lock.unlock();
+
+        try
+        {
+            m_compact();
+        }
+        catch (...)
+        {
+            // A failed compaction leaves the board as it was, the next request tries again
+        }
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @class BackgroundCompactor
+ * @brief A worker thread that compacts a board when requested
+ * @details The thread is started when a threshold is set for the first time, and it sleeps until request() is called.
+ * Requests that arrive while a compaction is running are merged into one.
+ */
+class BackgroundCompactor
+{
+public:
+    /**
+     * @brief Constructor
+     * @param[in] compact : compacts the board, called on the worker thread
+     */
+    explicit BackgroundCompactor(std::function<void()> compact) : m_compact(std::move(compact))
+    {
+    }
+
+    /**
+     * @brief Destructor. Waits for a running compaction to finish and stops the thread.
+     */
+    ~BackgroundCompactor();
+
+    BackgroundCompactor(const BackgroundCompactor&)            = delete;
+    BackgroundCompactor& operator=(const BackgroundCompactor&) = delete;
+
+    /**
+     * @brief Sets the tombstone ratio that triggers a compaction
+     * @param[in] threshold : ratio of tombstones to all the stored notes, 0 disables background compaction
+     */
+    void setThreshold(double threshold);
+
+    /**
+     * @brief Returns true if a board with the given number of notes and tombstones should be compacted
+     */
+    bool shouldCompact(int nr_stored, int nr_tombstones) const;
+
+    /**
+     * @brief Wakes up the worker thread to run a compaction
+     */
+    void request();
+
+private:
+    void run();
+
+    std::function<void()>   m_compact;            /// Compacts the board
+    std::atomic<double>     m_threshold{0.0};     /// Tombstone ratio that triggers a compaction, 0 if disabled
+    std::mutex              m_mutex;              /// Protects the members below
+    std::condition_variable m_wakeup;             /// Signalled on requests and on stop
+    bool                    m_requested = false;  /// A compaction has been requested
+    bool                    m_stop      = false;  /// The thread should exit
+    std::thread             m_thread;             /// Worker thread, started on the first non-zero threshold
+};
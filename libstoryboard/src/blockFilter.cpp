@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cmath>
+
+#include <storyboard/blockFilter.hpp>
+#include <storyboard/hash.hpp>
+
+namespace storyboard {
+
+namespace {
+
+// Position of the i-th bit of a key, derived from the key by double hashing
+std::uint64_t bitPosition(std::uint64_t key, std::uint32_t i, std::uint64_t nr_bits)
+{
+    std::uint64_t h1 = key & 0xffffffffULL;
+    std::uint64_t h2 = (key >> 32) | 1;
+
+    return (h1 + i * h2) % nr_bits;
+}
+
+}  // namespace
+
+std::uint64_t BlockFilter::titleKey(const char* data, std::size_t size)
+{
+    return hashBytes(data, size);
+}
+
+void BlockFilter::configure(std::size_t block_size, double false_positive_rate)
+{
+    m_blockSize         = block_size;
+    m_falsePositiveRate = block_size == 0 ? 0 : false_positive_rate;
+    m_bitsPerKey        = block_size == 0 ? 0 : -std::log(false_positive_rate) / (std::log(2.0) * std::log(2.0));
+    m_blocks.clear();
+    m_bits.clear();
+    m_blocks.shrink_to_fit();
+    m_bits.shrink_to_fit();
+}
+
+void BlockFilter::truncate(std::size_t nr_blocks)
+{
+    if (nr_blocks < m_blocks.size())
+    {
+        m_bits.resize(m_blocks[nr_blocks].offset);
+        m_blocks.resize(nr_blocks);
+    }
+}
+
+void BlockFilter::addBlock(const key_cont_t& keys)
+{
+    // Sized for the actual number of keys, which is lower than the block size if titles repeat
+    std::size_t   nr_bits   = static_cast<std::size_t>(std::ceil(keys.size() * m_bitsPerKey));
+    std::uint32_t nr_words  = static_cast<std::uint32_t>(std::max<std::size_t>(1, (nr_bits + 63) / 64));
+    double        nr_hashes = std::round(m_bitsPerKey * std::log(2.0));
+
+    Block block;
+    block.offset    = m_bits.size();
+    block.nr_words  = nr_words;
+    block.nr_hashes = static_cast<std::uint32_t>(std::min(16.0, std::max(1.0, nr_hashes)));
+
+    m_bits.resize(m_bits.size() + nr_words, 0);
+    std::uint64_t* words = m_bits.data() + block.offset;
+
+    for (auto key : keys)
+    {
+        for (std::uint32_t i = 0; i < block.nr_hashes; i++)
+        {
+            std::uint64_t bit = bitPosition(key, i, nr_words * 64ULL);
+            words[bit / 64] |= 1ULL << (bit % 64);
+        }
+    }
+
+    m_blocks.push_back(block);
+}
+
+bool BlockFilter::mayContainAny(std::size_t block, const key_cont_t& keys) const
+{
+    const Block&         filter = m_blocks[block];
+    const std::uint64_t* words  = m_bits.data() + filter.offset;
+
+    for (auto key : keys)
+    {
+        bool found = true;
+
+        for (std::uint32_t i = 0; (i < filter.nr_hashes) && found; i++)
+        {
+            std::uint64_t bit = bitPosition(key, i, filter.nr_words * 64ULL);
+            found             = (words[bit / 64] & (1ULL << (bit % 64))) != 0;
+        }
+
+        if (found)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::size_t BlockFilter::bytes() const
+{
+    return m_blocks.capacity() * sizeof(Block) + m_bits.capacity() * sizeof(std::uint64_t);
+}
+
+}  // End of namespace storyboard
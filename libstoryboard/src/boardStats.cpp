@@ -0,0 +1,219 @@
+#include "boardStats.hpp"
+
+namespace {
+
+const char* const API_OP_NAMES[] = {"storyboard_copy",
+                                    "storyboard_add_note",
+                                    "storyboard_enqueue_note",
+                                    "storyboard_flush",
+                                    "storyboard_delete_note",
+                                    "storyboard_delete_by_title",
+                                    "storyboard_delete_by_title_n",
+                                    "storyboard_delete_by_text",
+                                    "storyboard_delete_by_text_n",
+                                    "storyboard_delete_by_tag",
+                                    "storyboard_delete_by_tag_n",
+                                    "storyboard_search_by_title",
+                                    "storyboard_search_by_title_n",
+                                    "storyboard_search_by_text",
+                                    "storyboard_search_by_text_n",
+                                    "storyboard_search_by_tag",
+                                    "storyboard_search_by_tag_n",
+                                    "storyboard_search_by_tags",
+                                    "storyboard_search_by_tags_n",
+                                    "storyboard_search_async",
+                                    "storyboard_count_by_title",
+                                    "storyboard_count_by_title_n",
+                                    "storyboard_count_by_text",
+                                    "storyboard_count_by_text_n",
+                                    "storyboard_count_by_tag",
+                                    "storyboard_count_by_tag_n",
+                                    "storyboard_count_by_tags",
+                                    "storyboard_count_by_tags_n",
+                                    "storyboard_get_nr_notes",
+                                    "storyboard_get_tag_stats",
+                                    "storyboard_get_tag_facets",
+                                    "storyboard_set_query_cache_capacity",
+                                    "storyboard_get_query_cache_stats",
+                                    "storyboard_memory_usage",
+                                    "storyboard_set_delete_mode",
+                                    "storyboard_compact",
+                                    "storyboard_set_auto_compaction",
+                                    "storyboard_set_block_filter",
+                                    "storyboard_set_text_compression",
+                                    "storyboard_set_reject_duplicates",
+                                    "storyboard_merge",
+                                    "storyboard_diff",
+                                    "storyboard_set_memory_budget",
+                                    "note_construct",
+                                    "note_construct_n",
+                                    "note_destruct",
+                                    "note_copy",
+                                    "note_get_title",
+                                    "note_get_title_n",
+                                    "note_get_text",
+                                    "note_get_text_n",
+                                    "note_get_tags",
+                                    "note_get_tags_array",
+                                    "storyboard_construct",
+                                    "storyboard_construct_sharded",
+                                    "storyboard_destruct",
+                                    "search_cancel",
+                                    "search_wait",
+                                    "search_destruct",
+                                    "storyboard_enable_stats",
+                                    "storyboard_get_stats",
+                                    "storyboard_reset_stats"};
+
+static_assert(sizeof(API_OP_NAMES) / sizeof(API_OP_NAMES[0]) == static_cast<std::size_t>(ApiOp::NrOps),
+              "Each ApiOp needs a name");
+
+}  // namespace
+
+const char* apiOpName(ApiOp op)
+{
+    return API_OP_NAMES[static_cast<std::size_t>(op)];
+}
+
+BoardStats::Shard::Shard()
+{
+    for (auto& op : ops)
+    {
+        for (auto& bucket : op.latency_buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+BoardStats::~BoardStats()
+{
+    delete[] m_shards.load();
+}
+
+void BoardStats::setEnabled(bool enabled)
+{
+    if (enabled && !m_shards.load())
+    {
+        // Several threads may enable the statistics at the same time, only one of the allocations is kept
+        Shard* shards   = new Shard[NR_SHARDS];
+        Shard* expected = nullptr;
+
+        if (!m_shards.compare_exchange_strong(expected, shards))
+        {
+            delete[] shards;
+        }
+    }
+
+    m_enabled.store(enabled);
+}
+
+void BoardStats::record(ApiOp op, bool failed, std::uint64_t nr_results, std::uint64_t notes_scanned,
+                        std::uint64_t latency_ns)
+{
+    Shard* shards = m_shards.load(std::memory_order_acquire);
+
+    if (!shards || op >= ApiOp::NrBoardOps)
+    {
+        return;
+    }
+
+    OpCounters& counters = shards[shardIndex()].ops[static_cast<std::size_t>(op)];
+
+    counters.calls.fetch_add(1, std::memory_order_relaxed);
+    counters.errors.fetch_add(failed ? 1 : 0, std::memory_order_relaxed);
+    counters.results.fetch_add(nr_results, std::memory_order_relaxed);
+    counters.notes_scanned.fetch_add(notes_scanned, std::memory_order_relaxed);
+    counters.total_latency_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+    counters.latency_buckets[latencyBucket(latency_ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+int32_t BoardStats::report(storyboard_stats_handler handler, void* client_data) const
+{
+    Shard*  shards     = m_shards.load(std::memory_order_acquire);
+    int32_t nr_reports = 0;
+
+    if (!shards)
+    {
+        return nr_reports;
+    }
+
+    for (std::size_t op = 0; op < static_cast<std::size_t>(ApiOp::NrBoardOps); op++)
+    {
+        storyboard_op_stats stats = {};
+        stats.operation           = apiOpName(static_cast<ApiOp>(op));
+
+        for (std::size_t shard = 0; shard < NR_SHARDS; shard++)
+        {
+            const OpCounters& counters = shards[shard].ops[op];
+
+            stats.calls += counters.calls.load(std::memory_order_relaxed);
+            stats.errors += counters.errors.load(std::memory_order_relaxed);
+            stats.results += counters.results.load(std::memory_order_relaxed);
+            stats.notes_scanned += counters.notes_scanned.load(std::memory_order_relaxed);
+            stats.total_latency_ns += counters.total_latency_ns.load(std::memory_order_relaxed);
+
+            for (std::size_t bucket = 0; bucket < STORYBOARD_LATENCY_BUCKETS; bucket++)
+            {
+                stats.latency_buckets[bucket] += counters.latency_buckets[bucket].load(std::memory_order_relaxed);
+            }
+        }
+
+        if (stats.calls > 0)
+        {
+            handler(client_data, &stats);
+            nr_reports++;
+        }
+    }
+
+    return nr_reports;
+}
+
+void BoardStats::reset()
+{
+    Shard* shards = m_shards.load(std::memory_order_acquire);
+
+    if (!shards)
+    {
+        return;
+    }
+
+    for (std::size_t shard = 0; shard < NR_SHARDS; shard++)
+    {
+        for (auto& counters : shards[shard].ops)
+        {
+            counters.calls.store(0, std::memory_order_relaxed);
+            counters.errors.store(0, std::memory_order_relaxed);
+            counters.results.store(0, std::memory_order_relaxed);
+            counters.notes_scanned.store(0, std::memory_order_relaxed);
+            counters.total_latency_ns.store(0, std::memory_order_relaxed);
+
+            for (auto& bucket : counters.latency_buckets)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+std::size_t BoardStats::shardIndex()
+{
+    // Threads are assigned to shards round-robin, the first time they record anything
+    static std::atomic<std::size_t> next_shard{0};
+    thread_local std::size_t        shard = next_shard.fetch_add(1, std::memory_order_relaxed) % NR_SHARDS;
+
+    return shard;
+}
+
+std::size_t BoardStats::latencyBucket(std::uint64_t latency_ns)
+{
+    // Bucket i holds latencies in [2^i, 2^(i+1)) nanoseconds, the last bucket also holds everything above
+    std::size_t bucket = 0;
+
+    while ((latency_ns >>= 1) && (bucket < STORYBOARD_LATENCY_BUCKETS - 1))
+    {
+        bucket++;
+    }
+
+    return bucket;
+}
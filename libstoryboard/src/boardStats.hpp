@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "storyboard/storyboardCAPI.h"
+
+/**
+ * @brief C API entry points that are measured. The ones before NrBoardOps are also recorded in the board statistics.
+ */
+enum class ApiOp : int
+{
+    Copy,
+    AddNote,
+    EnqueueNote,
+    Flush,
+    DeleteNote,
+    DeleteByTitle,
+    DeleteByTitleN,
+    DeleteByText,
+    DeleteByTextN,
+    DeleteByTag,
+    DeleteByTagN,
+    SearchByTitle,
+    SearchByTitleN,
+    SearchByText,
+    SearchByTextN,
+    SearchByTag,
+    SearchByTagN,
+    SearchByTags,
+    SearchByTagsN,
+    SearchAsync,
+    CountByTitle,
+    CountByTitleN,
+    CountByText,
+    CountByTextN,
+    CountByTag,
+    CountByTagN,
+    CountByTags,
+    CountByTagsN,
+    GetNrNotes,
+    GetTagStats,
+    GetTagFacets,
+    SetQueryCacheCapacity,
+    GetQueryCacheStats,
+    MemoryUsage,
+    SetDeleteMode,
+    Compact,
+    SetAutoCompaction,
+    SetBlockFilter,
+    SetTextCompression,
+    SetRejectDuplicates,
+    Merge,
+    Diff,
+    SetMemoryBudget,
+    NrBoardOps,
+    NoteConstruct = NrBoardOps,
+    NoteConstructN,
+    NoteDestruct,
+    NoteCopy,
+    NoteGetTitle,
+    NoteGetTitleN,
+    NoteGetText,
+    NoteGetTextN,
+    NoteGetTags,
+    NoteGetTagsArray,
+    Construct,
+    ConstructSharded,
+    Destruct,
+    SearchCancel,
+    SearchWait,
+    SearchDestruct,
+    EnableStats,
+    GetStats,
+    ResetStats,
+    NrOps
+};
+
+/**
+ * @brief Returns the name of the C API function of an operation
+ */
+const char* apiOpName(ApiOp op);
+
+/**
+ * @class BoardStats
+ * @brief Per-board operation counters and latency histograms
+ * @details Counters are split into shards, and each thread updates its own shard with relaxed atomic operations, so
+ * threads using the same board do not contend on the same cache lines. The shards are allocated when statistics are
+ * enabled for the first time.
+ */
+class BoardStats
+{
+public:
+    BoardStats() = default;
+    ~BoardStats();
+
+    BoardStats(const BoardStats&)            = delete;
+    BoardStats& operator=(const BoardStats&) = delete;
+
+    /**
+     * @brief Enables or disables collecting statistics
+     */
+    void setEnabled(bool enabled);
+
+    bool enabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Records one call of an operation. Operations that are not board operations are ignored.
+     * @param[in] op : operation
+     * @param[in] failed : true if the call reported an error
+     * @param[in] nr_results : number of results returned by the call
+     * @param[in] notes_scanned : number of notes examined by the call
+     * @param[in] latency_ns : duration of the call in nanoseconds
+     */
+    void record(ApiOp op, bool failed, std::uint64_t nr_results, std::uint64_t notes_scanned,
+                std::uint64_t latency_ns);
+
+    /**
+     * @brief Sums the shards and calls the handler for each operation that has been called at least once
+     * @return number of operations reported
+     */
+    int32_t report(storyboard_stats_handler handler, void* client_data) const;
+
+    /**
+     * @brief Sets all the counters to zero
+     */
+    void reset();
+
+private:
+    static const std::size_t NR_SHARDS = 16;
+
+    struct OpCounters
+    {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> errors{0};
+        std::atomic<std::uint64_t> results{0};
+        std::atomic<std::uint64_t> notes_scanned{0};
+        std::atomic<std::uint64_t> total_latency_ns{0};
+        std::atomic<std::uint64_t> latency_buckets[STORYBOARD_LATENCY_BUCKETS];
+    };
+
+    // Aligned so that shards used by different threads never share a cache line
+    struct alignas(64) Shard
+    {
+        Shard();
+
+        std::array<OpCounters, static_cast<std::size_t>(ApiOp::NrBoardOps)> ops;
+    };
+
+    static std::size_t shardIndex();
+    static std::size_t latencyBucket(std::uint64_t latency_ns);
+
+    std::atomic<bool>   m_enabled{false};   /// Whether calls are recorded
+    std::atomic<Shard*> m_shards{nullptr};  /// NR_SHARDS shards, allocated on first enable
+};
@@ -0,0 +1,83 @@
+#include <cstring>
+
+#include <storyboard/hash.hpp>
+
+namespace storyboard {
+
+namespace {
+
+const std::uint64_t PRIME_1 = 0x9e3779b185ebca87ULL;
+const std::uint64_t PRIME_2 = 0xc2b2ae3d27d4eb4fULL;
+const std::uint64_t PRIME_3 = 0x165667b19e3779f9ULL;
+
+std::uint64_t rotateLeft(std::uint64_t value, unsigned shift)
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+// Unaligned loads are done with memcpy, which compilers turn into a single instruction
+std::uint64_t readWord(const char* data)
+{
+    std::uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+std::uint64_t mixLane(std::uint64_t lane, std::uint64_t word)
+{
+    return rotateLeft(lane + word * PRIME_2, 31) * PRIME_1;
+}
+
+// Finalizer of splitmix64, spreads the entropy of the input over all the bits
+std::uint64_t mix(std::uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+}  // namespace
+
+std::uint64_t hashBytes(const char* data, std::size_t size, std::uint64_t seed)
+{
+    const char*   end  = data + size;
+    std::uint64_t hash = seed + PRIME_3;
+
+    if (size >= 32)
+    {
+        // The lanes do not depend on each other, so their multiplications overlap
+        std::uint64_t lanes[4] = {seed + PRIME_1 + PRIME_2, seed + PRIME_2, seed, seed - PRIME_1};
+
+        for (; end - data >= 32; data += 32)
+        {
+            lanes[0] = mixLane(lanes[0], readWord(data));
+            lanes[1] = mixLane(lanes[1], readWord(data + 8));
+            lanes[2] = mixLane(lanes[2], readWord(data + 16));
+            lanes[3] = mixLane(lanes[3], readWord(data + 24));
+        }
+
+        hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+    }
+
+    // The size keeps inputs that only differ by trailing zero bytes apart
+    hash += size;
+
+    for (; end - data >= 8; data += 8)
+    {
+        hash = rotateLeft(hash ^ mixLane(0, readWord(data)), 27) * PRIME_1 + PRIME_2;
+    }
+
+    if (data != end)
+    {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data, end - data);
+        hash = rotateLeft(hash ^ mixLane(0, word), 27) * PRIME_1 + PRIME_2;
+    }
+
+    return mix(hash);
+}
+
+}  // End of namespace storyboard
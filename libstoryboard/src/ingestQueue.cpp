@@ -0,0 +1,176 @@
+#include "ingestQueue.hpp"
+
+#include <algorithm>
+
+IngestQueue::~IngestQueue()
+{
+    m_stop.store(true);
+    wake();
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void IngestQueue::push(const storyboard::Note& note)
+{
+    // The producer that starts the applier is the only one to touch the thread, the others go on pushing
+    if (!m_started.load(std::memory_order_acquire) && !m_started.exchange(true))
+    {
+        m_thread = std::thread([this] { run(); });
+    }
+
+    Node* previous = m_head.load(std::memory_order_relaxed);
+    Node* node     = new Node{note, previous};
+
+    // Once linked the node belongs to the applier, so only the local copy of the previous head is used afterwards
+    while (!m_head.compare_exchange_weak(previous, node))
+    {
+        node->next = previous;
+    }
+
+    wake();
+}
+
+void IngestQueue::flush()
+{
+    // Nothing was pushed by this thread, or anyone else, if the applier has not been started
+    if (!m_started.load())
+    {
+        return;
+    }
+
+    // Notes pushed before this request are in the queue when the applier sees the request
+    std::uint64_t request = m_flushRequests.fetch_add(1) + 1;
+    wake();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_applied.wait(lock, [this, request] { return m_flushed >= request; });
+
+    auto failure = std::find_if(m_failures.begin(), m_failures.end(), [request](const Failure& candidate) {
+        return (candidate.first <= request) && (request <= candidate.last);
+    });
+
+    if (failure != m_failures.end())
+    {
+        std::exception_ptr error = failure->error;
+
+        if (--failure->pending == 0)
+        {
+            m_failures.erase(failure);
+        }
+
+        std::rethrow_exception(error);
+    }
+}
+
+void IngestQueue::run()
+{
+    std::uint64_t flushed = 0;
+
+    while (true)
+    {
+        std::uint64_t requests = m_flushRequests.load();
+        bool          stop     = m_stop.load();
+
+        applyPending();
+        complete(requests);
+        flushed = requests;
+
+        if (stop)
+        {
+            return;
+        }
+
+        // The flag is raised before the queue is checked, and producers link their note before they check the flag, so
+        // either the applier sees the note or the producer sees the flag
+        m_sleeping.store(true);
+
+        if (hasWork(flushed))
+        {
+            m_sleeping.store(false);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wakeup.wait(lock, [this] { return !m_sleeping.load(); });
+    }
+}
+
+bool IngestQueue::hasWork(std::uint64_t flushed) const
+{
+    return m_stop.load() || (m_head.load() != nullptr) || (m_flushRequests.load() != flushed);
+}
+
+void IngestQueue::wake()
+{
+    if (m_sleeping.load() && m_sleeping.exchange(false))
+    {
+        // The applier checks the flag under the mutex before it waits, so the signal cannot be lost
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+
+        m_wakeup.notify_one();
+    }
+}
+
+void IngestQueue::applyPending()
+{
+    std::vector<storyboard::Note> batch;
+
+    for (Node* node = m_head.exchange(nullptr); node;)
+    {
+        Node* next = node->next;
+        batch.push_back(std::move(node->note));
+        delete node;
+        node = next;
+    }
+
+    if (batch.empty())
+    {
+        return;
+    }
+
+    // The list starts with the most recent note
+    std::reverse(batch.begin(), batch.end());
+
+    try
+    {
+        m_apply(std::move(batch));
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_error)
+        {
+            m_error = std::current_exception();
+        }
+    }
+}
+
+void IngestQueue::complete(std::uint64_t requests)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (requests == m_flushed)
+        {
+            // No flush call to report an error to yet, it is kept for the next ones
+            return;
+        }
+
+        // The error goes to all the flush calls served by this batch, rather than to the first one to wake up
+        if (m_error)
+        {
+            m_failures.push_back(Failure{m_flushed + 1, requests, requests - m_flushed, m_error});
+            m_error = nullptr;
+        }
+
+        m_flushed = requests;
+    }
+
+    m_applied.notify_all();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "storyboard/storyboard.hpp"
+
+/**
+ * @class IngestQueue
+ * @brief A lock-free multi-producer queue of notes, drained in batches by a single applier thread
+ * @details Producers link their notes into an atomic list without taking any lock. The applier takes the whole list at
+ * once, puts the notes back in the order they were pushed, and applies them with one call. The applier thread is
+ * started by the first push. Before it goes to sleep the applier raises a flag, and only a producer that finds the flag
+ * raised takes the mutex the applier sleeps on, to wake it up.
+ */
+class IngestQueue
+{
+public:
+    using apply_t = std::function<void(std::vector<storyboard::Note>&&)>;
+
+    /**
+     * @brief Constructor
+     * @param[in] apply : adds a batch of notes to the board, called on the applier thread
+     */
+    explicit IngestQueue(apply_t apply) : m_apply(std::move(apply))
+    {
+    }
+
+    /**
+     * @brief Destructor. Applies the notes that are still queued and stops the applier thread.
+     */
+    ~IngestQueue();
+
+    IngestQueue(const IngestQueue&)            = delete;
+    IngestQueue& operator=(const IngestQueue&) = delete;
+
+    /**
+     * @brief Queues a copy of the note. Does not wait for the applier.
+     */
+    void push(const storyboard::Note& note);
+
+    /**
+     * @brief Waits until the notes pushed by this thread before the call have been applied
+     * @details If applying a batch failed since the flush requests before this one were served, the error is rethrown
+     * here. Every flush call served by the same batch rethrows the error.
+     */
+    void flush();
+
+private:
+    struct Node
+    {
+        storyboard::Note note;  /// Queued note
+        Node*            next;  /// Note pushed before this one
+    };
+
+    /**
+     * @brief The error of a batch, reported to a range of flush requests
+     */
+    struct Failure
+    {
+        std::uint64_t      first;    /// First flush request the error is reported to
+        std::uint64_t      last;     /// Last flush request the error is reported to
+        std::uint64_t      pending;  /// Requests of the range that have not reported the error yet
+        std::exception_ptr error;    /// First error of the batches applied for the range
+    };
+
+    void run();
+    bool hasWork(std::uint64_t flushed) const;
+    void wake();
+    void applyPending();
+    void complete(std::uint64_t requests);
+
+    apply_t                    m_apply;             /// Adds a batch of notes to the board
+    std::atomic<Node*>         m_head{nullptr};     /// Most recently pushed note
+    std::atomic<bool>          m_started{false};    /// The applier thread has been started, or is being started
+    std::atomic<bool>          m_sleeping{false};   /// The applier is going to sleep, or sleeps, on m_wakeup
+    std::atomic<bool>          m_stop{false};       /// The thread should exit
+    std::atomic<std::uint64_t> m_flushRequests{0};  /// Number of flush calls so far
+    std::mutex                 m_sleepMutex;        /// Taken to wake the applier up, never while a batch is applied
+    std::condition_variable    m_wakeup;            /// Signalled when m_sleeping is cleared
+    std::mutex                 m_mutex;             /// Protects the members below
+    std::condition_variable    m_applied;           /// Signalled when a batch has been applied
+    std::uint64_t              m_flushed = 0;       /// Flush calls whose notes have been applied
+    std::exception_ptr         m_error;             /// First error of the batches applied since m_flushed changed
+    std::vector<Failure>       m_failures;          /// Errors not reported yet to all the flush calls they concern
+    std::thread                m_thread;            /// Applier thread
+};
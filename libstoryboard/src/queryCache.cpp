@@ -0,0 +1,174 @@
+#include <storyboard/queryCache.hpp>
+
+namespace storyboard {
+
+QueryCache::QueryCache(const QueryCache& other) : m_capacity(other.capacity())
+{
+}
+
+QueryCache& QueryCache::operator=(const QueryCache& other)
+{
+    if (this != &other)
+    {
+        std::size_t capacity = other.capacity();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        clearEntries();
+        m_capacity = capacity;
+    }
+
+    return *this;
+}
+
+void QueryCache::setCapacity(std::size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capacity = capacity;
+    evictToCapacity();
+}
+
+bool QueryCache::find(QueryKind kind, query::Key key, std::uint64_t generation, index_cont_t& indexes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        it = lookup(kind, key, generation);
+
+    if (it == m_entries.end())
+    {
+        return false;
+    }
+
+    indexes.insert(indexes.end(), it->indexes.begin(), it->indexes.end());
+    return true;
+}
+
+bool QueryCache::count(QueryKind kind, query::Key key, std::uint64_t generation, std::size_t& count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        it = lookup(kind, key, generation);
+
+    if (it == m_entries.end())
+    {
+        return false;
+    }
+
+    count = it->indexes.size();
+    return true;
+}
+
+void QueryCache::insert(QueryKind kind, query::Key key, std::uint64_t generation, index_cont_t indexes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_capacity == 0)
+    {
+        return;
+    }
+
+    std::string full_key = makeKey(kind, key);
+    auto        it       = m_lookup.find(full_key);
+
+    if (it != m_lookup.end())
+    {
+        erase(it->second);
+    }
+
+    m_entries.push_front(Entry{full_key, generation, std::move(indexes)});
+    m_lookup.emplace(std::move(full_key), m_entries.begin());
+    m_bytes += entryBytes(m_entries.front());
+
+    evictToCapacity();
+}
+
+void QueryCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    clearEntries();
+}
+
+QueryCacheStats QueryCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    QueryCacheStats result;
+    result.hits      = m_hits;
+    result.misses    = m_misses;
+    result.evictions = m_evictions;
+    result.entries   = m_entries.size();
+    result.capacity  = m_capacity;
+    result.bytes     = m_bytes;
+
+    return result;
+}
+
+std::string QueryCache::makeKey(QueryKind kind, query::Key key)
+{
+    std::string result;
+    result.reserve(key.size() + 1);
+    result.push_back(static_cast<char>(kind));
+    result.append(key.data(), key.size());
+
+    return result;
+}
+
+std::size_t QueryCache::entryBytes(const Entry& entry)
+{
+    // The key is stored both in the entry and in the lookup table
+    return sizeof(Entry) + 2 * (sizeof(std::string) + entry.key.capacity()) +
+           entry.indexes.capacity() * sizeof(std::size_t);
+}
+
+QueryCache::entry_cont_t::iterator QueryCache::lookup(QueryKind kind, query::Key key,
+                                                      std::uint64_t generation)
+{
+    if (m_capacity == 0)
+    {
+        return m_entries.end();
+    }
+
+    auto it = m_lookup.find(makeKey(kind, key));
+
+    if (it == m_lookup.end())
+    {
+        m_misses++;
+        return m_entries.end();
+    }
+
+    // A result computed for an older generation of the board is never served
+    if (it->second->generation != generation)
+    {
+        erase(it->second);
+        m_misses++;
+        return m_entries.end();
+    }
+
+    // Move the entry to the front, i.e. make it the most recently used one
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    m_hits++;
+
+    return m_entries.begin();
+}
+
+void QueryCache::erase(entry_cont_t::iterator it)
+{
+    m_bytes -= entryBytes(*it);
+    m_lookup.erase(it->key);
+    m_entries.erase(it);
+}
+
+void QueryCache::clearEntries()
+{
+    m_entries.clear();
+    m_lookup.clear();
+    m_bytes = 0;
+}
+
+void QueryCache::evictToCapacity()
+{
+    while (m_entries.size() > m_capacity)
+    {
+        erase(std::prev(m_entries.end()));
+        m_evictions++;
+    }
+}
+
+}  // End of namespace storyboard
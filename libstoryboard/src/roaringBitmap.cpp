@@ -0,0 +1,661 @@
+#include <algorithm>
+#include <iterator>
+
+#include <storyboard/roaringBitmap.hpp>
+
+namespace storyboard {
+
+namespace {
+
+// A run container is larger than a bitmap container beyond this many runs
+const std::size_t MAX_NR_RUNS = 2048;
+
+void setRange(std::uint64_t* words, std::uint32_t first, std::uint32_t last)
+{
+    std::uint32_t first_word = first / 64;
+    std::uint32_t last_word  = last / 64;
+    std::uint64_t first_mask = ~0ULL << (first % 64);
+    std::uint64_t last_mask  = ~0ULL >> (63 - last % 64);
+
+    if (first_word == last_word)
+    {
+        words[first_word] |= first_mask & last_mask;
+        return;
+    }
+
+    words[first_word] |= first_mask;
+    std::fill(words + first_word + 1, words + last_word, ~0ULL);
+    words[last_word] |= last_mask;
+}
+
+}  // namespace
+
+bool RoaringBitmap::Container::add(std::uint16_t value)
+{
+    switch (type)
+    {
+        case Type::Array:
+        {
+            if (values.empty() || (value > values.back()))
+            {
+                values.push_back(value);
+            }
+            else
+            {
+                auto it = std::lower_bound(values.begin(), values.end(), value);
+
+                if (*it == value)
+                {
+                    return false;
+                }
+
+                values.insert(it, value);
+            }
+
+            if (++cardinality > MAX_ARRAY_SIZE)
+            {
+                optimize();
+            }
+
+            return true;
+        }
+
+        case Type::Bitmap:
+        {
+            std::uint64_t& word = words[value / 64];
+            std::uint64_t  bit  = 1ULL << (value % 64);
+
+            if (word & bit)
+            {
+                return false;
+            }
+
+            word |= bit;
+            cardinality++;
+            return true;
+        }
+
+        case Type::Run:
+        {
+            // Values are usually appended, which extends the last run or starts a new one
+            std::uint32_t last_end = runs.empty() ? 0 : std::uint32_t(runs.back().start) + runs.back().length;
+
+            if (runs.empty() || (value > last_end + 1))
+            {
+                runs.push_back(Run{value, 0});
+            }
+            else if (value == last_end + 1)
+            {
+                runs.back().length++;
+            }
+            else
+            {
+                auto next = std::upper_bound(runs.begin(), runs.end(), value,
+                                             [](std::uint16_t lhs, const Run& rhs) { return lhs < rhs.start; });
+                bool merge_previous = false;
+
+                if (next != runs.begin())
+                {
+                    std::uint32_t previous_end = std::uint32_t(std::prev(next)->start) + std::prev(next)->length;
+
+                    if (value <= previous_end)
+                    {
+                        return false;
+                    }
+
+                    merge_previous = (value == previous_end + 1);
+                }
+
+                bool merge_next = (next != runs.end()) && (std::uint32_t(value) + 1 == next->start);
+
+                if (merge_previous && merge_next)
+                {
+                    auto previous    = std::prev(next);
+                    previous->length = static_cast<std::uint16_t>(next->start + next->length - previous->start);
+                    runs.erase(next);
+                }
+                else if (merge_previous)
+                {
+                    std::prev(next)->length++;
+                }
+                else if (merge_next)
+                {
+                    next->start--;
+                    next->length++;
+                }
+                else
+                {
+                    runs.insert(next, Run{value, 0});
+                }
+            }
+
+            cardinality++;
+
+            if (runs.size() > MAX_NR_RUNS)
+            {
+                optimize();
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool RoaringBitmap::Container::remove(std::uint16_t value)
+{
+    switch (type)
+    {
+        case Type::Array:
+        {
+            auto it = std::lower_bound(values.begin(), values.end(), value);
+
+            if ((it == values.end()) || (*it != value))
+            {
+                return false;
+            }
+
+            values.erase(it);
+            cardinality--;
+            return true;
+        }
+
+        case Type::Bitmap:
+        {
+            std::uint64_t& word = words[value / 64];
+            std::uint64_t  bit  = 1ULL << (value % 64);
+
+            if (!(word & bit))
+            {
+                return false;
+            }
+
+            word &= ~bit;
+
+            if (--cardinality <= MAX_ARRAY_SIZE)
+            {
+                optimize();
+            }
+
+            return true;
+        }
+
+        case Type::Run:
+        {
+            auto next = std::upper_bound(runs.begin(), runs.end(), value,
+                                         [](std::uint16_t lhs, const Run& rhs) { return lhs < rhs.start; });
+
+            if (next == runs.begin())
+            {
+                return false;
+            }
+
+            auto          run = std::prev(next);
+            std::uint32_t end = std::uint32_t(run->start) + run->length;
+
+            if (value > end)
+            {
+                return false;
+            }
+
+            if (run->length == 0)
+            {
+                runs.erase(run);
+            }
+            else if (value == run->start)
+            {
+                run->start++;
+                run->length--;
+            }
+            else if (value == end)
+            {
+                run->length--;
+            }
+            else
+            {
+                // The run is split in two around the value
+                Run after{static_cast<std::uint16_t>(value + 1), static_cast<std::uint16_t>(end - value - 1)};
+                run->length = static_cast<std::uint16_t>(value - run->start - 1);
+                runs.insert(next, after);
+            }
+
+            cardinality--;
+
+            if (runs.size() > MAX_NR_RUNS)
+            {
+                optimize();
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool RoaringBitmap::Container::contains(std::uint16_t value) const
+{
+    switch (type)
+    {
+        case Type::Array:
+            return std::binary_search(values.begin(), values.end(), value);
+
+        case Type::Bitmap:
+            return (words[value / 64] & (1ULL << (value % 64))) != 0;
+
+        case Type::Run:
+        {
+            auto next = std::upper_bound(runs.begin(), runs.end(), value,
+                                         [](std::uint16_t lhs, const Run& rhs) { return lhs < rhs.start; });
+
+            return (next != runs.begin()) && (value <= std::uint32_t(std::prev(next)->start) + std::prev(next)->length);
+        }
+    }
+
+    return false;
+}
+
+void RoaringBitmap::Container::fillWords(std::uint64_t* target) const
+{
+    switch (type)
+    {
+        case Type::Array:
+            for (auto value : values)
+            {
+                target[value / 64] |= 1ULL << (value % 64);
+            }
+            break;
+
+        case Type::Bitmap:
+            for (std::uint32_t index = 0; index < NR_WORDS; index++)
+            {
+                target[index] |= words[index];
+            }
+            break;
+
+        case Type::Run:
+            for (auto& run : runs)
+            {
+                setRange(target, run.start, std::uint32_t(run.start) + run.length);
+            }
+            break;
+    }
+}
+
+void RoaringBitmap::Container::optimize()
+{
+    std::size_t nr_runs = 0;
+
+    switch (type)
+    {
+        case Type::Array:
+            for (std::size_t index = 0; index < values.size(); index++)
+            {
+                nr_runs += (index == 0) || (values[index] != values[index - 1] + 1);
+            }
+            break;
+
+        case Type::Bitmap:
+        {
+            // A run starts at each set bit whose lower neighbour is clear
+            std::uint64_t carry = 0;
+
+            for (auto word : words)
+            {
+                nr_runs += popCount(word & ~((word << 1) | carry));
+                carry = word >> 63;
+            }
+            break;
+        }
+
+        case Type::Run:
+            nr_runs = runs.size();
+            break;
+    }
+
+    std::size_t array_bytes  = cardinality * sizeof(std::uint16_t);
+    std::size_t bitmap_bytes = NR_WORDS * sizeof(std::uint64_t);
+    std::size_t run_bytes    = nr_runs * sizeof(Run);
+
+    Type best = Type::Bitmap;
+
+    if ((run_bytes < bitmap_bytes) && (run_bytes < array_bytes))
+    {
+        best = Type::Run;
+    }
+    else if (array_bytes < bitmap_bytes)
+    {
+        best = Type::Array;
+    }
+
+    if (best == type)
+    {
+        return;
+    }
+
+    Container result;
+    result.type        = best;
+    result.cardinality = cardinality;
+
+    switch (best)
+    {
+        case Type::Array:
+            result.values.reserve(cardinality);
+            forEach(0, [&result](std::uint32_t value) { result.values.push_back(static_cast<std::uint16_t>(value)); });
+            break;
+
+        case Type::Bitmap:
+            result.words.assign(NR_WORDS, 0);
+            fillWords(result.words.data());
+            break;
+
+        case Type::Run:
+        {
+            std::vector<Run>& runs = result.runs;
+            runs.reserve(nr_runs);
+            forEach(0, [&runs](std::uint32_t value) {
+                if (!runs.empty() && (std::uint32_t(runs.back().start) + runs.back().length + 1 == value))
+                {
+                    runs.back().length++;
+                }
+                else
+                {
+                    runs.push_back(Run{static_cast<std::uint16_t>(value), 0});
+                }
+            });
+            break;
+        }
+    }
+
+    *this = std::move(result);
+}
+
+std::size_t RoaringBitmap::Container::bytes() const
+{
+    return values.size() * sizeof(std::uint16_t) + words.size() * sizeof(std::uint64_t) + runs.size() * sizeof(Run);
+}
+
+RoaringBitmap::Container RoaringBitmap::Container::orOf(const Container& lhs, const Container& rhs)
+{
+    Container result;
+
+    if ((lhs.type == Type::Array) && (rhs.type == Type::Array) &&
+        (lhs.cardinality + rhs.cardinality <= MAX_ARRAY_SIZE))
+    {
+        result.values.reserve(lhs.cardinality + rhs.cardinality);
+        std::set_union(lhs.values.begin(), lhs.values.end(), rhs.values.begin(), rhs.values.end(),
+                       std::back_inserter(result.values));
+        result.cardinality = result.values.size();
+        return result;
+    }
+
+    result.type = Type::Bitmap;
+    result.words.assign(NR_WORDS, 0);
+    lhs.fillWords(result.words.data());
+    rhs.fillWords(result.words.data());
+
+    for (auto word : result.words)
+    {
+        result.cardinality += popCount(word);
+    }
+
+    result.optimize();
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::Container::andOf(const Container& lhs, const Container& rhs)
+{
+    Container result;
+
+    // An array only keeps values, so the result is at most as large as the array
+    if ((lhs.type == Type::Array) || (rhs.type == Type::Array))
+    {
+        const Container& array = lhs.type == Type::Array ? lhs : rhs;
+        const Container& other = lhs.type == Type::Array ? rhs : lhs;
+
+        for (auto value : array.values)
+        {
+            if (other.contains(value))
+            {
+                result.values.push_back(value);
+            }
+        }
+
+        result.cardinality = result.values.size();
+        return result;
+    }
+
+    std::vector<std::uint64_t> other(NR_WORDS, 0);
+    rhs.fillWords(other.data());
+
+    result.type = Type::Bitmap;
+    result.words.assign(NR_WORDS, 0);
+    lhs.fillWords(result.words.data());
+
+    for (std::uint32_t index = 0; index < NR_WORDS; index++)
+    {
+        result.words[index] &= other[index];
+        result.cardinality += popCount(result.words[index]);
+    }
+
+    result.optimize();
+    return result;
+}
+
+std::size_t RoaringBitmap::Container::andCardinality(const Container& lhs, const Container& rhs)
+{
+    std::size_t cardinality = 0;
+
+    if ((lhs.type == Type::Array) || (rhs.type == Type::Array))
+    {
+        const Container& array = lhs.type == Type::Array ? lhs : rhs;
+        const Container& other = lhs.type == Type::Array ? rhs : lhs;
+
+        for (auto value : array.values)
+        {
+            cardinality += other.contains(value);
+        }
+
+        return cardinality;
+    }
+
+    if ((lhs.type == Type::Bitmap) && (rhs.type == Type::Bitmap))
+    {
+        for (std::uint32_t index = 0; index < NR_WORDS; index++)
+        {
+            cardinality += popCount(lhs.words[index] & rhs.words[index]);
+        }
+
+        return cardinality;
+    }
+
+    return andOf(lhs, rhs).cardinality;
+}
+
+RoaringBitmap::Container& RoaringBitmap::containerFor(std::uint16_t key)
+{
+    // Values are usually added in increasing order, so the last container is checked first
+    if (m_keys.empty() || (key > m_keys.back()))
+    {
+        m_keys.push_back(key);
+        m_containers.emplace_back();
+        return m_containers.back();
+    }
+
+    auto           it    = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+    std::ptrdiff_t index = it - m_keys.begin();
+
+    if (*it != key)
+    {
+        m_keys.insert(it, key);
+        m_containers.emplace(m_containers.begin() + index);
+    }
+
+    return m_containers[index];
+}
+
+bool RoaringBitmap::add(std::uint32_t value)
+{
+    std::size_t array_bytes = arrayBytes();
+    Container&  container   = containerFor(static_cast<std::uint16_t>(value >> 16));
+    std::size_t before      = container.bytes();
+    bool        added       = container.add(static_cast<std::uint16_t>(value));
+
+    m_cardinality += added;
+    m_bytes += (arrayBytes() - array_bytes) + container.bytes() - before;
+    return added;
+}
+
+bool RoaringBitmap::remove(std::uint32_t value)
+{
+    std::uint16_t key = static_cast<std::uint16_t>(value >> 16);
+    auto          it  = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+
+    if ((it == m_keys.end()) || (*it != key))
+    {
+        return false;
+    }
+
+    std::ptrdiff_t index     = it - m_keys.begin();
+    Container&     container = m_containers[index];
+    std::size_t    before    = container.bytes();
+
+    if (!container.remove(static_cast<std::uint16_t>(value)))
+    {
+        return false;
+    }
+
+    m_bytes += container.bytes() - before;
+
+    if (container.cardinality == 0)
+    {
+        m_bytes -= container.bytes() + sizeof(std::uint16_t) + sizeof(Container);
+        m_keys.erase(it);
+        m_containers.erase(m_containers.begin() + index);
+    }
+
+    m_cardinality--;
+    return true;
+}
+
+bool RoaringBitmap::contains(std::uint32_t value) const
+{
+    std::uint16_t key = static_cast<std::uint16_t>(value >> 16);
+    auto          it  = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+
+    return (it != m_keys.end()) && (*it == key) &&
+           m_containers[it - m_keys.begin()].contains(static_cast<std::uint16_t>(value));
+}
+
+RoaringBitmap& RoaringBitmap::operator|=(const RoaringBitmap& other)
+{
+    std::vector<std::uint16_t> keys;
+    std::vector<Container>     containers;
+    std::size_t                lhs = 0;
+    std::size_t                rhs = 0;
+
+    keys.reserve(m_keys.size() + other.m_keys.size());
+    containers.reserve(m_keys.size() + other.m_keys.size());
+    m_cardinality = 0;
+
+    while ((lhs < m_keys.size()) || (rhs < other.m_keys.size()))
+    {
+        if ((rhs == other.m_keys.size()) || ((lhs < m_keys.size()) && (m_keys[lhs] < other.m_keys[rhs])))
+        {
+            keys.push_back(m_keys[lhs]);
+            containers.push_back(std::move(m_containers[lhs++]));
+        }
+        else if ((lhs == m_keys.size()) || (other.m_keys[rhs] < m_keys[lhs]))
+        {
+            keys.push_back(other.m_keys[rhs]);
+            containers.push_back(other.m_containers[rhs++]);
+        }
+        else
+        {
+            keys.push_back(m_keys[lhs]);
+            containers.push_back(Container::orOf(m_containers[lhs++], other.m_containers[rhs++]));
+        }
+
+        m_cardinality += containers.back().cardinality;
+    }
+
+    m_keys.swap(keys);
+    m_containers.swap(containers);
+    updateBytes();
+    return *this;
+}
+
+RoaringBitmap& RoaringBitmap::operator&=(const RoaringBitmap& other)
+{
+    std::size_t write = 0;
+    std::size_t rhs   = 0;
+
+    m_cardinality = 0;
+
+    // Only the keys present in both sets can remain, so the containers are filtered in place
+    for (std::size_t lhs = 0; lhs < m_keys.size(); lhs++)
+    {
+        while ((rhs < other.m_keys.size()) && (other.m_keys[rhs] < m_keys[lhs]))
+        {
+            rhs++;
+        }
+
+        if ((rhs == other.m_keys.size()) || (other.m_keys[rhs] != m_keys[lhs]))
+        {
+            continue;
+        }
+
+        Container container = Container::andOf(m_containers[lhs], other.m_containers[rhs]);
+
+        if (container.cardinality > 0)
+        {
+            m_cardinality += container.cardinality;
+            m_keys[write]         = m_keys[lhs];
+            m_containers[write++] = std::move(container);
+        }
+    }
+
+    m_keys.resize(write);
+    m_containers.resize(write);
+    updateBytes();
+    return *this;
+}
+
+std::size_t RoaringBitmap::andCardinality(const RoaringBitmap& lhs, const RoaringBitmap& rhs)
+{
+    std::size_t cardinality = 0;
+    std::size_t right       = 0;
+
+    for (std::size_t left = 0; left < lhs.m_keys.size(); left++)
+    {
+        while ((right < rhs.m_keys.size()) && (rhs.m_keys[right] < lhs.m_keys[left]))
+        {
+            right++;
+        }
+
+        if ((right < rhs.m_keys.size()) && (rhs.m_keys[right] == lhs.m_keys[left]))
+        {
+            cardinality += Container::andCardinality(lhs.m_containers[left], rhs.m_containers[right]);
+        }
+    }
+
+    return cardinality;
+}
+
+std::size_t RoaringBitmap::arrayBytes() const
+{
+    return m_keys.size() * sizeof(std::uint16_t) + m_containers.size() * sizeof(Container);
+}
+
+void RoaringBitmap::updateBytes()
+{
+    m_bytes = arrayBytes();
+
+    for (auto& container : m_containers)
+    {
+        m_bytes += container.bytes();
+    }
+}
+
+}  // End of namespace storyboard
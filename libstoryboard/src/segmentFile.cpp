@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+
+#include <storyboard/segmentFile.hpp>
+
+namespace storyboard {
+
+std::shared_ptr<SegmentFile> SegmentFile::create(const std::string& directory)
+{
+    std::random_device device;
+    std::mt19937_64    generator((std::uint64_t(device()) << 32) ^ device());
+
+    // Several boards, or processes, may spill into the same directory
+    for (int attempt = 0; attempt < 16; attempt++)
+    {
+        char name[40];
+        std::snprintf(name, sizeof(name), "/storyboard-%016llx.seg", static_cast<unsigned long long>(generator()));
+        std::string path = directory + name;
+
+        if (std::FILE* existing = std::fopen(path.c_str(), "rb"))
+        {
+            std::fclose(existing);
+            continue;
+        }
+
+        if (std::FILE* file = std::fopen(path.c_str(), "w+b"))
+        {
+            return std::shared_ptr<SegmentFile>(new SegmentFile(directory, path, file));
+        }
+
+        break;
+    }
+
+    throw std::runtime_error("cannot create a segment file in " + directory);
+}
+
+SegmentFile::SegmentFile(std::string directory, std::string path, std::FILE* file)
+    : m_directory(std::move(directory)), m_path(std::move(path)), m_file(file)
+{
+}
+
+SegmentFile::~SegmentFile()
+{
+    std::fclose(m_file);
+    std::remove(m_path.c_str());
+}
+
+void SegmentFile::seek(std::uint64_t offset) const
+{
+#if defined(_MSC_VER)
+    int result = _fseeki64(m_file, static_cast<__int64>(offset), SEEK_SET);
+#else
+    int result = fseeko(m_file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+
+    if (result != 0)
+    {
+        throw std::runtime_error("cannot seek in segment file " + m_path);
+    }
+}
+
+std::uint64_t SegmentFile::append(const std::string& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Reads move the position, and switching from reading to writing needs a seek anyway
+    seek(m_size);
+
+    if (std::fwrite(data.data(), 1, data.size(), m_file) != data.size())
+    {
+        throw std::runtime_error("cannot write to segment file " + m_path);
+    }
+
+    std::uint64_t offset = m_size;
+    m_size += data.size();
+    return offset;
+}
+
+void SegmentFile::read(std::uint64_t offset, std::size_t size, std::string& data) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    data.resize(size);
+    seek(offset);
+
+    if (std::fread(&data[0], 1, size, m_file) != size)
+    {
+        throw std::runtime_error("cannot read from segment file " + m_path);
+    }
+}
+
+std::uint64_t SegmentFile::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+}  // End of namespace storyboard
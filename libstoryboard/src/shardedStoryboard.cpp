@@ -0,0 +1,569 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+#include <storyboard/hash.hpp>
+#include <storyboard/shardedStoryboard.hpp>
+#include <storyboard/threadPool.hpp>
+
+namespace storyboard {
+
+ShardedStoryboard::ShardedStoryboard(std::size_t nr_shards)
+{
+    for (std::size_t index = 0; index < std::max<std::size_t>(nr_shards, 1); index++)
+    {
+        m_shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+ShardedStoryboard::ShardedStoryboard(const ShardedStoryboard& other)
+{
+    for (auto& shard : other.m_shards)
+    {
+        read_lock_t lock(shard->mutex);
+
+        m_shards.push_back(std::make_unique<Shard>());
+        m_shards.back()->board = shard->board;
+    }
+}
+
+std::size_t ShardedStoryboard::nrShards() const
+{
+    return m_shards.size();
+}
+
+std::size_t ShardedStoryboard::shardIndex(query::Key title) const
+{
+    return hashBytes(title.data(), title.size()) % m_shards.size();
+}
+
+ShardedStoryboard::Shard& ShardedStoryboard::shardOf(query::Key title)
+{
+    return *m_shards[shardIndex(title)];
+}
+
+template <typename Fn>
+void ShardedStoryboard::forEachShard(Fn&& fn) const
+{
+    if (m_shards.size() == 1)
+    {
+        fn(*m_shards.front(), 0);
+        return;
+    }
+
+    std::thread::id            caller = std::this_thread::get_id();
+    std::atomic<std::uint64_t> scanned_by_workers{0};
+
+    ThreadPool::shared().parallelFor(m_shards.size(), [&](std::size_t index) {
+        std::uint64_t scanned = Storyboard::notesScanned();
+        fn(*m_shards[index], index);
+
+        if (std::this_thread::get_id() != caller)
+        {
+            scanned_by_workers += Storyboard::notesScanned() - scanned;
+        }
+    });
+
+    Storyboard::addNotesScanned(scanned_by_workers);
+}
+
+template <typename Search>
+int ShardedStoryboard::runSearch(const note_visitor_t& visitor, Search&& search)
+{
+    if (m_shards.size() == 1)
+    {
+        read_lock_t lock(m_shards.front()->mutex);
+        return search(m_shards.front()->board, visitor);
+    }
+
+    // The read locks are held until the visitor has seen the results, since the results point into the shards
+    std::vector<read_lock_t> locks;
+    for (auto& shard : m_shards)
+    {
+        locks.emplace_back(shard->mutex);
+    }
+
+    std::vector<std::vector<const Note*>> results(m_shards.size());
+
+    forEachShard([&search, &results](Shard& shard, std::size_t index) {
+        std::vector<const Note*>& result = results[index];
+        search(shard.board, [&result](const Note& note) { result.push_back(&note); });
+    });
+
+    int nr_results = 0;
+
+    for (auto& result : results)
+    {
+        for (auto note : result)
+        {
+            visitor(*note);
+        }
+
+        nr_results += result.size();
+    }
+
+    return nr_results;
+}
+
+template <typename Query>
+int ShardedStoryboard::runTagQuery(tag_stats_cont_t& container, Query&& query)
+{
+    std::vector<tag_stats_cont_t> results(m_shards.size());
+
+    forEachShard([&query, &results](Shard& shard, std::size_t index) {
+        read_lock_t lock(shard.mutex);
+        query(shard.board, results[index]);
+    });
+
+    if (m_shards.size() == 1)
+    {
+        container.insert(container.end(), results.front().begin(), results.front().end());
+        return results.front().size();
+    }
+
+    std::unordered_map<std::string, int> counts;
+
+    for (auto& result : results)
+    {
+        for (auto& elem : result)
+        {
+            counts[elem.first] += elem.second;
+        }
+    }
+
+    container.insert(container.end(), counts.begin(), counts.end());
+    return counts.size();
+}
+
+bool ShardedStoryboard::addNote(const Note& newNote)
+{
+    Shard&       shard = shardOf(newNote.getTitle());
+    write_lock_t lock(shard.mutex);
+
+    return shard.board.addNote(newNote);
+}
+
+int ShardedStoryboard::addNotes(std::vector<Note>&& newNotes)
+{
+    if (m_shards.size() == 1)
+    {
+        write_lock_t lock(m_shards.front()->mutex);
+        return m_shards.front()->board.addNotes(std::move(newNotes));
+    }
+
+    int nr_added = 0;
+
+    std::vector<std::vector<Note>> batches(m_shards.size());
+
+    for (auto& newNote : newNotes)
+    {
+        batches[shardIndex(newNote.getTitle())].push_back(std::move(newNote));
+    }
+
+    for (std::size_t index = 0; index < m_shards.size(); index++)
+    {
+        if (!batches[index].empty())
+        {
+            write_lock_t lock(m_shards[index]->mutex);
+            nr_added += m_shards[index]->board.addNotes(std::move(batches[index]));
+        }
+    }
+
+    return nr_added;
+}
+
+void ShardedStoryboard::setRejectDuplicates(bool reject)
+{
+    for (auto& shard : m_shards)
+    {
+        write_lock_t lock(shard->mutex);
+        shard->board.setRejectDuplicates(reject);
+    }
+}
+
+int ShardedStoryboard::merge(const ShardedStoryboard& source, MergePolicy policy)
+{
+    std::atomic<int> nr_added{0};
+
+    if ((&source != this) && (source.m_shards.size() == m_shards.size()))
+    {
+        // Equal notes have equal titles, so the shards of the same index hold the notes to compare
+        forEachShard([&source, policy, &nr_added](Shard& shard, std::size_t index) {
+            Shard&       from = *source.m_shards[index];
+            read_lock_t  source_lock(from.mutex, std::defer_lock);
+            write_lock_t lock(shard.mutex, std::defer_lock);
+
+            // Avoids a deadlock with a merge in the other direction
+            std::lock(source_lock, lock);
+            nr_added += shard.board.merge(from.board, policy);
+        });
+
+        return nr_added;
+    }
+
+    std::vector<std::vector<Note>> batches(m_shards.size());
+
+    for (auto& from : source.m_shards)
+    {
+        read_lock_t lock(from->mutex);
+        from->board.search(query::any(), [this, &batches](const Note& note) {
+            batches[shardIndex(note.getTitle())].push_back(note);
+        });
+    }
+
+    for (std::size_t index = 0; index < m_shards.size(); index++)
+    {
+        if (!batches[index].empty())
+        {
+            write_lock_t lock(m_shards[index]->mutex);
+            nr_added += m_shards[index]->board.addNotes(std::move(batches[index]), policy);
+        }
+    }
+
+    return nr_added;
+}
+
+int ShardedStoryboard::diff(const ShardedStoryboard& other, const note_visitor_t& added,
+                            const note_visitor_t& removed) const
+{
+    if (&other == this)
+    {
+        return 0;
+    }
+
+    // The boards are always locked in the same order, so that two diffs in opposite directions cannot deadlock while
+    // a writer is waiting
+    bool                     this_first = std::less<const ShardedStoryboard*>()(this, &other);
+    std::vector<read_lock_t> locks;
+
+    for (auto board : {this_first ? this : &other, this_first ? &other : this})
+    {
+        for (auto& shard : board->m_shards)
+        {
+            locks.emplace_back(shard->mutex);
+        }
+    }
+
+    std::vector<RoaringBitmap> claimed(m_shards.size());
+    int                        nr_changes = 0;
+
+    for (auto& shard : other.m_shards)
+    {
+        shard->board.search(query::any(), [this, &added, &claimed, &nr_changes](const Note& note) {
+            std::size_t index = shardIndex(note.getTitle());
+
+            if (!m_shards[index]->board.claimEqual(note, claimed[index]))
+            {
+                added(note);
+                nr_changes++;
+            }
+        });
+    }
+
+    for (std::size_t index = 0; index < m_shards.size(); index++)
+    {
+        nr_changes += m_shards[index]->board.visitUnclaimed(claimed[index], removed);
+    }
+
+    return nr_changes;
+}
+
+int ShardedStoryboard::deleteNote(const Note& deleteMe)
+{
+    Shard&       shard = shardOf(deleteMe.getTitle());
+    write_lock_t lock(shard.mutex);
+
+    return shard.board.deleteNote(deleteMe);
+}
+
+int ShardedStoryboard::deleteByTitle(query::Key title)
+{
+    Shard&       shard = shardOf(title);
+    write_lock_t lock(shard.mutex);
+
+    return shard.board.deleteByTitle(title);
+}
+
+int ShardedStoryboard::deleteByText(query::Key text)
+{
+    std::atomic<int> nr_deleted{0};
+
+    forEachShard([&text, &nr_deleted](Shard& shard, std::size_t) {
+        write_lock_t lock(shard.mutex);
+        nr_deleted += shard.board.deleteByText(text);
+    });
+
+    return nr_deleted;
+}
+
+int ShardedStoryboard::deleteByTag(const tag_cont_t& tags)
+{
+    std::atomic<int> nr_deleted{0};
+
+    forEachShard([&tags, &nr_deleted](Shard& shard, std::size_t) {
+        write_lock_t lock(shard.mutex);
+        nr_deleted += shard.board.deleteByTag(tags);
+    });
+
+    return nr_deleted;
+}
+
+void ShardedStoryboard::setDeleteMode(DeleteMode mode)
+{
+    for (auto& shard : m_shards)
+    {
+        write_lock_t lock(shard->mutex);
+        shard->board.setDeleteMode(mode);
+    }
+}
+
+int ShardedStoryboard::nrTombstones() const
+{
+    int nr_tombstones = 0;
+
+    for (auto& shard : m_shards)
+    {
+        read_lock_t lock(shard->mutex);
+        nr_tombstones += shard->board.nrTombstones();
+    }
+
+    return nr_tombstones;
+}
+
+int ShardedStoryboard::compact()
+{
+    int nr_reclaimed = 0;
+
+    for (auto& shard : m_shards)
+    {
+        nr_reclaimed += compactShard(*shard);
+    }
+
+    return nr_reclaimed;
+}
+
+int ShardedStoryboard::compactShard(Shard& shard)
+{
+    const int  MAX_ATTEMPTS = 3;
+    Compaction compaction;
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++)
+    {
+        {
+            read_lock_t lock(shard.mutex);
+
+            if (shard.board.nrTombstones() == 0)
+            {
+                return 0;
+            }
+
+            shard.board.prepareCompaction(compaction);
+        }
+
+        // The old notes are released by the destructor of compaction, after the write lock is gone
+        write_lock_t lock(shard.mutex);
+
+        if (shard.board.commitCompaction(compaction))
+        {
+            return compaction.nr_reclaimed;
+        }
+    }
+
+    // The shard keeps being modified between the phases, so compact it while holding the write lock
+    write_lock_t lock(shard.mutex);
+    return shard.board.compact();
+}
+
+int ShardedStoryboard::searchByTitle(query::Key title, const note_visitor_t& visitor)
+{
+    // Notes with the same title are always in the same shard
+    Shard&      shard = shardOf(title);
+    read_lock_t lock(shard.mutex);
+
+    return shard.board.searchByTitle(title, visitor);
+}
+
+int ShardedStoryboard::searchByText(query::Key text, const note_visitor_t& visitor)
+{
+    return runSearch(visitor, [&text](Storyboard& board, const note_visitor_t& sink) {
+        return board.searchByText(text, sink);
+    });
+}
+
+int ShardedStoryboard::searchByTag(const tag_cont_t& tags, const note_visitor_t& visitor, TagMatch match)
+{
+    return runSearch(visitor, [&tags, match](Storyboard& board, const note_visitor_t& sink) {
+        return board.searchByTag(tags, sink, match);
+    });
+}
+
+int ShardedStoryboard::countByTitle(query::Key title)
+{
+    Shard&      shard = shardOf(title);
+    read_lock_t lock(shard.mutex);
+
+    return shard.board.countByTitle(title);
+}
+
+int ShardedStoryboard::countByText(query::Key text)
+{
+    std::atomic<int> nr_results{0};
+
+    forEachShard([&text, &nr_results](Shard& shard, std::size_t) {
+        read_lock_t lock(shard.mutex);
+        nr_results += shard.board.countByText(text);
+    });
+
+    return nr_results;
+}
+
+int ShardedStoryboard::countByTag(const tag_cont_t& tags, TagMatch match)
+{
+    std::atomic<int> nr_results{0};
+
+    // Single tag counts come from the tag statistics of the shards, which is cheaper than waking up the workers
+    if (tags.size() == 1)
+    {
+        for (auto& shard : m_shards)
+        {
+            read_lock_t lock(shard->mutex);
+            nr_results += shard->board.countByTag(tags, match);
+        }
+
+        return nr_results;
+    }
+
+    forEachShard([&tags, match, &nr_results](Shard& shard, std::size_t) {
+        read_lock_t lock(shard.mutex);
+        nr_results += shard.board.countByTag(tags, match);
+    });
+
+    return nr_results;
+}
+
+int ShardedStoryboard::getTagStats(tag_stats_cont_t& container)
+{
+    return runTagQuery(container, [](Storyboard& board, tag_stats_cont_t& result) { board.getTagStats(result); });
+}
+
+int ShardedStoryboard::facetsByTitle(query::Key title, tag_stats_cont_t& container)
+{
+    Shard&      shard = shardOf(title);
+    read_lock_t lock(shard.mutex);
+
+    return shard.board.facetsByTitle(title, container);
+}
+
+int ShardedStoryboard::facetsByText(query::Key text, tag_stats_cont_t& container)
+{
+    return runTagQuery(container,
+                       [&text](Storyboard& board, tag_stats_cont_t& result) { board.facetsByText(text, result); });
+}
+
+int ShardedStoryboard::facetsByTag(const tag_cont_t& tags, tag_stats_cont_t& container)
+{
+    return runTagQuery(container,
+                       [&tags](Storyboard& board, tag_stats_cont_t& result) { board.facetsByTag(tags, result); });
+}
+
+int ShardedStoryboard::length() const
+{
+    int length = 0;
+
+    for (auto& shard : m_shards)
+    {
+        read_lock_t lock(shard->mutex);
+        length += shard->board.length();
+    }
+
+    return length;
+}
+
+void ShardedStoryboard::setQueryCacheCapacity(std::size_t capacity)
+{
+    for (auto& shard : m_shards)
+    {
+        write_lock_t lock(shard->mutex);
+        shard->board.setQueryCacheCapacity(capacity);
+    }
+}
+
+void ShardedStoryboard::setBlockFilter(std::size_t block_size, double false_positive_rate)
+{
+    for (auto& shard : m_shards)
+    {
+        write_lock_t lock(shard->mutex);
+        shard->board.setBlockFilter(block_size, false_positive_rate);
+    }
+}
+
+void ShardedStoryboard::setTextCompression(bool enable)
+{
+    forEachShard([enable](Shard& shard, std::size_t) {
+        write_lock_t lock(shard.mutex);
+        shard.board.setTextCompression(enable);
+    });
+}
+
+void ShardedStoryboard::setMemoryBudget(std::size_t bytes, const std::string& directory)
+{
+    // Each shard creates its segment file in turn, so that a failure is reported once
+    std::size_t shard_bytes = bytes ? std::max<std::size_t>(1, bytes / m_shards.size()) : 0;
+
+    for (auto& shard : m_shards)
+    {
+        write_lock_t lock(shard->mutex);
+        shard->board.setMemoryBudget(shard_bytes, directory);
+    }
+}
+
+QueryCacheStats ShardedStoryboard::queryCacheStats() const
+{
+    QueryCacheStats result;
+
+    for (auto& shard : m_shards)
+    {
+        read_lock_t     lock(shard->mutex);
+        QueryCacheStats stats = shard->board.queryCacheStats();
+
+        result.hits += stats.hits;
+        result.misses += stats.misses;
+        result.evictions += stats.evictions;
+        result.entries += stats.entries;
+        result.capacity += stats.capacity;
+        result.bytes += stats.bytes;
+    }
+
+    return result;
+}
+
+MemoryUsage ShardedStoryboard::memoryUsage() const
+{
+    MemoryUsage result;
+
+    for (auto& shard : m_shards)
+    {
+        read_lock_t lock(shard->mutex);
+        MemoryUsage usage = shard->board.memoryUsage();
+
+        result.notes += usage.notes;
+        result.titles += usage.titles;
+        result.texts += usage.texts;
+        result.tags += usage.tags;
+        result.slack += usage.slack;
+        result.tag_index += usage.tag_index;
+        result.content_index += usage.content_index;
+        result.query_cache += usage.query_cache;
+        result.tombstones += usage.tombstones;
+        result.filters += usage.filters;
+        result.dictionary += usage.dictionary;
+        result.total += usage.total;
+        result.spilled += usage.spilled;
+    }
+
+    return result;
+}
+
+}  // End of namespace storyboard
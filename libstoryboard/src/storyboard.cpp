@@ -1,11 +1,99 @@
 #include <algorithm>
 #include <iostream>
+#include <limits>
+#include <tuple>
 
+#include <storyboard/hash.hpp>
 #include <storyboard/storyboard.hpp>
 
 namespace storyboard {
 
-tag_cont_t& Note::getTags()
+namespace {
+
+// Number of notes examined on this thread, see Storyboard::notesScanned()
+thread_local std::uint64_t t_notes_scanned = 0;
+
+/**
+ * @brief Holds the ids of the notes that carry any or all of the given tags, computed up front from the tag postings,
+ * see Storyboard::matchTags(). The notes are never examined one by one.
+ */
+struct TagMatcher
+{
+    // Only there for forEachMatch(), which does not scan the notes since exactMatches() returns the matches
+    bool operator()(const Note&) const
+    {
+        return false;
+    }
+
+    RoaringBitmap matches;  /// Ids of the matching notes
+};
+
+// Compares the texts of two notes without copying them
+bool sameText(const Note& lhs, const Note& rhs)
+{
+    return lhs.withText([&rhs](const std::string& text) {
+        return rhs.withText([&text](const std::string& other) { return text == other; });
+    });
+}
+
+/**
+ * @brief Matches notes that are equal to the given one. The ids of the matching notes are found up front through the
+ * content hashes, see Storyboard::findByHash().
+ */
+struct NoteEquals
+{
+    bool operator()(const Note& cmp) const
+    {
+        return (cmp.getContentHash() == hash) && (cmp.getTitle() == note.getTitle()) &&
+               sameText(cmp, note) && (cmp.getTags() == tags);
+    }
+
+    const Note&   note;     /// Note that is matched
+    TagList       tags;     /// Tags of the note, normalized like the tags of the stored notes
+    std::uint64_t hash;     /// Content hash of the note
+    RoaringBitmap matches;  /// Ids of the matching notes
+};
+
+// The block filter keys a matching note must carry at least one of. Predicates that do not return any key cannot use
+// the block filters.
+template <typename Predicate>
+BlockFilter::key_cont_t filterKeys(const Predicate&)
+{
+    return {};
+}
+
+BlockFilter::key_cont_t filterKeys(const query::TitleEquals& predicate)
+{
+    return {BlockFilter::titleKey(predicate.m_key.data(), predicate.m_key.size())};
+}
+
+// The ids of the notes matching a predicate, if the predicate knows them without scanning the notes
+template <typename Predicate>
+const RoaringBitmap* exactMatches(const Predicate&)
+{
+    return nullptr;
+}
+
+const RoaringBitmap* exactMatches(const TagMatcher& predicate)
+{
+    return &predicate.matches;
+}
+
+const RoaringBitmap* exactMatches(const NoteEquals& predicate)
+{
+    return &predicate.matches;
+}
+
+// Results are copied with their own text, which stays valid however many other texts are decompressed
+void copyNote(const Note& note, note_cont_t& container)
+{
+    container.push_back(note);
+    container.back().detachText();
+}
+
+}  // namespace
+
+const TagList& Note::getTags() const
 {
     return m_tags;
 }
@@ -15,66 +103,1253 @@ std::string& Note::getTitle()
     return m_title;
 }
 
+const std::string& Note::getTitle() const
+{
+    return m_title;
+}
+
 std::string& Note::getText()
 {
+    detachText();
     return m_text;
 }
 
+std::string Note::getText() const
+{
+    return m_textBlock ? m_textBlock->text(m_textIndex) : m_text;
+}
+
+void Note::detachText()
+{
+    if (m_textBlock)
+    {
+        m_text = m_textBlock->text(m_textIndex);
+        m_textBlock.reset();
+    }
+}
+
+std::uint64_t Note::getContentHash() const
+{
+    return m_hash;
+}
+
 bool Note::operator==(const Note& other)
 {
-    return (m_title == other.m_title) && (m_text == other.m_text) && (m_tags == other.m_tags);
+    // The content hashes differ for almost all the different notes, and are only set for stored notes
+    if ((m_hash != 0) && (other.m_hash != 0) && (m_hash != other.m_hash))
+    {
+        return false;
+    }
+
+    return (m_title == other.m_title) && sameText(*this, other) && (m_tags == other.m_tags);
 }
 
-void Storyboard::addNote(const Note& newNote)
+bool Storyboard::addNote(const Note& newNote)
 {
     m_notes.push_back(newNote);
+
+    if (!admitNote(m_rejectDuplicates))
+    {
+        return false;
+    }
+
+    storeTexts();
+    updateBlockFilter(m_notes, m_notes.size(), m_blockFilter);
+    m_generation++;
+    return true;
 }
 
-void Storyboard::addNote(Note&& newNote)
+bool Storyboard::addNote(Note&& newNote)
 {
     m_notes.push_back(std::move(newNote));
+
+    if (!admitNote(m_rejectDuplicates))
+    {
+        return false;
+    }
+
+    storeTexts();
+    updateBlockFilter(m_notes, m_notes.size(), m_blockFilter);
+    m_generation++;
+    return true;
+}
+
+int Storyboard::addNotes(std::vector<Note>&& newNotes)
+{
+    return addNotes(std::move(newNotes), MergePolicy::KeepAll);
+}
+
+int Storyboard::addNotes(std::vector<Note>&& newNotes, MergePolicy policy)
+{
+    bool reject   = m_rejectDuplicates || (policy == MergePolicy::SkipDuplicates);
+    int  nr_added = 0;
+    m_notes.reserve(m_notes.size() + newNotes.size());
+
+    for (auto& newNote : newNotes)
+    {
+        m_notes.push_back(std::move(newNote));
+        nr_added += admitNote(reject);
+    }
+
+    if (nr_added > 0)
+    {
+        storeTexts();
+        updateBlockFilter(m_notes, m_notes.size(), m_blockFilter);
+        m_generation++;
+    }
+
+    return nr_added;
+}
+
+int Storyboard::merge(const Storyboard& other, MergePolicy policy)
+{
+    if (&other == this)
+    {
+        // The notes would be appended to the vector that is being read
+        Storyboard copy(other);
+        return merge(copy, policy);
+    }
+
+    bool reject   = m_rejectDuplicates || (policy == MergePolicy::SkipDuplicates);
+    int  nr_added = 0;
+    m_notes.reserve(m_notes.size() + other.m_notes.size() - other.m_nrTombstones);
+
+    for (auto& note : other.m_notes)
+    {
+        // The stored notes are already normalized and hashed
+        if (note.m_tombstone || (reject && isStored(note)))
+        {
+            continue;
+        }
+
+        m_notes.push_back(note);
+        placeNote();
+        nr_added++;
+    }
+
+    if (nr_added > 0)
+    {
+        storeTexts();
+        updateBlockFilter(m_notes, m_notes.size(), m_blockFilter);
+        m_generation++;
+    }
+
+    return nr_added;
+}
+
+void Storyboard::setRejectDuplicates(bool reject)
+{
+    m_rejectDuplicates = reject;
+}
+
+auto Storyboard::matchTitle(query::Key title)
+{
+    return query::titleEquals(title);
+}
+
+auto Storyboard::matchText(query::Key text)
+{
+    return query::textContains(text);
+}
+
+auto Storyboard::matchTags(const tag_cont_t& tags, TagMatch match) const
+{
+    // The query tags are looked up once. Tags that are not interned are not carried by any note, so they are left out
+    // of an Any query and make an All query match nothing. The references keep the tags interned during the query.
+    std::vector<TagRef>             refs;
+    std::vector<const std::string*> interned;
+    TagMatcher                      matcher;
+    bool                            unknown = false;
+
+    refs.reserve(tags.size());
+
+    for (auto& tag : tags)
+    {
+        refs.emplace_back(tag);
+
+        if (const std::string* found = refs.back().get())
+        {
+            interned.push_back(found);
+        }
+        else
+        {
+            unknown = true;
+        }
+    }
+
+    if (unknown && (match == TagMatch::All))
+    {
+        return matcher;
+    }
+
+    std::sort(interned.begin(), interned.end());
+    interned.erase(std::unique(interned.begin(), interned.end()), interned.end());
+
+    std::vector<const RoaringBitmap*> postings;
+
+    for (auto tag : interned)
+    {
+        auto it = m_postings.find(tag);
+        postings.push_back(it == m_postings.end() ? nullptr : &it->second);
+    }
+
+    if (match == TagMatch::Any)
+    {
+        for (auto posting : postings)
+        {
+            if (posting)
+            {
+                matcher.matches |= *posting;
+            }
+        }
+    }
+    else if (!postings.empty() && std::none_of(postings.begin(), postings.end(),
+                                               [](const RoaringBitmap* posting) { return posting == nullptr; }))
+    {
+        // Starting from the smallest posting keeps the intermediate results small
+        std::sort(postings.begin(), postings.end(), [](const RoaringBitmap* lhs, const RoaringBitmap* rhs) {
+            return lhs->cardinality() < rhs->cardinality();
+        });
+
+        matcher.matches = *postings.front();
+
+        for (std::size_t index = 1; (index < postings.size()) && !matcher.matches.empty(); index++)
+        {
+            matcher.matches &= *postings[index];
+        }
+    }
+
+    return matcher;
+}
+
+int Storyboard::diff(const Storyboard& other, const note_visitor_t& added, const note_visitor_t& removed) const
+{
+    RoaringBitmap claimed;
+    int           nr_changes = 0;
+
+    for (auto& note : other.m_notes)
+    {
+        if (!note.m_tombstone && !claimEqual(note, claimed))
+        {
+            added(note);
+            nr_changes++;
+        }
+    }
+
+    return nr_changes + visitUnclaimed(claimed, removed);
+}
+
+bool Storyboard::claimEqual(const Note& note, RoaringBitmap& claimed) const
+{
+    NoteEquals predicate{note, note.m_tags, note.m_hash, {}};
+    auto       range = m_contentIndex.equal_range(note.m_hash);
+
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (!claimed.contains(it->second) && predicate(m_notes[positionOf(it->second)]))
+        {
+            claimed.add(it->second);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int Storyboard::visitUnclaimed(const RoaringBitmap& claimed, const note_visitor_t& visitor) const
+{
+    int nr_visited = 0;
+
+    for (auto& note : m_notes)
+    {
+        if (!note.m_tombstone && !claimed.contains(note.m_id))
+        {
+            visitor(note);
+            nr_visited++;
+        }
+    }
+
+    return nr_visited;
+}
+
+template <typename Predicate>
+void Storyboard::findByHash(std::uint64_t hash, const Predicate& predicate, RoaringBitmap& ids) const
+{
+    auto range = m_contentIndex.equal_range(hash);
+
+    // Different contents can have the same hash, so the notes are compared as well
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (predicate(m_notes[positionOf(it->second)]))
+        {
+            ids.add(it->second);
+        }
+    }
+}
+
+template <typename Predicate, typename Fn>
+void Storyboard::forEachMatch(Predicate& predicate, Fn&& fn)
+{
+    if (const RoaringBitmap* matches = exactMatches(predicate))
+    {
+        // Only the matching notes are examined. Ids increase with the position of the notes, so each one is found by
+        // galloping forward from the previous one.
+        t_notes_scanned += matches->cardinality();
+        std::size_t index = 0;
+
+        matches->forEach([this, &fn, &index](std::uint32_t id) {
+            auto        by_id = [](const Note& note, std::uint32_t value) { return note.m_id < value; };
+            std::size_t step  = 1;
+            std::size_t bound = index;
+
+            while ((bound < m_notes.size()) && (m_notes[bound].m_id < id))
+            {
+                index = bound + 1;
+                bound += step;
+                step *= 2;
+            }
+
+            bound = std::min(bound, m_notes.size());
+            index = std::lower_bound(m_notes.begin() + index, m_notes.begin() + bound, id, by_id) - m_notes.begin();
+            fn(m_notes[index], index);
+        });
+        return;
+    }
+
+    scanNotes(filterKeys(predicate), [&predicate, &fn](Note& note, std::size_t index) {
+        if (predicate(note))
+        {
+            fn(note, index);
+        }
+    });
+}
+
+template <typename Fn>
+void Storyboard::scanNotes(const BlockFilter::key_cont_t& keys, Fn&& fn)
+{
+    std::size_t block_size = m_blockFilter.blockSize();
+    std::size_t nr_scanned = 0;
+
+    // The notes after the last full block have no filter and are always scanned
+    std::size_t nr_filtered = keys.empty() ? 0 : m_blockFilter.nrBlocks() * block_size;
+
+    for (std::size_t begin = 0; begin < m_notes.size();)
+    {
+        std::size_t end = begin < nr_filtered ? begin + block_size : m_notes.size();
+
+        if ((begin >= nr_filtered) || m_blockFilter.mayContainAny(begin / block_size, keys))
+        {
+            for (std::size_t index = begin; index < end; index++)
+            {
+                if (!m_notes[index].m_tombstone)
+                {
+                    fn(m_notes[index], index);
+                }
+            }
+
+            nr_scanned += end - begin;
+        }
+
+        begin = end;
+    }
+
+    t_notes_scanned += nr_scanned;
+}
+
+void Storyboard::updateBlockFilter(const note_cont_t& notes, std::size_t first_moved, BlockFilter& filter)
+{
+    std::size_t block_size = filter.blockSize();
+
+    if (block_size == 0)
+    {
+        return;
+    }
+
+    filter.truncate(first_moved / block_size);
+    BlockFilter::key_cont_t keys;
+
+    for (std::size_t begin = filter.nrBlocks() * block_size; begin + block_size <= notes.size(); begin += block_size)
+    {
+        keys.clear();
+
+        // Tombstones never match, so they are left out of the filter
+        for (std::size_t index = begin; index < begin + block_size; index++)
+        {
+            const Note& note = notes[index];
+
+            if (!note.m_tombstone)
+            {
+                keys.push_back(BlockFilter::titleKey(note.m_title.data(), note.m_title.size()));
+            }
+        }
+
+        // The filter is sized for the distinct keys
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        filter.addBlock(keys);
+    }
+}
+
+template <typename Predicate>
+int Storyboard::runDelete(Predicate&& predicate)
+{
+    if (m_deleteMode == DeleteMode::Tombstone)
+    {
+        return runTombstone(predicate);
+    }
+
+    std::vector<std::size_t> deleted;
+    forEachMatch(predicate, [&deleted](Note&, std::size_t index) { deleted.push_back(index); });
+
+    if (deleted.empty())
+    {
+        return 0;
+    }
+
+    // The remaining notes are moved over the deleted ones in a single pass, starting at the first deleted note
+    std::size_t next  = 0;
+    std::size_t write = deleted.front();
+
+    for (std::size_t read = deleted.front(); read < m_notes.size(); read++)
+    {
+        if ((next < deleted.size()) && (deleted[next] == read))
+        {
+            unindexNote(m_notes[read]);
+            removeMemoryUsage(m_notes[read]);
+            next++;
+        }
+        else
+        {
+            m_notes[write++] = std::move(m_notes[read]);
+        }
+    }
+
+    m_notes.erase(m_notes.begin() + write, m_notes.end());
+    updateBlockFilter(m_notes, deleted.front(), m_blockFilter);
+    m_generation++;
+
+    return deleted.size();
+}
+
+template <typename Predicate>
+int Storyboard::runTombstone(Predicate&& predicate)
+{
+    int nr_deleted = 0;
+
+    forEachMatch(predicate, [this, &nr_deleted](Note& note, std::size_t) {
+        // The note stays in place, so the indexes of the other notes and the block filters remain valid
+        note.m_tombstone = true;
+        unindexNote(note);
+        removeMemoryUsage(note);
+        m_tombstoneBytes += noteBytes(note);
+        nr_deleted++;
+    });
+
+    if (nr_deleted > 0)
+    {
+        m_nrTombstones += nr_deleted;
+        m_generation++;
+    }
+
+    return nr_deleted;
 }
 
 int Storyboard::deleteNote(const Note& deleteMe)
 {
-    int nr_elem = m_notes.size();
-    m_notes.erase(std::remove(m_notes.begin(), m_notes.end(), deleteMe), m_notes.end());
-    return nr_elem - m_notes.size();
+    NoteEquals predicate{deleteMe, deleteMe.getTags(), 0, {}};
+    predicate.tags.normalize();
+    predicate.hash = deleteMe.withText([&deleteMe, &predicate](const std::string& text) {
+        return contentHash(deleteMe.getTitle(), text, predicate.tags);
+    });
+    findByHash(predicate.hash, predicate, predicate.matches);
+
+    return runDelete(predicate);
 }
 
-int Storyboard::searchByTitle(const std::string& title, note_cont_t& container)
+int Storyboard::deleteByTitle(query::Key title)
 {
-    int len = container.size();
-    std::copy_if(m_notes.begin(), m_notes.end(), std::back_inserter(container),
-                 [&title](const Note& cmp) { return cmp.m_title == title; });
+    return runDelete(matchTitle(title));
+}
 
-    return container.size() - len;
+int Storyboard::deleteByText(query::Key text)
+{
+    return runDelete(matchText(text));
 }
 
-int Storyboard::searchByText(const std::string& text, note_cont_t& container)
+int Storyboard::deleteByTag(const tag_cont_t& tags)
 {
-    int len = container.size();
-    std::copy_if(m_notes.begin(), m_notes.end(), std::back_inserter(container),
-                 [&text](const Note& cmp) { return cmp.m_text.find(text) != std::string::npos; });
+    // The tag index tells without scanning when no note carries any of the tags
+    if (std::none_of(tags.begin(), tags.end(), [this](const std::string& tag) {
+            return m_postings.find(TagRef(tag).get()) != m_postings.end();
+        }))
+    {
+        return 0;
+    }
+
+    return runDelete(matchTags(tags, TagMatch::Any));
+}
+
+int Storyboard::compact()
+{
+    int nr_reclaimed = m_nrTombstones;
+
+    if (nr_reclaimed == 0)
+    {
+        return 0;
+    }
+
+    // The notes keep their ids, so the postings are not affected
+    auto        is_tombstone = [](const Note& note) { return note.m_tombstone; };
+    auto        first        = std::find_if(m_notes.begin(), m_notes.end(), is_tombstone);
+    std::size_t first_moved  = first - m_notes.begin();
+
+    m_notes.erase(std::remove_if(first, m_notes.end(), is_tombstone), m_notes.end());
+    m_notes.shrink_to_fit();
+    updateBlockFilter(m_notes, first_moved, m_blockFilter);
+
+    m_nrTombstones   = 0;
+    m_tombstoneBytes = 0;
+    m_generation++;
+
+    return nr_reclaimed;
+}
+
+void Storyboard::prepareCompaction(Compaction& compaction) const
+{
+    compaction.generation   = m_generation;
+    compaction.nr_reclaimed = m_nrTombstones;
+    compaction.notes.clear();
+    compaction.notes.reserve(m_notes.size() - m_nrTombstones);
+    t_notes_scanned += m_notes.size();
+
+    for (auto& note : m_notes)
+    {
+        if (!note.m_tombstone)
+        {
+            compaction.notes.push_back(note);
+        }
+    }
+
+    // Built here rather than on commit, so that the commit stays constant time
+    compaction.filter.configure(m_blockFilter.blockSize(), m_blockFilter.falsePositiveRate());
+    updateBlockFilter(compaction.notes, 0, compaction.filter);
+}
+
+bool Storyboard::commitCompaction(Compaction& compaction)
+{
+    // The notes have been modified since the compaction was prepared
+    if (compaction.generation != m_generation)
+    {
+        return false;
+    }
+
+    // The old notes end up in the compaction object, so that the caller decides where they are released
+    m_notes.swap(compaction.notes);
+    std::swap(m_blockFilter, compaction.filter);
+
+    // The filters have been reconfigured since the compaction was prepared
+    if ((m_blockFilter.blockSize() != compaction.filter.blockSize()) ||
+        (m_blockFilter.falsePositiveRate() != compaction.filter.falsePositiveRate()))
+    {
+        m_blockFilter.configure(compaction.filter.blockSize(), compaction.filter.falsePositiveRate());
+        updateBlockFilter(m_notes, 0, m_blockFilter);
+    }
+
+    m_nrTombstones   = 0;
+    m_tombstoneBytes = 0;
+    m_generation++;
 
-    return container.size() - len;
+    return true;
 }
 
-int Storyboard::searchByTag(const tag_cont_t& tags, note_cont_t& container)
+template <typename MakePredicate, typename Sink>
+int Storyboard::runQuery(QueryKind kind, query::Key key, MakePredicate&& makePredicate, Sink&& sink)
 {
-    int len = container.size();
-    std::copy_if(m_notes.begin(), m_notes.end(), std::back_inserter(container), [&tags](const Note& cmp) {
-        return std::any_of(tags.begin(), tags.end(), [&cmp](const std::string& str) {
-            return std::find(cmp.m_tags.begin(), cmp.m_tags.end(), str) != cmp.m_tags.end();
+    int nr_results = 0;
+
+    if (m_queryCache.capacity() == 0)
+    {
+        auto predicate = makePredicate();
+        forEachMatch(predicate, [&sink, &nr_results](Note& note, std::size_t) {
+            sink(note);
+            nr_results++;
         });
+
+        return nr_results;
+    }
+
+    QueryCache::index_cont_t indexes;
+
+    if (!m_queryCache.find(kind, key, m_generation, indexes))
+    {
+        auto predicate = makePredicate();
+        forEachMatch(predicate, [&indexes](Note&, std::size_t index) { indexes.push_back(index); });
+
+        m_queryCache.insert(kind, key, m_generation, indexes);
+    }
+
+    for (auto index : indexes)
+    {
+        sink(m_notes[index]);
+    }
+
+    return indexes.size();
+}
+
+std::string Storyboard::tagsKey(const tag_cont_t& tags)
+{
+    // The order and the repetitions of the tags do not change the results, so they are left out of the key
+    tag_cont_t sorted(tags);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    // Tags are stored length-prefixed in the key so that different tag lists never produce the same key
+    std::string key;
+    for (auto&& tag : sorted)
+    {
+        key.append(std::to_string(tag.size())).push_back(':');
+        key.append(tag);
+    }
+
+    return key;
+}
+
+template <typename Predicate>
+int Storyboard::runCount(QueryKind kind, query::Key key, Predicate&& predicate)
+{
+    std::size_t count = 0;
+
+    // Counting the known matches does not need the notes
+    if (const RoaringBitmap* matches = exactMatches(predicate))
+    {
+        return matches->cardinality();
+    }
+
+    if (m_queryCache.count(kind, key, m_generation, count))
+    {
+        return count;
+    }
+
+    forEachMatch(predicate, [&count](Note&, std::size_t) { count++; });
+    return count;
+}
+
+template <typename Predicate>
+int Storyboard::runFacets(Predicate&& predicate, tag_stats_cont_t& container)
+{
+    tag_counts_t counts;
+
+    forEachMatch(predicate, [&counts](Note& note, std::size_t) {
+        forEachDistinctTag(note, [&counts](const std::string* tag) { counts[tag]++; });
+    });
+
+    for (auto& count : counts)
+    {
+        container.emplace_back(*count.first, count.second);
+    }
+
+    return counts.size();
+}
+
+template <typename Fn>
+void Storyboard::forEachDistinctTag(const Note& note, Fn&& fn)
+{
+    // The tags of the stored notes are deduplicated when the notes are added
+    for (std::size_t index = 0; index < note.m_tags.size(); index++)
+    {
+        fn(note.m_tags.interned(index));
+    }
+}
+
+void Storyboard::indexNote(const Note& note)
+{
+    m_contentIndex.emplace(note.m_hash, note.m_id);
+
+    forEachDistinctTag(note, [this, &note](const std::string* tag) {
+        RoaringBitmap& posting = m_postings[tag];
+        std::size_t    before  = posting.bytes();
+
+        if (posting.empty())
+        {
+            m_tagBytes += TagTable::bytes(tag);
+        }
+
+        posting.add(note.m_id);
+        m_postingBytes += posting.bytes() - before;
+    });
+}
+
+void Storyboard::unindexNote(const Note& note)
+{
+    auto range = m_contentIndex.equal_range(note.m_hash);
+    auto entry = std::find_if(range.first, range.second,
+                              [&note](const content_index_t::value_type& other) { return other.second == note.m_id; });
+    m_contentIndex.erase(entry);
+
+    forEachDistinctTag(note, [this, &note](const std::string* tag) {
+        auto        it     = m_postings.find(tag);
+        std::size_t before = it->second.bytes();
+        it->second.remove(note.m_id);
+        m_postingBytes -= before - it->second.bytes();
+
+        if (it->second.empty())
+        {
+            m_tagBytes -= TagTable::bytes(tag);
+            m_postings.erase(it);
+        }
     });
+}
+
+bool Storyboard::admitNote(bool reject_duplicates)
+{
+    Note& note = m_notes.back();
+    note.m_tags.normalize();
+    note.m_hash =
+        note.withText([&note](const std::string& text) { return contentHash(note.m_title, text, note.m_tags); });
+
+    if (reject_duplicates && isStored(note))
+    {
+        m_notes.pop_back();
+        return false;
+    }
+
+    placeNote();
+    return true;
+}
+
+void Storyboard::placeNote()
+{
+    Note& note = m_notes.back();
+
+    // Numbering the notes again from zero keeps the ids increasing with the positions
+    if (m_nextId == std::numeric_limits<std::uint32_t>::max())
+    {
+        m_postings.clear();
+        m_contentIndex.clear();
+        m_tagBytes     = 0;
+        m_postingBytes = 0;
+        m_nextId       = 0;
+
+        for (auto& other : m_notes)
+        {
+            if (&other != &note)
+            {
+                other.m_id = m_nextId++;
+
+                if (!other.m_tombstone)
+                {
+                    indexNote(other);
+                }
+            }
+        }
+    }
 
-    return container.size() - len;
+    note.m_id = m_nextId++;
+    indexNote(note);
+    addMemoryUsage(note);
 }
 
-int Storyboard::length()
+bool Storyboard::isStored(const Note& note) const
 {
-    return m_notes.size();
+    NoteEquals predicate{note, note.m_tags, note.m_hash, {}};
+    auto       range = m_contentIndex.equal_range(note.m_hash);
+
+    return std::any_of(range.first, range.second, [this, &predicate](const content_index_t::value_type& entry) {
+        return predicate(m_notes[positionOf(entry.second)]);
+    });
+}
+
+std::uint64_t Storyboard::contentHash(const std::string& title, const std::string& text, const TagList& tags)
+{
+    // Each field is chained into the next one, and its size is part of its hash, so moving bytes from one field to
+    // the next changes the hash
+    std::uint64_t hash = hashBytes(title.data(), title.size());
+    hash               = hashBytes(text.data(), text.size(), hash);
+
+    for (auto& tag : tags)
+    {
+        hash = hashBytes(tag.data(), tag.size(), hash);
+    }
+
+    return hash;
+}
+
+std::size_t Storyboard::positionOf(std::uint32_t id) const
+{
+    // Ids increase with the positions of the notes
+    return std::lower_bound(m_notes.begin(), m_notes.end(), id,
+                            [](const Note& note, std::uint32_t value) { return note.m_id < value; }) -
+           m_notes.begin();
+}
+
+void Storyboard::addMemoryUsage(const Note& note)
+{
+    m_tagArrayBytes += note.m_tags.heapBytes();
+    m_titleBytes += note.m_title.size();
+    m_textBytes += textBytes(note);
+
+    if (!note.m_textBlock)
+    {
+        m_plainTexts++;
+        m_plainTextBytes += note.m_text.size();
+    }
+    else if (note.m_textBlock->spilled())
+    {
+        m_spilledTextBytes += textBytes(note);
+        m_spilledBytes += note.m_textBlock->spilledBytes(note.m_textIndex);
+    }
+}
+
+std::size_t Storyboard::noteBytes(const Note& note)
+{
+    // The tag strings are shared with the other notes, so they are not included
+    return sizeof(Note) + note.m_tags.heapBytes() + note.m_title.size() + textBytes(note);
+}
+
+std::size_t Storyboard::textBytes(const Note& note)
+{
+    return note.m_textBlock ? note.m_textBlock->storedBytes(note.m_textIndex) : note.m_text.size();
+}
+
+void Storyboard::removeMemoryUsage(const Note& note)
+{
+    m_tagArrayBytes -= note.m_tags.heapBytes();
+    m_titleBytes -= note.m_title.size();
+    m_textBytes -= textBytes(note);
+
+    if (!note.m_textBlock)
+    {
+        m_plainTexts--;
+        m_plainTextBytes -= note.m_text.size();
+    }
+    else if (note.m_textBlock->spilled())
+    {
+        m_spilledTextBytes -= textBytes(note);
+        m_spilledBytes -= note.m_textBlock->spilledBytes(note.m_textIndex);
+    }
+}
+
+void Storyboard::storeTexts()
+{
+    compressTexts();
+    spillTexts();
+}
+
+void Storyboard::compressTexts()
+{
+    std::size_t threshold = TRAINING_BYTES;
+
+    if (m_dictionary)
+    {
+        threshold = TextBlock::TARGET_BYTES;
+    }
+
+    if (!m_compressTexts || (m_plainTextBytes < threshold))
+    {
+        return;
+    }
+
+    std::vector<Note*> notes = plainNotes();
+
+    if (!m_dictionary)
+    {
+        std::vector<const std::string*> texts;
+
+        for (auto note : notes)
+        {
+            texts.push_back(&note->m_text);
+        }
+
+        m_dictionary = TextDictionary::train(texts);
+    }
+
+    sealTexts(notes);
+}
+
+std::vector<Note*> Storyboard::plainNotes()
+{
+    // Texts are put into blocks in the order the notes are added, so the other ones are found from the end
+    std::vector<Note*> notes;
+    notes.reserve(m_plainTexts);
+
+    for (auto it = m_notes.rbegin(); notes.size() < m_plainTexts; ++it)
+    {
+        if (!it->m_tombstone && !it->m_textBlock)
+        {
+            notes.push_back(&*it);
+        }
+    }
+
+    std::reverse(notes.begin(), notes.end());
+    return notes;
+}
+
+void Storyboard::sealTexts(const std::vector<Note*>& notes)
+{
+    std::vector<const std::string*> texts;
+    std::size_t                     first = 0;
+    std::size_t                     bytes = 0;
+
+    for (std::size_t last = 0; last < notes.size(); last++)
+    {
+        bytes += notes[last]->m_text.size();
+
+        if (bytes < TextBlock::TARGET_BYTES)
+        {
+            continue;
+        }
+
+        texts.clear();
+        for (std::size_t index = first; index <= last; index++)
+        {
+            texts.push_back(&notes[index]->m_text);
+        }
+
+        std::shared_ptr<const TextBlock> block = TextBlock::compress(texts, m_dictionary);
+
+        for (std::size_t index = first; index <= last; index++)
+        {
+            Note& note = *notes[index];
+            removeMemoryUsage(note);
+
+            note.m_textBlock = block;
+            note.m_textIndex = static_cast<std::uint32_t>(index - first);
+            std::string().swap(note.m_text);
+
+            addMemoryUsage(note);
+        }
+
+        first = last + 1;
+        bytes = 0;
+    }
+}
+
+void Storyboard::spillTexts()
+{
+    // Less than a block of texts in memory is not worth a pass over the notes
+    if (!m_segment || (budgetedBytes() <= m_memoryBudget) ||
+        (m_textBytes - m_spilledTextBytes < TextBlock::TARGET_BYTES))
+    {
+        return;
+    }
+
+    sealTexts(plainNotes());
+
+    struct Candidate
+    {
+        const TextBlock* block;
+        std::uint64_t    last_read;
+        std::size_t      position;  /// Position of the first note of the block
+        std::size_t      bytes;     /// Memory attributed to the notes of the block
+    };
+
+    std::unordered_map<const TextBlock*, std::size_t> candidate_of;
+    std::vector<Candidate>                            candidates;
+
+    for (std::size_t position = 0; position < m_notes.size(); position++)
+    {
+        const Note& note = m_notes[position];
+
+        if (note.m_tombstone || !note.m_textBlock || note.m_textBlock->spilled())
+        {
+            continue;
+        }
+
+        auto inserted = candidate_of.emplace(note.m_textBlock.get(), candidates.size());
+
+        if (inserted.second)
+        {
+            candidates.push_back(Candidate{note.m_textBlock.get(), note.m_textBlock->lastRead(), position, 0});
+        }
+
+        candidates[inserted.first->second].bytes += textBytes(note);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& lhs, const Candidate& rhs) {
+        return std::tie(lhs.last_read, lhs.position) < std::tie(rhs.last_read, rhs.position);
+    });
+
+    // Going below the budget leaves room for the next adds, so that not every add spills
+    const std::size_t target   = m_memoryBudget / 8 * 7;
+    std::size_t       budgeted = budgetedBytes();
+
+    std::unordered_map<const TextBlock*, std::shared_ptr<const TextBlock>> spilled;
+
+    for (auto& candidate : candidates)
+    {
+        if (budgeted <= target)
+        {
+            break;
+        }
+
+        spilled.emplace(candidate.block, candidate.block->spill(m_segment));
+        budgeted -= candidate.bytes;
+    }
+
+    replaceBlocks(spilled);
+}
+
+void Storyboard::replaceBlocks(const std::unordered_map<const TextBlock*, std::shared_ptr<const TextBlock>>& blocks)
+{
+    if (blocks.empty())
+    {
+        return;
+    }
+
+    // Tombstones keep their blocks, their memory was set aside when they were marked
+    for (auto& note : m_notes)
+    {
+        if (note.m_tombstone || !note.m_textBlock)
+        {
+            continue;
+        }
+
+        auto it = blocks.find(note.m_textBlock.get());
+
+        if (it != blocks.end())
+        {
+            removeMemoryUsage(note);
+            note.m_textBlock = it->second;
+            addMemoryUsage(note);
+        }
+    }
+
+    m_generation++;
+}
+
+std::size_t Storyboard::budgetedBytes() const
+{
+    return (m_notes.size() - m_nrTombstones) * sizeof(Note) + m_tagArrayBytes + m_titleBytes + m_textBytes;
+}
+
+int Storyboard::searchByTitle(query::Key title, note_cont_t& container)
+{
+    return runQuery(QueryKind::Title, title, [title] { return matchTitle(title); },
+                    [&container](const Note& note) { copyNote(note, container); });
+}
+
+int Storyboard::searchByText(query::Key text, note_cont_t& container)
+{
+    return runQuery(QueryKind::Text, text, [text] { return matchText(text); },
+                    [&container](const Note& note) { copyNote(note, container); });
+}
+
+int Storyboard::searchByTag(const tag_cont_t& tags, note_cont_t& container, TagMatch match)
+{
+    std::string key = tagsKey(tags);
+    return runQuery(match == TagMatch::All ? QueryKind::AllTags : QueryKind::Tag, key,
+                    [this, &tags, match] { return matchTags(tags, match); },
+                    [&container](const Note& note) { copyNote(note, container); });
+}
+
+int Storyboard::searchByTitle(query::Key title, const note_visitor_t& visitor)
+{
+    return runQuery(QueryKind::Title, title, [title] { return matchTitle(title); }, visitor);
+}
+
+int Storyboard::searchByText(query::Key text, const note_visitor_t& visitor)
+{
+    return runQuery(QueryKind::Text, text, [text] { return matchText(text); }, visitor);
+}
+
+int Storyboard::searchByTag(const tag_cont_t& tags, const note_visitor_t& visitor, TagMatch match)
+{
+    std::string key = tagsKey(tags);
+    return runQuery(match == TagMatch::All ? QueryKind::AllTags : QueryKind::Tag, key,
+                    [this, &tags, match] { return matchTags(tags, match); }, visitor);
+}
+
+int Storyboard::countByTitle(query::Key title)
+{
+    return runCount(QueryKind::Title, title, matchTitle(title));
+}
+
+int Storyboard::countByText(query::Key text)
+{
+    return runCount(QueryKind::Text, text, matchText(text));
+}
+
+int Storyboard::countByTag(const tag_cont_t& tags, TagMatch match)
+{
+    // The number of notes carrying a single tag is the cardinality of its posting
+    if (tags.size() == 1)
+    {
+        TagRef tag(tags.front());
+        auto   it = m_postings.find(tag.get());
+        return it == m_postings.end() ? 0 : it->second.cardinality();
+    }
+
+    std::string key = tagsKey(tags);
+    return runCount(match == TagMatch::All ? QueryKind::AllTags : QueryKind::Tag, key, matchTags(tags, match));
+}
+
+int Storyboard::getTagStats(tag_stats_cont_t& container)
+{
+    for (auto& posting : m_postings)
+    {
+        container.emplace_back(*posting.first, posting.second.cardinality());
+    }
+
+    return m_postings.size();
+}
+
+int Storyboard::facetsByTitle(query::Key title, tag_stats_cont_t& container)
+{
+    return runFacets(matchTitle(title), container);
+}
+
+int Storyboard::facetsByText(query::Key text, tag_stats_cont_t& container)
+{
+    return runFacets(matchText(text), container);
+}
+
+int Storyboard::facetsByTag(const tag_cont_t& tags, tag_stats_cont_t& container)
+{
+    return runFacets(matchTags(tags, TagMatch::Any), container);
+}
+
+int Storyboard::length() const
+{
+    return m_notes.size() - m_nrTombstones;
+}
+
+int Storyboard::nrTombstones() const
+{
+    return m_nrTombstones;
+}
+
+void Storyboard::setDeleteMode(DeleteMode mode)
+{
+    m_deleteMode = mode;
+}
+
+DeleteMode Storyboard::deleteMode() const
+{
+    return m_deleteMode;
+}
+
+std::uint64_t Storyboard::notesScanned()
+{
+    return t_notes_scanned;
+}
+
+void Storyboard::addNotesScanned(std::uint64_t nr_notes)
+{
+    t_notes_scanned += nr_notes;
+}
+
+std::uint64_t Storyboard::generation() const
+{
+    return m_generation;
+}
+
+void Storyboard::setQueryCacheCapacity(std::size_t capacity)
+{
+    m_queryCache.setCapacity(capacity);
+}
+
+void Storyboard::setTextCompression(bool enable)
+{
+    m_compressTexts = enable;
+
+    if (enable)
+    {
+        compressTexts();
+    }
+    else
+    {
+        // Spilled texts stay on disk, with the dictionary they were compressed with
+        for (auto& note : m_notes)
+        {
+            if (!note.m_tombstone && note.m_textBlock && !note.m_textBlock->spilled())
+            {
+                removeMemoryUsage(note);
+                note.detachText();
+                addMemoryUsage(note);
+            }
+        }
+
+        m_dictionary.reset();
+        spillTexts();
+    }
+
+    m_generation++;
+}
+
+bool Storyboard::textCompression() const
+{
+    return m_compressTexts;
+}
+
+void Storyboard::setMemoryBudget(std::size_t bytes, const std::string& directory)
+{
+    if (bytes == 0)
+    {
+        std::unordered_map<const TextBlock*, std::shared_ptr<const TextBlock>> loaded;
+
+        for (auto& note : m_notes)
+        {
+            if (!note.m_tombstone && note.m_textBlock && note.m_textBlock->spilled() &&
+                (loaded.find(note.m_textBlock.get()) == loaded.end()))
+            {
+                loaded.emplace(note.m_textBlock.get(), note.m_textBlock->load());
+            }
+        }
+
+        replaceBlocks(loaded);
+        m_segment.reset();
+    }
+    else if (!m_segment || (m_segment->directory() != directory))
+    {
+        // Blocks spilled to the previous file keep it alive
+        m_segment = SegmentFile::create(directory);
+    }
+
+    m_memoryBudget = bytes;
+    spillTexts();
+    m_generation++;
+}
+
+std::size_t Storyboard::memoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+void Storyboard::setBlockFilter(std::size_t block_size, double false_positive_rate)
+{
+    m_blockFilter.configure(block_size, false_positive_rate);
+    updateBlockFilter(m_notes, 0, m_blockFilter);
+}
+
+QueryCacheStats Storyboard::queryCacheStats() const
+{
+    return m_queryCache.stats();
+}
+
+MemoryUsage Storyboard::memoryUsage() const
+{
+    // Nodes of the tag index hold the key, the posting and the link to the next node
+    const std::size_t tag_node_bytes     = sizeof(tag_postings_t::value_type) + sizeof(void*);
+    const std::size_t content_node_bytes = sizeof(content_index_t::value_type) + sizeof(void*);
+
+    MemoryUsage result;
+    result.notes     = (m_notes.size() - m_nrTombstones) * sizeof(Note) + m_tagArrayBytes;
+    result.titles    = m_titleBytes;
+    result.texts     = m_textBytes;
+    result.tags      = m_tagBytes;
+    result.slack     = (m_notes.capacity() - m_notes.size()) * sizeof(Note);
+    result.tag_index = m_postings.bucket_count() * sizeof(void*) + m_postings.size() * tag_node_bytes + m_postingBytes;
+    result.content_index =
+        m_contentIndex.bucket_count() * sizeof(void*) + m_contentIndex.size() * content_node_bytes;
+    result.query_cache = m_queryCache.stats().bytes;
+    result.tombstones  = m_tombstoneBytes;
+    result.filters     = m_blockFilter.bytes();
+    result.dictionary  = m_dictionary ? m_dictionary->bytes() : 0;
+    result.total       = result.notes + result.titles + result.texts + result.tags + result.slack + result.tag_index +
+                   result.content_index + result.query_cache + result.tombstones + result.filters + result.dictionary;
+    result.spilled = m_spilledBytes;
+
+    return result;
 }
 
 }  // End of namespace storyboard
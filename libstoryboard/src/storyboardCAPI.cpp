@@ -1,9 +1,21 @@
 #include "storyboard/storyboardCAPI.h"
+#include "storyboard/shardedStoryboard.hpp"
 #include "storyboard/storyboard.hpp"
+#include "storyboard/threadPool.hpp"
+#include "apiScope.hpp"
+#include "asyncSearch.hpp"
+#include "backgroundCompactor.hpp"
+#include "ingestQueue.hpp"
 
 #include <memory>
 #include <algorithm>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <vector>
 
 //------------------
 // --- C linkage ---
@@ -12,7 +24,8 @@ extern "C" {
 
 struct error
 {
-    std::string message;
+    storyboard_status code;
+    std::string       message;
 };
 
 const char* error_message(error_t_ error)
@@ -33,11 +46,67 @@ const char* error_get_string(error_t_ error)
     return error->message.c_str();
 }
 
+storyboard_status error_get_code(error_t_ error)
+{
+    return error->code;
+}
+
 }  // End of extern "C"
 
 //--------------------
 // --- C++ linkage ---
 //--------------------
+namespace {
+
+const std::size_t DEFAULT_ERROR_BUFFER_SIZE = 256;
+
+// Thread-local error record, written without allocating
+thread_local storyboard_status t_last_error_code                                 = STORYBOARD_OK;
+thread_local char              t_default_error_buffer[DEFAULT_ERROR_BUFFER_SIZE] = "";
+thread_local char*             t_error_buffer                                    = t_default_error_buffer;
+thread_local std::size_t       t_error_buffer_size                               = DEFAULT_ERROR_BUFFER_SIZE;
+thread_local std::uint64_t     t_errors_reported                                 = 0;
+
+}  // namespace
+
+std::uint64_t errorsReported()
+{
+    return t_errors_reported;
+}
+
+/**
+ * @brief Reports an error. The error is always recorded in the thread-local error record, and an error object is
+ * allocated only if out_error is not NULL.
+ * @param[in, out] out_error : error object, can be NULL
+ * @param[in] code : error code
+ * @param[in] message : error message
+ */
+void reportError(error_t_* out_error, storyboard_status code, const char* message) noexcept
+{
+    t_last_error_code = code;
+    t_errors_reported++;
+
+    if (t_error_buffer_size > 0)
+    {
+        std::size_t length = std::min(std::strlen(message), t_error_buffer_size - 1);
+        std::memcpy(t_error_buffer, message, length);
+        t_error_buffer[length] = '\0';
+    }
+
+    if (out_error)
+    {
+        try
+        {
+            *out_error = new error{code, message};
+        }
+        catch (...)
+        {
+            // The thread-local error record still holds the error
+            *out_error = nullptr;
+        }
+    }
+}
+
 template <typename Fn>
 bool translateExceptions(error_t_* out_error, Fn&& fn)
 {
@@ -45,64 +114,276 @@ bool translateExceptions(error_t_* out_error, Fn&& fn)
     {
         fn();
     }
+    catch (const std::bad_alloc& e)
+    {
+        reportError(out_error, STORYBOARD_ERROR_OUT_OF_MEMORY, e.what());
+        return false;
+    }
+    catch (const std::invalid_argument& e)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, e.what());
+        return false;
+    }
     catch (const std::exception& e)
     {
-        *out_error = new error{e.what()};
+        reportError(out_error, STORYBOARD_ERROR_INTERNAL, e.what());
         return false;
     }
     catch (...)
     {
-        *out_error = new error{"Unknown internal error"};
+        reportError(out_error, STORYBOARD_ERROR_INTERNAL, "Unknown internal error");
         return false;
     }
     return true;
 }
 
+/**
+ * @brief Runs a call without an error object, so that a failure does not allocate, and returns its status
+ * @details The thread-local error record is not reset on success, so the failures are told apart by their count.
+ * @param[in] fn : the call, which must pass a NULL out_error
+ */
+template <typename Fn>
+storyboard_status callStatus(Fn&& fn)
+{
+    std::uint64_t errors = t_errors_reported;
+    fn();
+    return (t_errors_reported != errors) ? t_last_error_code : STORYBOARD_OK;
+}
+
 struct note
 {
     template <typename... Args>
     note(Args&&... args) : actual(std::forward<Args>(args)...)
     {
+        // A copy of a note whose text a board stores compressed gets its own text, so that the text pointer is stable
+        actual.detachText();
+
+        // Notes are immutable through the C API, so the tag arrays are built once
+        for (auto& tag : actual.getTags())
+        {
+            tag_data.push_back(tag.c_str());
+            tag_lengths.push_back(tag.size());
+        }
     }
 
-    storyboard::Note actual;
+    note(const note&)            = delete;
+    note& operator=(const note&) = delete;
+
+    storyboard::Note         actual;
+    std::vector<const char*> tag_data;     /// Pointers to the tags of actual
+    std::vector<int32_t>     tag_lengths;  /// Lengths of the tags of actual
 };
 
+/**
+ * @brief Creates a visitor that calls a storyboard_query_handler for each note visited
+ * @details The notes are passed to the handler straight from the board storage. We need to return the tags, that are
+ * stored in a TagList of pointers to the interned tags, in const char**. The pointers are gathered into the tags
+ * buffer, which is reused between the notes.
+ */
+inline storyboard::note_visitor_t makeNoteVisitor(storyboard_query_handler handler, void* client_data,
+                                                  std::vector<const char*>& tags)
+{
+    return [handler, client_data, &tags](const storyboard::Note& elem) {
+        tags.clear();
+
+        for (auto& tag : elem.getTags())
+        {
+            tags.push_back(tag.c_str());
+        }
+
+        elem.withText([&](const std::string& text) {
+            handler(client_data, elem.getTitle().c_str(), text.c_str(), tags.data(), elem.getTags().size());
+        });
+    };
+}
+
+/**
+ * @brief Creates a visitor that calls a storyboard_query_handler_n for each note visited
+ * @details Same as above, with the lengths of the tags gathered into the tag_lengths buffer.
+ */
+inline storyboard::note_visitor_t makeNoteVisitor(storyboard_query_handler_n handler, void* client_data,
+                                                  std::vector<const char*>& tags, std::vector<int32_t>& tag_lengths)
+{
+    return [handler, client_data, &tags, &tag_lengths](const storyboard::Note& elem) {
+        tags.clear();
+        tag_lengths.clear();
+
+        for (auto& tag : elem.getTags())
+        {
+            tags.push_back(tag.c_str());
+            tag_lengths.push_back(tag.size());
+        }
+
+        const std::string& title = elem.getTitle();
+
+        elem.withText([&](const std::string& text) {
+            handler(client_data, title.c_str(), title.size(), text.c_str(), text.size(), tags.data(),
+                    tag_lengths.data(), tags.size());
+        });
+    };
+}
+
 struct board
 {
     template <typename... Args>
-    board(Args&&... args) : actual(std::forward<Args>(args)...)
+    board(Args&&... args)
+        : actual(std::forward<Args>(args)...),
+          compactor([this] { actual.compact(); }),
+          ingest([this](std::vector<storyboard::Note>&& notes) { actual.addNotes(std::move(notes)); })
     {
     }
 
-    storyboard::Storyboard actual;
+    storyboard::ShardedStoryboard actual;     /// Locks its shards internally, so the board can be shared by threads
+    BoardStats                    stats;      /// Operation statistics of the C API calls on this board
+    BackgroundCompactor           compactor;  /// Stopped before the members above go away
+    IngestQueue                   ingest;     /// Applies the queued notes before the members above go away
+    SearchTracker                 searches;   /// Declared last, so the board waits for its asynchronous searches
 };
 
+struct search
+{
+    std::shared_ptr<AsyncSearch> state;  /// Shared with the worker that runs the search
+};
+
+/**
+ * @brief Returns the statistics of a board, or nullptr if the board is not initialized
+ */
+inline BoardStats* statsOf(const board_t board_in)
+{
+    return board_in ? &board_in->stats : nullptr;
+}
+
+/**
+ * @brief Runs a delete on a board, and wakes up the background compactor if needed
+ * @param[in] board_in : board that is modified
+ * @param[in, out] out_error : error object
+ * @param[in] fn : deletes notes from the Storyboard and returns the number of notes deleted
+ * @return number of notes deleted
+ */
+template <typename Fn>
+int32_t deleteNotes(board_t board_in, error_t_* out_error, Fn&& fn)
+{
+    int32_t nr_deleted = 0;
+    bool    compact    = false;
+
+    translateExceptions(out_error, [&] {
+        nr_deleted = fn(board_in->actual);
+
+        int nr_tombstones = board_in->actual.nrTombstones();
+        compact           = board_in->compactor.shouldCompact(board_in->actual.length() + nr_tombstones, nr_tombstones);
+    });
+
+    if (compact)
+    {
+        board_in->compactor.request();
+    }
+
+    return nr_deleted;
+}
+
+/**
+ * @brief Refers to a length-delimited string argument without copying it. NULL refers to the empty string.
+ */
+storyboard::query::Key keyOf(const char* data, std::size_t size)
+{
+    return storyboard::query::Key(data ? data : "", size);
+}
+
+/**
+ * @brief Checks the tags passed by the caller, without allocating, so that bad input is reported before anything is
+ * copied
+ * @param[in] tags : tags, which the caller checked to be there if nr_tags > 0
+ * @param[in] tag_lengths : lengths of the tags, NULL if the tags are NUL-terminated
+ * @param[in] nr_tags : number of tags
+ * @return message of the error, nullptr if the tags are valid
+ */
+const char* checkTags(const char* const* tags, const int32_t* tag_lengths, int32_t nr_tags)
+{
+    for (int32_t index = 0; index < nr_tags; index++)
+    {
+        if (tag_lengths && (tag_lengths[index] < 0))
+        {
+            return "tag length must not be negative";
+        }
+
+        if (!tags[index] && (!tag_lengths || (tag_lengths[index] > 0)))
+        {
+            return "tag not initialized";
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Copies the tags of a multi-tag query, which were checked by checkTags()
+ * @param[in] tags : tags of the query
+ * @param[in] tag_lengths : lengths of the tags, NULL if the tags are NUL-terminated
+ * @param[in] nr_tags : number of tags
+ */
+storyboard::tag_cont_t tagQuery(const char* const* tags, const int32_t* tag_lengths, int32_t nr_tags)
+{
+    storyboard::tag_cont_t query;
+    query.reserve(nr_tags);
+
+    for (int32_t index = 0; index < nr_tags; index++)
+    {
+        if (!tag_lengths)
+        {
+            query.push_back(std::string(tags[index]));
+            continue;
+        }
+
+        query.push_back(tags[index] ? std::string(tags[index], tag_lengths[index]) : std::string());
+    }
+
+    return query;
+}
+
+/**
+ * @brief Converts a raw value that the caller already checked to be one of storyboard_merge_policy
+ */
+storyboard::MergePolicy mergePolicy(int32_t policy)
+{
+    return (policy == STORYBOARD_MERGE_SKIP_DUPLICATES) ? storyboard::MergePolicy::SkipDuplicates
+                                                        : storyboard::MergePolicy::KeepAll;
+}
+
+/**
+ * @brief Converts a raw value that the caller already checked to be one of storyboard_tag_match
+ */
+storyboard::TagMatch tagMatch(int32_t match)
+{
+    return (match == STORYBOARD_TAG_MATCH_ALL) ? storyboard::TagMatch::All : storyboard::TagMatch::Any;
+}
+
 //------------------
 // --- C linkage ---
 //------------------
 extern "C" {
 note_t note_construct(const char* title, const char* text, const char* tags[], int32_t nr_tags, error_t_* out_error)
 {
+    ApiScope scope(ApiOp::NoteConstruct);
+
     note_t new_note = nullptr;
 
     storyboard::tag_cont_t tag_container;
 
     if (!title)
     {
-        *out_error = new error{"title not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title not initialized");
         return nullptr;
     }
 
     if (!text)
     {
-        *out_error = new error{"text not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text not initialized");
         return nullptr;
     }
 
     if ((!tags) && (nr_tags > 0))
     {
-        *out_error = new error{"tags[] not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tags[] not initialized");
         return nullptr;
     }
 
@@ -121,8 +402,74 @@ note_t note_construct(const char* title, const char* text, const char* tags[], i
     return new_note;
 }
 
+note_t note_construct_n(const char* title, int32_t title_length, const char* text, int32_t text_length,
+                        const char* const* tags, const int32_t* tag_lengths, int32_t nr_tags, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::NoteConstructN);
+
+    note_t new_note = nullptr;
+
+    if ((title_length < 0) || (text_length < 0) || (nr_tags < 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "lengths must not be negative");
+        return nullptr;
+    }
+
+    if (!title && (title_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title not initialized");
+        return nullptr;
+    }
+
+    if (!text && (text_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text not initialized");
+        return nullptr;
+    }
+
+    if ((!tags || !tag_lengths) && (nr_tags > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tags[] not initialized");
+        return nullptr;
+    }
+
+    if (const char* message = checkTags(tags, tag_lengths, nr_tags))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, message);
+        return nullptr;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::string title_copy = title ? std::string(title, title_length) : std::string();
+        std::string text_copy  = text ? std::string(text, text_length) : std::string();
+
+        new_note = std::make_unique<note>(std::move(title_copy), std::move(text_copy),
+                                          tagQuery(tags, tag_lengths, nr_tags))
+                       .release();
+    });
+
+    return new_note;
+}
+
+storyboard_status note_construct_n_status(const char* title, int32_t title_length, const char* text,
+                                          int32_t text_length, const char* const* tags, const int32_t* tag_lengths,
+                                          int32_t nr_tags, note_t* out_note)
+{
+    if (!out_note)
+    {
+        reportError(nullptr, STORYBOARD_ERROR_INVALID_ARGUMENT, "out_note not initialized");
+        return STORYBOARD_ERROR_INVALID_ARGUMENT;
+    }
+
+    return callStatus([&] {
+        *out_note = note_construct_n(title, title_length, text, text_length, tags, tag_lengths, nr_tags, nullptr);
+    });
+}
+
 note_t note_destruct(note_t note_in)
 {
+    ApiScope scope(ApiOp::NoteDestruct);
+
     if (note_in)
     {
         delete note_in;
@@ -133,9 +480,11 @@ note_t note_destruct(note_t note_in)
 
 note_t note_copy(const note_t note_in, error_t_* out_error)
 {
+    ApiScope scope(ApiOp::NoteCopy);
+
     if (!note_in)
     {
-        *out_error = new error{"note_in not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
         return nullptr;
     }
 
@@ -144,56 +493,153 @@ note_t note_copy(const note_t note_in, error_t_* out_error)
 
 const char* note_get_title(const note_t note_in, error_t_* out_error)
 {
+    ApiScope scope(ApiOp::NoteGetTitle);
+
     if (!note_in)
     {
-        *out_error = new error{"note_in not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
         return "";
     }
 
     return note_in->actual.getTitle().c_str();
 }
 
+const char* note_get_title_n(const note_t note_in, int32_t* out_length, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::NoteGetTitleN);
+
+    if (!note_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
+        return "";
+    }
+
+    if (!out_length)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "out_length not initialized");
+        return "";
+    }
+
+    const std::string& title = note_in->actual.getTitle();
+
+    *out_length = title.size();
+    return title.c_str();
+}
+
 const char* note_get_text(const note_t note_in, error_t_* out_error)
 {
+    ApiScope scope(ApiOp::NoteGetText);
+
     if (!note_in)
     {
-        *out_error = new error{"note_in not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
         return "";
     }
 
     return note_in->actual.getText().c_str();
 }
 
+const char* note_get_text_n(const note_t note_in, int32_t* out_length, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::NoteGetTextN);
+
+    if (!note_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
+        return "";
+    }
+
+    if (!out_length)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "out_length not initialized");
+        return "";
+    }
+
+    const std::string& text = note_in->actual.getText();
+
+    *out_length = text.size();
+    return text.c_str();
+}
+
 int32_t note_get_tags(const note_t note_in, note_query_handler handler, void* client_data, error_t_* out_error)
 {
+    ApiScope scope(ApiOp::NoteGetTags);
+
     if (!note_in)
     {
-        *out_error = new error{"note_in not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
         return 0;
     }
 
     translateExceptions(out_error, [&] {
-        storyboard::tag_cont_t query_result(note_in->actual.getTags());
-
-        for (auto&& elem : query_result)
+        for (auto tag : note_in->tag_data)
         {
-            handler(client_data, elem.c_str());
+            handler(client_data, tag);
         }
     });
 
-    return note_in->actual.getTags().size();
+    scope.setResults(note_in->tag_data.size());
+    return note_in->tag_data.size();
+}
+
+int32_t note_get_tags_array(const note_t note_in, const char* const** out_tags, const int32_t** out_lengths,
+                            error_t_* out_error)
+{
+    ApiScope scope(ApiOp::NoteGetTagsArray);
+
+    if (!note_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
+        return 0;
+    }
+
+    if (!out_tags)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "out_tags not initialized");
+        return 0;
+    }
+
+    *out_tags = note_in->tag_data.data();
+
+    if (out_lengths)
+    {
+        *out_lengths = note_in->tag_lengths.data();
+    }
+
+    scope.setResults(note_in->tag_data.size());
+    return note_in->tag_data.size();
 }
 
 board_t storyboard_construct(error_t_* out_error)
 {
+    ApiScope scope(ApiOp::Construct);
+
     board_t new_storyboard = nullptr;
     translateExceptions(out_error, [&] { new_storyboard = std::make_unique<board>().release(); });
 
     return new_storyboard;
 }
 
+board_t storyboard_construct_sharded(int32_t nr_shards, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::ConstructSharded);
+
+    if (nr_shards < 1)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "nr_shards must be at least 1");
+        return nullptr;
+    }
+
+    board_t new_storyboard = nullptr;
+    translateExceptions(out_error, [&] { new_storyboard = std::make_unique<board>(nr_shards).release(); });
+
+    return new_storyboard;
+}
+
 board_t storyboard_destruct(board_t board_in)
 {
+    ApiScope scope(ApiOp::Destruct, board_in);
+
     if (board_in)
     {
         delete board_in;
@@ -204,203 +650,1500 @@ board_t storyboard_destruct(board_t board_in)
 
 board_t storyboard_copy(const board_t board_in, error_t_* out_error)
 {
+    ApiScope scope(ApiOp::Copy, board_in, statsOf(board_in));
+
     if (!board_in)
     {
-        *out_error = new error{"board_in not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
         return nullptr;
     }
 
-    return std::make_unique<board>(board_in->actual).release();
+    board_t new_storyboard = nullptr;
+
+    translateExceptions(out_error, [&] { new_storyboard = std::make_unique<board>(board_in->actual).release(); });
+
+    return new_storyboard;
 }
 
 void storyboard_add_note(board_t board_in, const note_t note_in, error_t_* out_error)
 {
+    storyboard_add_note_checked(board_in, note_in, out_error);
+}
+
+int32_t storyboard_add_note_checked(board_t board_in, const note_t note_in, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::AddNote, board_in, statsOf(board_in));
+
+    int32_t nr_added = 0;
+
     if (!board_in)
     {
-        *out_error = new error{"board_in not initialized"};
-        return;
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_added;
     }
 
     if (!note_in)
     {
-        *out_error = new error{"note_in not initialized"};
-        return;
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
+        return nr_added;
     }
 
-    translateExceptions(out_error, [&] { board_in->actual.addNote(note_in->actual); });
+    translateExceptions(out_error, [&] { nr_added = board_in->actual.addNote(note_in->actual); });
+
+    return nr_added;
 }
 
-int32_t storyboard_delete_note(board_t board_in, const note_t note_in, error_t_* out_error)
+storyboard_status storyboard_add_note_status(board_t board_in, const note_t note_in, int32_t* out_added)
 {
-    int32_t nr_deleted_items = 0;
+    int32_t nr_added = 0;
 
-    if (!board_in)
+    storyboard_status status = callStatus([&] { nr_added = storyboard_add_note_checked(board_in, note_in, nullptr); });
+
+    if (out_added)
     {
-        *out_error = new error{"board_in not initialized"};
-        return nr_deleted_items;
+        *out_added = nr_added;
     }
 
-    if (!note_in)
+    return status;
+}
+
+void storyboard_set_reject_duplicates(board_t board_in, int32_t reject, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SetRejectDuplicates, board_in, statsOf(board_in));
+
+    if (!board_in)
     {
-        *out_error = new error{"note_in not initialized"};
-        return nr_deleted_items;
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
     }
 
-    translateExceptions(out_error, [&] { nr_deleted_items = board_in->actual.deleteNote(note_in->actual); });
-
-    return nr_deleted_items;
+    translateExceptions(out_error, [&] { board_in->actual.setRejectDuplicates(reject != 0); });
 }
 
-int32_t storyboard_search_by_title(const board_t board_in, const char* title, storyboard_query_handler handler,
-                                   void* client_data, error_t_* out_error)
+int32_t storyboard_merge(board_t board_in, const board_t source_in, int32_t policy, error_t_* out_error)
 {
-    int nr_results = 0;
+    ApiScope scope(ApiOp::Merge, board_in, statsOf(board_in));
+
+    int nr_added = 0;
 
     if (!board_in)
     {
-        *out_error = new error{"board_in not initialized"};
-        return nr_results;
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_added;
     }
 
-    if (!title)
+    if (!source_in)
     {
-        *out_error = new error{"name not initialized"};
-        return nr_results;
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "source_in not initialized");
+        return nr_added;
     }
 
-    translateExceptions(out_error, [&] {
-        storyboard::note_cont_t query_result;
-        board_in->actual.searchByTitle(std::string(title), query_result);
+    // The raw value may be any integer, so it is not loaded as the enum type
+    if ((policy != STORYBOARD_MERGE_KEEP_ALL) && (policy != STORYBOARD_MERGE_SKIP_DUPLICATES))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "unknown merge policy");
+        return nr_added;
+    }
 
-        nr_results = query_result.size();
+    translateExceptions(out_error,
+                        [&] { nr_added = board_in->actual.merge(source_in->actual, mergePolicy(policy)); });
 
-        for (auto& elem : query_result)
-        {
-            // We need to return the tags, that are stored in std::vector<std::string>, in  const char**.
-            // Therefore we gather the data from the tag-vector
-            const char** tags = new const char*[elem.getTags().size()];
+    scope.setResults(nr_added);
+    return nr_added;
+}
 
-            for (size_t index = 0; index < elem.getTags().size(); index++)
-            {
-                tags[index] = elem.getTags().at(index).c_str();
-            }
+int32_t storyboard_diff(const board_t board_a, const board_t board_b, storyboard_diff_handler handler,
+                        void* client_data, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::Diff, board_a, statsOf(board_a));
 
-            // Call the handler function
-            handler(client_data, elem.getTitle().c_str(), elem.getText().c_str(), tags, elem.getTags().size());
+    int nr_changes = 0;
 
-            // Delete the tags
-            delete[] tags;
-        }
-    });
+    if (!board_a)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_a not initialized");
+        return nr_changes;
+    }
 
-    return nr_results;
-}
+    if (!board_b)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_b not initialized");
+        return nr_changes;
+    }
+
+    if (!handler)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "handler not initialized");
+        return nr_changes;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::vector<const char*> tags;
+        std::vector<int32_t>     tag_lengths;
+
+        auto visitor = [handler, client_data, &tags, &tag_lengths](storyboard_diff_kind kind) {
+            return [handler, client_data, kind, &tags, &tag_lengths](const storyboard::Note& elem) {
+                tags.clear();
+                tag_lengths.clear();
+
+                for (auto& tag : elem.getTags())
+                {
+                    tags.push_back(tag.c_str());
+                    tag_lengths.push_back(tag.size());
+                }
+
+                const std::string& title = elem.getTitle();
+
+                elem.withText([&](const std::string& text) {
+                    handler(client_data, kind, title.c_str(), title.size(), text.c_str(), text.size(), tags.data(),
+                            tag_lengths.data(), tags.size());
+                });
+            };
+        };
+
+        nr_changes =
+            board_a->actual.diff(board_b->actual, visitor(STORYBOARD_DIFF_ADDED), visitor(STORYBOARD_DIFF_REMOVED));
+    });
+
+    scope.setResults(nr_changes);
+    return nr_changes;
+}
+
+void storyboard_enqueue_note(board_t board_in, const note_t note_in, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::EnqueueNote, board_in, statsOf(board_in));
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    if (!note_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
+        return;
+    }
+
+    translateExceptions(out_error, [&] { board_in->ingest.push(note_in->actual); });
+}
+
+storyboard_status storyboard_enqueue_note_status(board_t board_in, const note_t note_in)
+{
+    return callStatus([&] { storyboard_enqueue_note(board_in, note_in, nullptr); });
+}
+
+void storyboard_flush(board_t board_in, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::Flush, board_in, statsOf(board_in));
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    translateExceptions(out_error, [&] { board_in->ingest.flush(); });
+}
+
+int32_t storyboard_delete_note(board_t board_in, const note_t note_in, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::DeleteNote, board_in, statsOf(board_in));
+
+    int32_t nr_deleted_items = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_deleted_items;
+    }
+
+    if (!note_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "note_in not initialized");
+        return nr_deleted_items;
+    }
+
+    nr_deleted_items = deleteNotes(board_in, out_error, [note_in](storyboard::ShardedStoryboard& actual) {
+        return actual.deleteNote(note_in->actual);
+    });
+
+    scope.setResults(nr_deleted_items);
+    return nr_deleted_items;
+}
+
+int32_t storyboard_delete_by_title(board_t board_in, const char* title, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::DeleteByTitle, board_in, statsOf(board_in));
+
+    int32_t nr_deleted_items = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_deleted_items;
+    }
+
+    if (!title)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title not initialized");
+        return nr_deleted_items;
+    }
+
+    nr_deleted_items = deleteNotes(board_in, out_error, [title](storyboard::ShardedStoryboard& actual) {
+        return actual.deleteByTitle(keyOf(title, std::strlen(title)));
+    });
+
+    scope.setResults(nr_deleted_items);
+    return nr_deleted_items;
+}
+
+int32_t storyboard_delete_by_title_n(board_t board_in, const char* title, int32_t title_length, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::DeleteByTitleN, board_in, statsOf(board_in));
+
+    int32_t nr_deleted_items = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_deleted_items;
+    }
+
+    if (title_length < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title_length must not be negative");
+        return nr_deleted_items;
+    }
+
+    if (!title && (title_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title not initialized");
+        return nr_deleted_items;
+    }
+
+    nr_deleted_items =
+        deleteNotes(board_in, out_error, [title, title_length](storyboard::ShardedStoryboard& actual) {
+            return actual.deleteByTitle(keyOf(title, title_length));
+        });
+
+    scope.setResults(nr_deleted_items);
+    return nr_deleted_items;
+}
+
+int32_t storyboard_delete_by_text(board_t board_in, const char* text, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::DeleteByText, board_in, statsOf(board_in));
+
+    int32_t nr_deleted_items = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_deleted_items;
+    }
+
+    if (!text)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text not initialized");
+        return nr_deleted_items;
+    }
+
+    nr_deleted_items = deleteNotes(board_in, out_error, [text](storyboard::ShardedStoryboard& actual) {
+        return actual.deleteByText(keyOf(text, std::strlen(text)));
+    });
+
+    scope.setResults(nr_deleted_items);
+    return nr_deleted_items;
+}
+
+int32_t storyboard_delete_by_text_n(board_t board_in, const char* text, int32_t text_length, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::DeleteByTextN, board_in, statsOf(board_in));
+
+    int32_t nr_deleted_items = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_deleted_items;
+    }
+
+    if (text_length < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text_length must not be negative");
+        return nr_deleted_items;
+    }
+
+    if (!text && (text_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text not initialized");
+        return nr_deleted_items;
+    }
+
+    nr_deleted_items =
+        deleteNotes(board_in, out_error, [text, text_length](storyboard::ShardedStoryboard& actual) {
+            return actual.deleteByText(keyOf(text, text_length));
+        });
+
+    scope.setResults(nr_deleted_items);
+    return nr_deleted_items;
+}
+
+int32_t storyboard_delete_by_tag(board_t board_in, const char* tag, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::DeleteByTag, board_in, statsOf(board_in));
+
+    int32_t nr_deleted_items = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_deleted_items;
+    }
+
+    if (!tag)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tag not initialized");
+        return nr_deleted_items;
+    }
+
+    nr_deleted_items = deleteNotes(board_in, out_error, [tag](storyboard::ShardedStoryboard& actual) {
+        return actual.deleteByTag(storyboard::tag_cont_t{std::string(tag)});
+    });
+
+    scope.setResults(nr_deleted_items);
+    return nr_deleted_items;
+}
+
+int32_t storyboard_delete_by_tag_n(board_t board_in, const char* tag, int32_t tag_length, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::DeleteByTagN, board_in, statsOf(board_in));
+
+    int32_t nr_deleted_items = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_deleted_items;
+    }
+
+    if (tag_length < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tag_length must not be negative");
+        return nr_deleted_items;
+    }
+
+    if (!tag && (tag_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tag not initialized");
+        return nr_deleted_items;
+    }
+
+    nr_deleted_items = deleteNotes(board_in, out_error, [tag, tag_length](storyboard::ShardedStoryboard& actual) {
+        return actual.deleteByTag(storyboard::tag_cont_t{tag ? std::string(tag, tag_length) : std::string()});
+    });
+
+    scope.setResults(nr_deleted_items);
+    return nr_deleted_items;
+}
+
+int32_t storyboard_search_by_title(const board_t board_in, const char* title, storyboard_query_handler handler,
+                                   void* client_data, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchByTitle, board_in, statsOf(board_in));
+
+    int nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (!title)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "name not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::vector<const char*> tags;
+        nr_results = board_in->actual.searchByTitle(keyOf(title, std::strlen(title)),
+                                                    makeNoteVisitor(handler, client_data, tags));
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_search_by_title_n(const board_t board_in, const char* title, int32_t title_length,
+                                     storyboard_query_handler_n handler, void* client_data, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchByTitleN, board_in, statsOf(board_in));
+
+    int nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (title_length < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title_length must not be negative");
+        return nr_results;
+    }
+
+    if (!title && (title_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::vector<const char*> tags;
+        std::vector<int32_t>     tag_lengths;
+
+        nr_results = board_in->actual.searchByTitle(keyOf(title, title_length),
+                                                    makeNoteVisitor(handler, client_data, tags, tag_lengths));
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
 
 int32_t storyboard_search_by_text(const board_t board_in, const char* text, storyboard_query_handler handler,
                                   void* client_data, error_t_* out_error)
 {
-    int nr_results = 0;
+    ApiScope scope(ApiOp::SearchByText, board_in, statsOf(board_in));
+
+    int nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (!text)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::vector<const char*> tags;
+        nr_results = board_in->actual.searchByText(keyOf(text, std::strlen(text)),
+                                                   makeNoteVisitor(handler, client_data, tags));
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_search_by_text_n(const board_t board_in, const char* text, int32_t text_length,
+                                    storyboard_query_handler_n handler, void* client_data, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchByTextN, board_in, statsOf(board_in));
+
+    int nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (text_length < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text_length must not be negative");
+        return nr_results;
+    }
+
+    if (!text && (text_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::vector<const char*> tags;
+        std::vector<int32_t>     tag_lengths;
+
+        nr_results = board_in->actual.searchByText(keyOf(text, text_length),
+                                                   makeNoteVisitor(handler, client_data, tags, tag_lengths));
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_search_by_tag(const board_t board_in, const char* tag, storyboard_query_handler handler,
+                                 void* client_data, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchByTag, board_in, statsOf(board_in));
+
+    int nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (!tag)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tag not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::vector<const char*> tags;
+        storyboard::tag_cont_t   query;
+        query.push_back(std::string(tag));
+
+        nr_results = board_in->actual.searchByTag(query, makeNoteVisitor(handler, client_data, tags));
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_search_by_tag_n(const board_t board_in, const char* tag, int32_t tag_length,
+                                   storyboard_query_handler_n handler, void* client_data, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchByTagN, board_in, statsOf(board_in));
+
+    int nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (tag_length < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tag_length must not be negative");
+        return nr_results;
+    }
+
+    if (!tag && (tag_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tag not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::vector<const char*> tags;
+        std::vector<int32_t>     tag_lengths;
+        storyboard::tag_cont_t   query{tag ? std::string(tag, tag_length) : std::string()};
+
+        nr_results = board_in->actual.searchByTag(query, makeNoteVisitor(handler, client_data, tags, tag_lengths));
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_search_by_tags(const board_t board_in, const char* const* tags, int32_t nr_tags, int32_t match,
+                                  storyboard_query_handler handler, void* client_data, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchByTags, board_in, statsOf(board_in));
+
+    int nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if ((!tags && (nr_tags > 0)) || (nr_tags < 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tags[] not initialized");
+        return nr_results;
+    }
+
+    if (const char* message = checkTags(tags, nullptr, nr_tags))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, message);
+        return nr_results;
+    }
+
+    // The raw value may be any integer, so it is not loaded as the enum type
+    if ((match != STORYBOARD_TAG_MATCH_ANY) && (match != STORYBOARD_TAG_MATCH_ALL))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "unknown tag match");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::vector<const char*> note_tags;
+        storyboard::tag_cont_t   query = tagQuery(tags, nullptr, nr_tags);
+
+        nr_results = board_in->actual.searchByTag(query, makeNoteVisitor(handler, client_data, note_tags),
+                                                  tagMatch(match));
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_search_by_tags_n(const board_t board_in, const char* const* tags, const int32_t* tag_lengths,
+                                    int32_t nr_tags, int32_t match, storyboard_query_handler_n handler,
+                                    void* client_data, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchByTagsN, board_in, statsOf(board_in));
+
+    int nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (((!tags || !tag_lengths) && (nr_tags > 0)) || (nr_tags < 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tags[] not initialized");
+        return nr_results;
+    }
+
+    if (const char* message = checkTags(tags, tag_lengths, nr_tags))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, message);
+        return nr_results;
+    }
+
+    // The raw value may be any integer, so it is not loaded as the enum type
+    if ((match != STORYBOARD_TAG_MATCH_ANY) && (match != STORYBOARD_TAG_MATCH_ALL))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "unknown tag match");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        std::vector<const char*> note_tags;
+        std::vector<int32_t>     note_tag_lengths;
+        storyboard::tag_cont_t   query = tagQuery(tags, tag_lengths, nr_tags);
+
+        nr_results = board_in->actual.searchByTag(
+            query, makeNoteVisitor(handler, client_data, note_tags, note_tag_lengths), tagMatch(match));
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+search_t storyboard_search_async(const board_t board_in, int32_t kind, const char* key,
+                                 storyboard_search_completion completion, void* user_data, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchAsync, board_in, statsOf(board_in));
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nullptr;
+    }
+
+    if (!key)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "key not initialized");
+        return nullptr;
+    }
+
+    if (!completion)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "completion not initialized");
+        return nullptr;
+    }
+
+    // The raw value may be any integer, so it is not loaded as the enum type
+    if ((kind != STORYBOARD_QUERY_BY_TITLE) && (kind != STORYBOARD_QUERY_BY_TEXT) && (kind != STORYBOARD_QUERY_BY_TAG))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "unknown query kind");
+        return nullptr;
+    }
+
+    search_t new_search = nullptr;
+
+    translateExceptions(out_error, [&] {
+        auto handle   = std::make_unique<search>();
+        handle->state = std::make_shared<AsyncSearch>();
+
+        auto state = handle->state;
+        auto task  = [board_in, kind, query = std::string(key), completion, user_data, state] {
+            // The results are copied, since the shards are unlocked before the completion is called
+            std::deque<note>    results;
+            std::vector<note_t> notes;
+            storyboard_status   status = STORYBOARD_OK;
+
+            try
+            {
+                auto visitor = [&results](const storyboard::Note& match) { results.emplace_back(match); };
+
+                if (!state->cancelled())
+                {
+                    switch (kind)
+                    {
+                        case STORYBOARD_QUERY_BY_TITLE:
+                            board_in->actual.searchByTitle(query, visitor);
+                            break;
+                        case STORYBOARD_QUERY_BY_TEXT:
+                            board_in->actual.searchByText(query, visitor);
+                            break;
+                        case STORYBOARD_QUERY_BY_TAG:
+                            board_in->actual.searchByTag(storyboard::tag_cont_t{query}, visitor);
+                            break;
+                    }
+                }
+
+                for (auto& result : results)
+                {
+                    notes.push_back(&result);
+                }
+            }
+            catch (const std::bad_alloc&)
+            {
+                status = STORYBOARD_ERROR_OUT_OF_MEMORY;
+            }
+            catch (...)
+            {
+                status = STORYBOARD_ERROR_INTERNAL;
+            }
+
+            if (!state->beginCompletion())
+            {
+                status = STORYBOARD_ERROR_CANCELLED;
+            }
+
+            if (status != STORYBOARD_OK)
+            {
+                notes.clear();
+            }
+
+            try
+            {
+                completion(user_data, status, notes.data(), notes.size());
+            }
+            catch (...)
+            {
+                // Exceptions must not escape to the worker thread
+            }
+
+            state->finish();
+            board_in->searches.remove();
+        };
+
+        board_in->searches.add();
+
+        try
+        {
+            storyboard::ThreadPool::shared().submit(task);
+        }
+        catch (...)
+        {
+            board_in->searches.remove();
+            throw;
+        }
+
+        new_search = handle.release();
+    });
+
+    return new_search;
+}
+
+int32_t search_cancel(search_t search_in, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchCancel);
+
+    if (!search_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "search_in not initialized");
+        return 0;
+    }
+
+    return search_in->state->cancel() ? 1 : 0;
+}
+
+void search_wait(search_t search_in, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SearchWait);
+
+    if (!search_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "search_in not initialized");
+        return;
+    }
+
+    search_in->state->wait();
+}
+
+search_t search_destruct(search_t search_in)
+{
+    ApiScope scope(ApiOp::SearchDestruct);
+
+    if (search_in)
+    {
+        delete search_in;
+    }
+
+    return nullptr;
+}
+
+int32_t storyboard_count_by_title(const board_t board_in, const char* title, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::CountByTitle, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (!title)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error,
+                        [&] { nr_results = board_in->actual.countByTitle(keyOf(title, std::strlen(title))); });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_count_by_title_n(const board_t board_in, const char* title, int32_t title_length,
+                                    error_t_* out_error)
+{
+    ApiScope scope(ApiOp::CountByTitleN, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (title_length < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title_length must not be negative");
+        return nr_results;
+    }
+
+    if (!title && (title_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "title not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] { nr_results = board_in->actual.countByTitle(keyOf(title, title_length)); });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_count_by_text(const board_t board_in, const char* text, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::CountByText, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (!text)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] { nr_results = board_in->actual.countByText(keyOf(text, std::strlen(text))); });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_count_by_text_n(const board_t board_in, const char* text, int32_t text_length, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::CountByTextN, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (text_length < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text_length must not be negative");
+        return nr_results;
+    }
+
+    if (!text && (text_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "text not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] { nr_results = board_in->actual.countByText(keyOf(text, text_length)); });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_count_by_tag(const board_t board_in, const char* tag, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::CountByTag, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (!tag)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tag not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        storyboard::tag_cont_t query;
+        query.push_back(std::string(tag));
+
+        nr_results = board_in->actual.countByTag(query);
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_count_by_tag_n(const board_t board_in, const char* tag, int32_t tag_length, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::CountByTagN, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (tag_length < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tag_length must not be negative");
+        return nr_results;
+    }
+
+    if (!tag && (tag_length > 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tag not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        storyboard::tag_cont_t query{tag ? std::string(tag, tag_length) : std::string()};
+
+        nr_results = board_in->actual.countByTag(query);
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_count_by_tags(const board_t board_in, const char* const* tags, int32_t nr_tags, int32_t match,
+                                 error_t_* out_error)
+{
+    ApiScope scope(ApiOp::CountByTags, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if ((!tags && (nr_tags > 0)) || (nr_tags < 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tags[] not initialized");
+        return nr_results;
+    }
+
+    if (const char* message = checkTags(tags, nullptr, nr_tags))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, message);
+        return nr_results;
+    }
+
+    // The raw value may be any integer, so it is not loaded as the enum type
+    if ((match != STORYBOARD_TAG_MATCH_ANY) && (match != STORYBOARD_TAG_MATCH_ALL))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "unknown tag match");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        nr_results = board_in->actual.countByTag(tagQuery(tags, nullptr, nr_tags), tagMatch(match));
+    });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+int32_t storyboard_count_by_tags_n(const board_t board_in, const char* const* tags, const int32_t* tag_lengths,
+                                   int32_t nr_tags, int32_t match, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::CountByTagsN, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
 
     if (!board_in)
     {
-        *out_error = new error{"board_in not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
         return nr_results;
     }
 
-    if (!text)
+    if (((!tags || !tag_lengths) && (nr_tags > 0)) || (nr_tags < 0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "tags[] not initialized");
+        return nr_results;
+    }
+
+    if (const char* message = checkTags(tags, tag_lengths, nr_tags))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, message);
+        return nr_results;
+    }
+
+    // The raw value may be any integer, so it is not loaded as the enum type
+    if ((match != STORYBOARD_TAG_MATCH_ANY) && (match != STORYBOARD_TAG_MATCH_ALL))
     {
-        *out_error = new error{"text not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "unknown tag match");
         return nr_results;
     }
 
     translateExceptions(out_error, [&] {
-        storyboard::note_cont_t query_result;
-        board_in->actual.searchByText(std::string(text), query_result);
+        nr_results = board_in->actual.countByTag(tagQuery(tags, tag_lengths, nr_tags), tagMatch(match));
+    });
 
-        nr_results = query_result.size();
+    scope.setResults(nr_results);
+    return nr_results;
+}
 
-        for (auto& elem : query_result)
-        {
-            // We need to return the tags, that are stored in std::vector<std::string>, in  const char**.
-            // Therefore we gather the data from the tag-vector
-            const char** tags = new const char*[elem.getTags().size()];
+int32_t storyboard_get_nr_notes(const board_t board_in, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::GetNrNotes, board_in, statsOf(board_in));
 
-            for (size_t index = 0; index < elem.getTags().size(); index++)
-            {
-                tags[index] = elem.getTags().at(index).c_str();
-            }
+    int32_t length = -1;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return length;
+    }
+
+    translateExceptions(out_error, [&] { length = board_in->actual.length(); });
 
-            // Call the handler function
-            handler(client_data, elem.getTitle().c_str(), elem.getText().c_str(), tags, elem.getTags().size());
+    return length;
+}
+
+int32_t storyboard_get_tag_stats(const board_t board_in, storyboard_tag_stats_handler handler, void* client_data,
+                                 error_t_* out_error)
+{
+    ApiScope scope(ApiOp::GetTagStats, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (!handler)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "handler not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] {
+        storyboard::tag_stats_cont_t query_result;
+        nr_results = board_in->actual.getTagStats(query_result);
 
-            // Delete the tags
-            delete[] tags;
+        for (auto& elem : query_result)
+        {
+            handler(client_data, elem.first.c_str(), elem.second);
         }
     });
 
+    scope.setResults(nr_results);
     return nr_results;
 }
 
-int32_t storyboard_search_by_tag(const board_t board_in, const char* tag, storyboard_query_handler handler,
-                                 void* client_data, error_t_* out_error)
+int32_t storyboard_get_tag_facets(const board_t board_in, int32_t kind, const char* key,
+                                  storyboard_tag_stats_handler handler, void* client_data, error_t_* out_error)
 {
-    int nr_results = 0;
+    ApiScope scope(ApiOp::GetTagFacets, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
 
     if (!board_in)
     {
-        *out_error = new error{"board_in not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
         return nr_results;
     }
 
-    if (!tag)
+    if (!key)
     {
-        *out_error = new error{"tag not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "key not initialized");
         return nr_results;
     }
 
-    translateExceptions(out_error, [&] {
-        storyboard::note_cont_t query_result;
-        storyboard::tag_cont_t  query;
-        query.push_back(std::string(tag));
+    if (!handler)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "handler not initialized");
+        return nr_results;
+    }
+
+    // The raw value may be any integer, so it is not loaded as the enum type
+    if ((kind != STORYBOARD_QUERY_BY_TITLE) && (kind != STORYBOARD_QUERY_BY_TEXT) && (kind != STORYBOARD_QUERY_BY_TAG))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "unknown query kind");
+        return nr_results;
+    }
 
-        board_in->actual.searchByTag(query, query_result);
+    translateExceptions(out_error, [&] {
+        storyboard::tag_stats_cont_t query_result;
 
-        nr_results = query_result.size();
+        switch (kind)
+        {
+            case STORYBOARD_QUERY_BY_TITLE:
+                nr_results = board_in->actual.facetsByTitle(keyOf(key, std::strlen(key)), query_result);
+                break;
+            case STORYBOARD_QUERY_BY_TEXT:
+                nr_results = board_in->actual.facetsByText(keyOf(key, std::strlen(key)), query_result);
+                break;
+            case STORYBOARD_QUERY_BY_TAG:
+                nr_results = board_in->actual.facetsByTag(storyboard::tag_cont_t{std::string(key)}, query_result);
+                break;
+        }
 
         for (auto& elem : query_result)
         {
-            // We need to return the tags, that are stored in std::vector<std::string>, in  const char**.
-            // Therefore we gather the data from the tag-vector
-            const char** tags = new const char*[elem.getTags().size()];
+            handler(client_data, elem.first.c_str(), elem.second);
+        }
+    });
 
-            for (size_t index = 0; index < elem.getTags().size(); index++)
-            {
-                tags[index] = elem.getTags().at(index).c_str();
-            }
+    scope.setResults(nr_results);
+    return nr_results;
+}
 
-            // Call the handler function
-            handler(client_data, elem.getTitle().c_str(), elem.getText().c_str(), tags, elem.getTags().size());
+void storyboard_set_query_cache_capacity(board_t board_in, int32_t capacity, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SetQueryCacheCapacity, board_in, statsOf(board_in));
 
-            // Delete the tags
-            delete[] tags;
-        }
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    if (capacity < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "capacity must not be negative");
+        return;
+    }
+
+    translateExceptions(out_error, [&] { board_in->actual.setQueryCacheCapacity(capacity); });
+}
+
+void storyboard_get_query_cache_stats(const board_t board_in, storyboard_cache_stats* out_stats, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::GetQueryCacheStats, board_in, statsOf(board_in));
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    if (!out_stats)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "out_stats not initialized");
+        return;
+    }
+
+    translateExceptions(out_error, [&] {
+        storyboard::QueryCacheStats stats = board_in->actual.queryCacheStats();
+
+        out_stats->hits         = stats.hits;
+        out_stats->misses       = stats.misses;
+        out_stats->evictions    = stats.evictions;
+        out_stats->entries      = stats.entries;
+        out_stats->capacity     = stats.capacity;
+        out_stats->memory_bytes = stats.bytes;
+    });
+}
+
+void storyboard_set_block_filter(board_t board_in, int32_t block_size, double false_positive_rate, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SetBlockFilter, board_in, statsOf(board_in));
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    if (block_size < 0)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "block_size must not be negative");
+        return;
+    }
+
+    if ((block_size > 0) && !((false_positive_rate > 0.0) && (false_positive_rate < 1.0)))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "false_positive_rate must be between 0 and 1");
+        return;
+    }
+
+    translateExceptions(out_error, [&] { board_in->actual.setBlockFilter(block_size, false_positive_rate); });
+}
+
+void storyboard_set_text_compression(board_t board_in, int32_t enable, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SetTextCompression, board_in, statsOf(board_in));
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    translateExceptions(out_error, [&] { board_in->actual.setTextCompression(enable != 0); });
+}
+
+void storyboard_set_memory_budget(board_t board_in, uint64_t budget, const char* directory, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SetMemoryBudget, board_in, statsOf(board_in));
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    if (budget && !directory)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "directory not initialized");
+        return;
+    }
+
+    // A budget beyond the address space is never reached
+    std::size_t bytes = static_cast<std::size_t>(std::min<uint64_t>(budget, std::numeric_limits<std::size_t>::max()));
+
+    translateExceptions(out_error, [&] { board_in->actual.setMemoryBudget(bytes, directory ? directory : ""); });
+}
+
+void storyboard_memory_usage(const board_t board_in, storyboard_memory_stats* out_stats, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::MemoryUsage, board_in, statsOf(board_in));
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    if (!out_stats)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "out_stats not initialized");
+        return;
+    }
+
+    translateExceptions(out_error, [&] {
+        storyboard::MemoryUsage usage = board_in->actual.memoryUsage();
+
+        out_stats->notes         = usage.notes;
+        out_stats->titles        = usage.titles;
+        out_stats->texts         = usage.texts;
+        out_stats->tags          = usage.tags;
+        out_stats->slack         = usage.slack;
+        out_stats->tag_index     = usage.tag_index;
+        out_stats->query_cache   = usage.query_cache;
+        out_stats->tombstones    = usage.tombstones;
+        out_stats->filters       = usage.filters;
+        out_stats->content_index = usage.content_index;
+        out_stats->dictionary    = usage.dictionary;
+        out_stats->total         = usage.total;
+        out_stats->spilled       = usage.spilled;
+    });
+}
+
+void storyboard_set_delete_mode(board_t board_in, int32_t mode, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::SetDeleteMode, board_in, statsOf(board_in));
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    // The raw value may be any integer, so it is not loaded as the enum type
+    if ((mode != STORYBOARD_DELETE_ERASE) && (mode != STORYBOARD_DELETE_TOMBSTONE))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "unknown delete mode");
+        return;
+    }
+
+    translateExceptions(out_error, [&] {
+        board_in->actual.setDeleteMode((mode == STORYBOARD_DELETE_TOMBSTONE) ? storyboard::DeleteMode::Tombstone
+                                                                             : storyboard::DeleteMode::Erase);
     });
+}
+
+int32_t storyboard_compact(board_t board_in, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::Compact, board_in, statsOf(board_in));
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] { nr_results = board_in->actual.compact(); });
 
+    scope.setResults(nr_results);
     return nr_results;
 }
 
-int32_t storyboard_get_nr_notes(const board_t board_in, error_t_* out_error)
+void storyboard_set_auto_compaction(board_t board_in, double threshold, error_t_* out_error)
 {
-    int32_t length = -1;
+    ApiScope scope(ApiOp::SetAutoCompaction, board_in, statsOf(board_in));
 
     if (!board_in)
     {
-        *out_error = new error{"board_in not initialized"};
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
     }
 
-    translateExceptions(out_error, [&] { length = board_in->actual.length(); });
+    if (!(threshold >= 0.0 && threshold <= 1.0))
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "threshold must be between 0 and 1");
+        return;
+    }
 
-    return length;
+    translateExceptions(out_error, [&] { board_in->compactor.setThreshold(threshold); });
+}
+
+void storyboard_enable_stats(board_t board_in, int32_t enable, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::EnableStats, board_in);
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    translateExceptions(out_error, [&] { board_in->stats.setEnabled(enable != 0); });
+}
+
+int32_t storyboard_get_stats(const board_t board_in, storyboard_stats_handler handler, void* client_data,
+                             error_t_* out_error)
+{
+    ApiScope scope(ApiOp::GetStats, board_in);
+
+    int32_t nr_results = 0;
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return nr_results;
+    }
+
+    if (!handler)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "handler not initialized");
+        return nr_results;
+    }
+
+    translateExceptions(out_error, [&] { nr_results = board_in->stats.report(handler, client_data); });
+
+    scope.setResults(nr_results);
+    return nr_results;
+}
+
+void storyboard_reset_stats(board_t board_in, error_t_* out_error)
+{
+    ApiScope scope(ApiOp::ResetStats, board_in);
+
+    if (!board_in)
+    {
+        reportError(out_error, STORYBOARD_ERROR_INVALID_ARGUMENT, "board_in not initialized");
+        return;
+    }
+
+    board_in->stats.reset();
+}
+
+void storyboard_set_trace_hooks(storyboard_trace_begin_handler begin_cb, storyboard_trace_end_handler end_cb,
+                                void* user_data)
+{
+    // There is no error object, a failure is only recorded in the thread-local error record
+    translateExceptions(nullptr, [&] { setTraceHooks(begin_cb, end_cb, user_data); });
+}
+
+storyboard_status storyboard_last_error_code(void)
+{
+    return t_last_error_code;
+}
+
+const char* storyboard_last_error_message(void)
+{
+    return t_last_error_code == STORYBOARD_OK ? "" : t_error_buffer;
+}
+
+void storyboard_clear_last_error(void)
+{
+    t_last_error_code = STORYBOARD_OK;
+}
+
+void storyboard_set_error_buffer(char* buffer, int32_t buffer_size)
+{
+    if (buffer && buffer_size > 0)
+    {
+        t_error_buffer      = buffer;
+        t_error_buffer_size = buffer_size;
+    }
+    else
+    {
+        t_error_buffer      = t_default_error_buffer;
+        t_error_buffer_size = DEFAULT_ERROR_BUFFER_SIZE;
+    }
+
+    t_error_buffer[0] = '\0';
 }
 
 }  // End of extern "C"
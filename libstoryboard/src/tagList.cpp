@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include <storyboard/tagList.hpp>
+
+namespace storyboard {
+
+// Each shard starts on its own cache line, so that the locks of different shards are not shared between cores
+struct alignas(64) TagTable::Shard
+{
+    using tag_ref_t = std::reference_wrapper<const std::string>;
+    using entries_t = std::unordered_map<tag_ref_t, std::unique_ptr<Entry>, std::hash<std::string>,
+                                         std::equal_to<std::string>>;
+
+    entries_t               tags;   /// Entries keyed by their own tag, they keep their address when the map grows
+    std::shared_timed_mutex mutex;  /// Lookups share the lock, inserts and removals are exclusive
+};
+
+TagTable::Shard& TagTable::shard(const std::string& tag)
+{
+    struct Table
+    {
+        Shard shards[64];
+    };
+
+    // Never destroyed, since tag lists held by static objects may release their tags after the end of main(). The
+    // storage is static rather than allocated, so that the shards are aligned in C++14 as well.
+    alignas(Table) static unsigned char storage[sizeof(Table)];
+    static Table*                       table = new (storage) Table;
+
+    std::size_t hash = std::hash<std::string>()(tag);
+    return table->shards[hash % (sizeof(table->shards) / sizeof(Shard))];
+}
+
+const std::string* TagTable::intern(const std::string& tag)
+{
+    if (const std::string* interned = find(tag))
+    {
+        return interned;
+    }
+
+    Shard&                                   shard = TagTable::shard(tag);
+    std::lock_guard<std::shared_timed_mutex> lock(shard.mutex);
+
+    // Another thread may have added the tag since the lookup
+    auto it = shard.tags.find(tag);
+
+    if (it != shard.tags.end())
+    {
+        acquire(it->second.get());
+        return it->second.get();
+    }
+
+    std::unique_ptr<Entry> entry(new Entry(tag));
+    const std::string*     interned = entry.get();
+    shard.tags.emplace(*interned, std::move(entry));
+    return interned;
+}
+
+const std::string* TagTable::find(const std::string& tag)
+{
+    Shard&                                    shard = TagTable::shard(tag);
+    std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+
+    auto it = shard.tags.find(tag);
+
+    if (it == shard.tags.end())
+    {
+        return nullptr;
+    }
+
+    // The last reference is only released under the exclusive lock, so the tag cannot leave the table meanwhile
+    acquire(it->second.get());
+    return it->second.get();
+}
+
+void TagTable::releaseLast(const std::string* tag)
+{
+    Shard&                                   shard = TagTable::shard(*tag);
+    std::lock_guard<std::shared_timed_mutex> lock(shard.mutex);
+
+    // A lookup may have taken a new reference since the count was read
+    if (static_cast<const Entry*>(tag)->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        shard.tags.erase(*tag);
+    }
+}
+
+std::size_t TagTable::bytes(const std::string* tag)
+{
+    // Nodes of the table hold the key, the pointer to the entry and the link to the next node
+    return sizeof(Entry) + sizeof(Shard::entries_t::value_type) + sizeof(void*) + tag->size();
+}
+
+TagList::TagList(const std::vector<std::string>& tags)
+{
+    for (auto& tag : tags)
+    {
+        push_back(tag);
+    }
+}
+
+void TagList::push_back(const std::string& tag)
+{
+    const std::string* interned = TagTable::intern(tag);
+
+    if (m_size == m_capacity)
+    {
+        std::uint32_t       size     = m_size;
+        std::uint32_t       capacity = m_capacity * 2;
+        const std::string** storage  = new const std::string*[capacity];
+
+        std::copy(data(), data() + size, storage);
+
+        // The tags move to the new storage with their references
+        if (m_capacity > INLINE_CAPACITY)
+        {
+            delete[] m_heap;
+        }
+
+        m_heap     = storage;
+        m_size     = size;
+        m_capacity = capacity;
+    }
+
+    data()[m_size++] = interned;
+}
+
+void TagList::normalize()
+{
+    // Equal tags share their interned pointer, so the duplicates end up next to each other
+    const std::string** tags = data();
+    std::sort(tags, tags + m_size, before);
+
+    std::uint32_t size = 0;
+
+    for (std::uint32_t index = 0; index < m_size; index++)
+    {
+        if ((size > 0) && (tags[size - 1] == tags[index]))
+        {
+            TagTable::release(tags[index]);
+        }
+        else
+        {
+            tags[size++] = tags[index];
+        }
+    }
+
+    m_size = size;
+}
+
+}  // End of namespace storyboard
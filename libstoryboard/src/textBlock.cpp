@@ -0,0 +1,605 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include <storyboard/textBlock.hpp>
+
+namespace storyboard {
+
+namespace {
+
+const std::size_t MIN_MATCH  = 4;   // Shorter repeats are stored as literals
+const unsigned    HASH_BITS  = 15;  // Slots of the match finder
+const int         MAX_CHAIN  = 16;  // Earlier positions with the same hash tried for each match
+const std::size_t KMER       = 8;   // Length of the sequences counted by the dictionary training
+const std::size_t SEGMENT    = 64;  // Length of the dictionary segments
+const unsigned    COUNT_BITS = 20;  // Slots of the sequence counts of the dictionary training
+
+std::uint32_t matchSlot(const char* data)
+{
+    std::uint32_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return (word * 2654435761U) >> (32 - HASH_BITS);
+}
+
+std::uint32_t kmerSlot(const char* data)
+{
+    std::uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return static_cast<std::uint32_t>((word * 0x9e3779b97f4a7c15ULL) >> (64 - COUNT_BITS));
+}
+
+// Lengths that do not fit in their 4 bits continue in bytes, 255 meaning that another byte follows
+void putLength(std::string& out, std::size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        out.push_back(static_cast<char>(255));
+    }
+
+    out.push_back(static_cast<char>(length));
+}
+
+// The data of a spilled block comes back from a file, so nothing it says is trusted
+[[noreturn]] void corrupt()
+{
+    throw std::runtime_error("corrupt text block");
+}
+
+std::size_t getLength(const unsigned char*& in, const unsigned char* end, std::size_t length)
+{
+    unsigned char byte;
+
+    do
+    {
+        if (in == end)
+        {
+            corrupt();
+        }
+
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+
+    return length;
+}
+
+// Offsets reach into the dictionary, so they are stored in 7-bit groups rather than in a fixed size
+void putOffset(std::string& out, std::size_t offset)
+{
+    for (; offset >= 0x80; offset >>= 7)
+    {
+        out.push_back(static_cast<char>((offset & 0x7f) | 0x80));
+    }
+
+    out.push_back(static_cast<char>(offset));
+}
+
+std::size_t getOffset(const unsigned char*& in, const unsigned char* end)
+{
+    std::size_t offset = 0;
+
+    for (unsigned shift = 0;; shift += 7)
+    {
+        // Offsets never reach the 32-bit range, more groups can only be garbage
+        if (in == end || shift > 28)
+        {
+            corrupt();
+        }
+
+        unsigned char byte = *in++;
+        offset |= std::size_t(byte & 0x7f) << shift;
+
+        if (byte < 0x80)
+        {
+            return offset;
+        }
+    }
+}
+
+/**
+ * @brief Appends a sequence: a token with the literal and match lengths, the literals, then the match
+ * @details The last sequence of a block has no match. The decompression knows it from the size of the block.
+ */
+void putSequence(std::string& out, const char* literals, std::size_t nr_literals, std::size_t match_length,
+                 std::size_t offset)
+{
+    std::size_t literal_bits = std::min<std::size_t>(nr_literals, 15);
+    std::size_t match_bits   = match_length ? std::min<std::size_t>(match_length - MIN_MATCH, 15) : 0;
+    out.push_back(static_cast<char>((literal_bits << 4) | match_bits));
+
+    if (literal_bits == 15)
+    {
+        putLength(out, nr_literals - 15);
+    }
+
+    out.append(literals, nr_literals);
+
+    if (match_length)
+    {
+        if (match_bits == 15)
+        {
+            putLength(out, match_length - MIN_MATCH - 15);
+        }
+
+        putOffset(out, offset);
+    }
+}
+
+// The scores ignore the first occurrence of a sequence, so that sequences that do not repeat count for nothing
+std::size_t weight(std::uint32_t count)
+{
+    return count > 1 ? count - 1 : 0;
+}
+
+/**
+ * @brief Decompressed blocks of a thread, the least recently used one is replaced
+ */
+struct BlockCache
+{
+    struct Entry
+    {
+        /**
+         * @brief Returns true if the entry holds the texts of the block
+         * @details The block is alive, so an entry whose block is alive at the same address holds its texts.
+         */
+        bool holds(const TextBlock* candidate) const
+        {
+            return (address == candidate) && !block.expired();
+        }
+
+        const TextBlock*                          address = nullptr;  /// Block whose texts are held, nullptr if none
+        std::weak_ptr<const TextBlock>            block;              /// Tells whether the block still exists
+        std::shared_ptr<std::vector<std::string>> texts;              /// Decompressed texts, shared with the pins
+        std::uint64_t                             last_use = 0;       /// Value of the clock at the last use
+    };
+
+    std::array<Entry, TextBlock::CACHE_SIZE> entries;
+    std::size_t                              last  = 0;  /// Entry used last
+    std::uint64_t                            clock = 0;  /// Incremented on every use
+    std::string                              data;       /// Uncompressed data of the last block decompressed
+    std::string                              stored;     /// Data of the last spilled block read back
+};
+
+thread_local BlockCache t_cache;
+
+// Orders the reads of all the threads, so that the blocks that were not read for the longest time are spilled first
+std::atomic<std::uint64_t> g_readClock{0};
+
+}  // namespace
+
+std::shared_ptr<const TextDictionary> TextDictionary::train(const std::vector<const std::string*>& texts)
+{
+    auto dictionary = std::make_shared<TextDictionary>();
+
+    std::string sample;
+    for (auto text : texts)
+    {
+        if (sample.size() == MAX_SAMPLE_BYTES)
+        {
+            break;
+        }
+
+        sample.append(*text, 0, MAX_SAMPLE_BYTES - sample.size());
+    }
+
+    if (sample.size() < SEGMENT)
+    {
+        return dictionary;
+    }
+
+    // Colliding sequences share their count, which only blurs the scores
+    std::vector<std::uint32_t> counts(std::size_t(1) << COUNT_BITS, 0);
+    std::vector<std::uint32_t> slots(sample.size() - KMER + 1);
+
+    for (std::size_t pos = 0; pos < slots.size(); pos++)
+    {
+        slots[pos] = kmerSlot(&sample[pos]);
+        counts[slots[pos]]++;
+    }
+
+    struct Segment
+    {
+        std::size_t score;
+        std::size_t start;
+    };
+
+    const std::size_t    nr_sequences = SEGMENT - KMER + 1;  // Sequences that start in a segment
+    const std::size_t    last_start   = sample.size() - SEGMENT;
+    const std::size_t    max_segments = MAX_BYTES / SEGMENT;
+    const std::size_t    epoch_size   = std::max(SEGMENT, sample.size() / max_segments);
+    std::vector<Segment> segments;
+
+    for (std::size_t epoch = 0; (epoch <= last_start) && (segments.size() < max_segments); epoch += epoch_size)
+    {
+        std::size_t score = 0;
+        for (std::size_t pos = epoch; pos < epoch + nr_sequences; pos++)
+        {
+            score += weight(counts[slots[pos]]);
+        }
+
+        Segment best{score, epoch};
+
+        // The score of the next segment differs by its first and its last sequence
+        for (std::size_t start = epoch + 1; start <= std::min(epoch + epoch_size - 1, last_start); start++)
+        {
+            score += weight(counts[slots[start + nr_sequences - 1]]);
+            score -= weight(counts[slots[start - 1]]);
+
+            if (score > best.score)
+            {
+                best = Segment{score, start};
+            }
+        }
+
+        if (best.score == 0)
+        {
+            continue;
+        }
+
+        segments.push_back(best);
+
+        for (std::size_t pos = best.start; pos < best.start + nr_sequences; pos++)
+        {
+            counts[slots[pos]] = 0;
+        }
+    }
+
+    std::sort(segments.begin(), segments.end(), [](const Segment& lhs, const Segment& rhs) {
+        return lhs.score < rhs.score;
+    });
+
+    for (auto& segment : segments)
+    {
+        dictionary->m_data.append(sample, segment.start, SEGMENT);
+    }
+
+    dictionary->m_data.shrink_to_fit();
+    return dictionary;
+}
+
+std::size_t TextDictionary::bytes() const
+{
+    return sizeof(TextDictionary) + m_data.capacity();
+}
+
+std::shared_ptr<const TextBlock> TextBlock::compress(const std::vector<const std::string*>& texts,
+                                                     std::shared_ptr<const TextDictionary> dictionary)
+{
+    auto block          = std::make_shared<TextBlock>();
+    block->m_dictionary = std::move(dictionary);
+
+    if (!block->m_dictionary)
+    {
+        for (auto text : texts)
+        {
+            block->m_offsets.push_back(static_cast<std::uint32_t>(block->m_data.size()));
+            block->m_data.append(*text);
+        }
+
+        block->m_offsets.push_back(static_cast<std::uint32_t>(block->m_data.size()));
+        block->m_data.shrink_to_fit();
+        return block;
+    }
+
+    // The texts are matched against the dictionary as if it preceded them
+    std::string window = block->m_dictionary->data();
+    std::size_t start  = window.size();
+
+    for (auto text : texts)
+    {
+        block->m_offsets.push_back(static_cast<std::uint32_t>(window.size() - start));
+        window.append(*text);
+    }
+
+    block->m_offsets.push_back(static_cast<std::uint32_t>(window.size() - start));
+
+    // Chains of the earlier positions with the same hash, the most recent first
+    std::vector<std::int32_t> head(std::size_t(1) << HASH_BITS, -1);
+    std::vector<std::int32_t> previous(window.size());
+
+    auto insert = [&window, &head, &previous](std::size_t pos) {
+        std::uint32_t slot = matchSlot(&window[pos]);
+        previous[pos]      = head[slot];
+        head[slot]         = static_cast<std::int32_t>(pos);
+    };
+
+    const std::size_t end = window.size();
+
+    for (std::size_t pos = 0; pos + MIN_MATCH <= start; pos++)
+    {
+        insert(pos);
+    }
+
+    std::string& out           = block->m_data;
+    std::size_t  literal_start = start;
+    std::size_t  pos           = start;
+
+    while (pos + MIN_MATCH <= end)
+    {
+        std::size_t  best_length = 0;
+        std::size_t  best_pos    = 0;
+        std::int32_t candidate   = head[matchSlot(&window[pos])];
+
+        for (int depth = 0; (candidate >= 0) && (depth < MAX_CHAIN); depth++)
+        {
+            std::size_t length = 0;
+            while ((pos + length < end) && (window[candidate + length] == window[pos + length]))
+            {
+                length++;
+            }
+
+            if (length > best_length)
+            {
+                best_length = length;
+                best_pos    = candidate;
+            }
+
+            candidate = previous[candidate];
+        }
+
+        insert(pos);
+
+        if (best_length < MIN_MATCH)
+        {
+            pos++;
+            continue;
+        }
+
+        putSequence(out, &window[literal_start], pos - literal_start, best_length, pos - best_pos);
+
+        for (std::size_t next = pos + 1; (next < pos + best_length) && (next + MIN_MATCH <= end); next++)
+        {
+            insert(next);
+        }
+
+        pos += best_length;
+        literal_start = pos;
+    }
+
+    if (literal_start < end)
+    {
+        putSequence(out, &window[literal_start], end - literal_start, 0, 0);
+    }
+
+    out.shrink_to_fit();
+    return block;
+}
+
+void TextBlock::decompress(const std::string& stored, std::string& data, std::vector<std::string>& texts) const
+{
+    texts.resize(nrTexts());
+
+    if (!m_dictionary)
+    {
+        if (stored.size() != m_offsets.back())
+        {
+            corrupt();
+        }
+
+        for (std::size_t index = 0; index < texts.size(); index++)
+        {
+            texts[index].assign(stored, m_offsets[index], m_offsets[index + 1] - m_offsets[index]);
+        }
+
+        return;
+    }
+
+    const std::string&   dictionary = m_dictionary->data();
+    const std::size_t    size       = m_offsets.back();
+    const unsigned char* in         = reinterpret_cast<const unsigned char*>(stored.data());
+    const unsigned char* end        = in + stored.size();
+    std::size_t          produced   = 0;
+    data.resize(size);
+
+    // Every length and offset is checked against what is left of the input and of the output before it is used
+    while (produced < size)
+    {
+        if (in == end)
+        {
+            corrupt();
+        }
+
+        unsigned    token       = *in++;
+        std::size_t nr_literals = token >> 4;
+
+        if (nr_literals == 15)
+        {
+            nr_literals = getLength(in, end, nr_literals);
+        }
+
+        if (nr_literals > std::size_t(end - in) || nr_literals > size - produced)
+        {
+            corrupt();
+        }
+
+        std::memcpy(&data[produced], in, nr_literals);
+        in += nr_literals;
+        produced += nr_literals;
+
+        if (produced == size)
+        {
+            break;
+        }
+
+        std::size_t length = token & 15;
+
+        if (length == 15)
+        {
+            length = getLength(in, end, length);
+        }
+
+        length += MIN_MATCH;
+        std::size_t offset = getOffset(in, end);
+
+        if (length > size - produced || offset == 0 || offset > produced + dictionary.size())
+        {
+            corrupt();
+        }
+
+        // The part of the match that is in the dictionary, the rest follows at the start of the data
+        if (offset > produced)
+        {
+            std::size_t from_dictionary = std::min(length, offset - produced);
+            std::memcpy(&data[produced], &dictionary[dictionary.size() - (offset - produced)], from_dictionary);
+            produced += from_dictionary;
+            length -= from_dictionary;
+        }
+
+        // Matches can overlap the bytes they produce, which then repeat
+        if (offset >= length)
+        {
+            std::memcpy(&data[produced], &data[produced - offset], length);
+            produced += length;
+        }
+        else
+        {
+            for (std::size_t source = produced - offset; length > 0; length--)
+            {
+                data[produced++] = data[source++];
+            }
+        }
+    }
+
+    if (in != end)
+    {
+        corrupt();
+    }
+
+    for (std::size_t index = 0; index < texts.size(); index++)
+    {
+        texts[index].assign(data, m_offsets[index], m_offsets[index + 1] - m_offsets[index]);
+    }
+}
+
+std::string TextBlock::text(std::uint32_t index) const
+{
+    return (*cachedTexts())[index];
+}
+
+std::shared_ptr<const std::string> TextBlock::pin(std::uint32_t index) const
+{
+    const std::shared_ptr<std::vector<std::string>>& texts = cachedTexts();
+    return std::shared_ptr<const std::string>(texts, &(*texts)[index]);
+}
+
+const std::shared_ptr<std::vector<std::string>>& TextBlock::cachedTexts() const
+{
+    BlockCache& cache = t_cache;
+
+    // Scans read the texts of a block one after the other, so the entry used last is the likely one
+    if (!cache.entries[cache.last].holds(this))
+    {
+        m_lastRead.store(++g_readClock, std::memory_order_relaxed);
+
+        std::size_t oldest = 0;
+        std::size_t found  = CACHE_SIZE;
+
+        for (std::size_t entry = 0; (entry < CACHE_SIZE) && (found == CACHE_SIZE); entry++)
+        {
+            BlockCache::Entry& candidate = cache.entries[entry];
+
+            if (candidate.holds(this))
+            {
+                found = entry;
+                continue;
+            }
+
+            if (candidate.address && candidate.block.expired())
+            {
+                // The texts of a block that went away are released, and the entry is the first to be reused
+                candidate.texts.reset();
+                candidate.address  = nullptr;
+                candidate.last_use = 0;
+            }
+
+            if (candidate.last_use < cache.entries[oldest].last_use)
+            {
+                oldest = entry;
+            }
+        }
+
+        if (found == CACHE_SIZE)
+        {
+            // The block is forgotten first, in case the decompression throws
+            BlockCache::Entry& entry = cache.entries[oldest];
+            found                    = oldest;
+            entry.address            = nullptr;
+            entry.block.reset();
+
+            // The capacity of the texts is reused, unless a caller still holds them
+            if (!entry.texts || (entry.texts.use_count() > 1))
+            {
+                entry.texts = std::make_shared<std::vector<std::string>>();
+            }
+
+            if (m_segment)
+            {
+                m_segment->read(m_segmentOffset, m_segmentBytes, cache.stored);
+            }
+
+            decompress(m_segment ? cache.stored : m_data, cache.data, *entry.texts);
+            entry.address = this;
+            entry.block   = shared_from_this();
+        }
+
+        cache.last = found;
+    }
+
+    BlockCache::Entry& entry = cache.entries[cache.last];
+    entry.last_use           = ++cache.clock;
+    return entry.texts;
+}
+
+std::size_t TextBlock::storedBytes(std::uint32_t index) const
+{
+    return share(bytes(), index);
+}
+
+std::size_t TextBlock::spilledBytes(std::uint32_t index) const
+{
+    return share(m_segmentBytes, index);
+}
+
+std::size_t TextBlock::share(std::size_t bytes, std::uint32_t index) const
+{
+    std::uint64_t size   = m_offsets.back();
+    std::uint64_t length = m_offsets[index + 1] - m_offsets[index];
+
+    if (size == 0)
+    {
+        return bytes / nrTexts();
+    }
+
+    return static_cast<std::size_t>(bytes * length / size);
+}
+
+std::shared_ptr<const TextBlock> TextBlock::spill(const std::shared_ptr<SegmentFile>& segment) const
+{
+    auto block             = std::make_shared<TextBlock>();
+    block->m_dictionary    = m_dictionary;
+    block->m_offsets       = m_offsets;
+    block->m_segment       = segment;
+    block->m_segmentOffset = segment->append(m_data);
+    block->m_segmentBytes  = m_data.size();
+    block->m_lastRead.store(lastRead(), std::memory_order_relaxed);
+    return block;
+}
+
+std::shared_ptr<const TextBlock> TextBlock::load() const
+{
+    auto block          = std::make_shared<TextBlock>();
+    block->m_dictionary = m_dictionary;
+    block->m_offsets    = m_offsets;
+    m_segment->read(m_segmentOffset, m_segmentBytes, block->m_data);
+    block->m_lastRead.store(lastRead(), std::memory_order_relaxed);
+    return block;
+}
+
+std::size_t TextBlock::bytes() const
+{
+    return sizeof(TextBlock) + m_data.capacity() + m_offsets.capacity() * sizeof(std::uint32_t);
+}
+
+}  // End of namespace storyboard
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#include <storyboard/threadPool.hpp>
+
+namespace storyboard {
+
+ThreadPool::ThreadPool(std::size_t nr_workers)
+{
+    for (std::size_t index = 0; index < nr_workers; index++)
+    {
+        m_workers.emplace_back([this] { run(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_wakeup.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::parallelFor(std::size_t nr_items, const std::function<void(std::size_t)>& fn)
+{
+    if ((nr_items <= 1) || m_workers.empty())
+    {
+        for (std::size_t index = 0; index < nr_items; index++)
+        {
+            fn(index);
+        }
+
+        return;
+    }
+
+    // Shared with the workers, which may pick up their task after this call has returned
+    struct Job
+    {
+        std::atomic<std::size_t> next{0};
+        std::size_t              done = 0;
+        std::exception_ptr       error;
+        std::mutex               mutex;
+        std::condition_variable  finished;
+    };
+
+    auto job  = std::make_shared<Job>();
+    auto work = [job, nr_items, &fn] {
+        std::size_t index;
+
+        // fn is only used while there are items left, i.e. while parallelFor is still waiting
+        while ((index = job->next.fetch_add(1)) < nr_items)
+        {
+            std::exception_ptr error;
+
+            try
+            {
+                fn(index);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(job->mutex);
+
+            if (error && !job->error)
+            {
+                job->error = error;
+            }
+
+            if (++job->done == nr_items)
+            {
+                job->finished.notify_one();
+            }
+        }
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (std::size_t helper = 0; helper < std::min(nr_items - 1, m_workers.size()); helper++)
+        {
+            m_tasks.push_back(work);
+        }
+    }
+
+    m_wakeup.notify_all();
+    work();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job, nr_items] { return job->done == nr_items; });
+
+    if (job->error)
+    {
+        std::rethrow_exception(job->error);
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    if (m_workers.empty())
+    {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+
+    m_wakeup.notify_one();
+}
+
+void ThreadPool::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_wakeup.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+
+        if (m_tasks.empty())
+        {
+            return;
+        }
+
+        std::function<void()> task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+}  // End of namespace storyboard
@@ -1,9 +1,45 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "storyboard/storyboardCAPI.h"
 
+namespace {
+
+// Allocations of the calling thread, counted by the replaced operator new
+thread_local std::size_t t_nr_allocations = 0;
+
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+    t_nr_allocations++;
+
+    if (void* memory = std::malloc(size ? size : 1))
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
 class QueryTestCAPI : public ::testing::Test
 {
 protected:
@@ -83,6 +119,167 @@ TEST(CAPI, construct_and_destruct_note)
     ASSERT_EQ(my_note, nullptr);
 }
 
+TEST(CAPI, note_get_tags_array)
+{
+    error_t_ my_error = nullptr;
+
+    const int32_t NR_TAGS       = 3;
+    const char*   tags[NR_TAGS] = {"t1", "tag2", "t3"};
+
+    note_t my_note = note_construct("note", "text", tags, NR_TAGS, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    const char* const* out_tags    = nullptr;
+    const int32_t*     out_lengths = nullptr;
+
+    EXPECT_EQ(note_get_tags_array(my_note, &out_tags, &out_lengths, &my_error), NR_TAGS);
+    ASSERT_EQ(my_error, nullptr);
+    ASSERT_NE(out_tags, nullptr);
+    ASSERT_NE(out_lengths, nullptr);
+    EXPECT_EQ(std::string(out_tags[1]), "tag2");
+    EXPECT_EQ(out_lengths[0], 2);
+    EXPECT_EQ(out_lengths[1], 4);
+
+    // Lengths are optional
+    EXPECT_EQ(note_get_tags_array(my_note, &out_tags, nullptr, &my_error), NR_TAGS);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(note_get_tags_array(nullptr, &out_tags, nullptr, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+
+    note_destruct(my_note);
+}
+
+TEST(CAPI, note_many_tags)
+{
+    error_t_ my_error = nullptr;
+
+    // More tags than fit inline, a duplicate and a tag longer than the small string buffer
+    const int32_t NR_TAGS       = 7;
+    const char*   tags[NR_TAGS] = {"a", "b", "c", "d", "a", "a rather long tag that is not small", "g"};
+
+    note_t  my_note  = note_construct("note", "text", tags, NR_TAGS, &my_error);
+    board_t my_board = storyboard_construct(&my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    const char* const* out_tags = nullptr;
+    ASSERT_EQ(note_get_tags_array(my_note, &out_tags, nullptr, &my_error), NR_TAGS);
+    for (int32_t index = 0; index < NR_TAGS; index++)
+    {
+        EXPECT_EQ(std::string(out_tags[index]), tags[index]);
+    }
+
+    storyboard_add_note(my_board, my_note, &my_error);
+    board_t my_copy = storyboard_copy(my_board, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(storyboard_count_by_tag(my_copy, "a rather long tag that is not small", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_tag(my_copy, "g", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_tag(my_copy, "never seen", &my_error), 0);
+
+    // The duplicate tag is counted once per note
+    std::map<std::string, int32_t> stats;
+    auto                           callback = [](void* client_data, const char* tag, int32_t nr_notes) {
+        (*(std::map<std::string, int32_t>*)client_data)[tag] = nr_notes;
+    };
+    EXPECT_EQ(storyboard_get_tag_stats(my_copy, callback, &stats, &my_error), NR_TAGS - 1);
+    EXPECT_EQ(stats["a"], 1);
+
+    EXPECT_EQ(storyboard_delete_note(my_copy, my_note, &my_error), 1);
+    EXPECT_EQ(storyboard_get_nr_notes(my_copy, &my_error), 0);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_destruct(my_copy);
+    storyboard_destruct(my_board);
+    note_destruct(my_note);
+}
+
+TEST(CAPI, error_codes)
+{
+    error_t_ my_error = nullptr;
+
+    // Error objects carry a code
+    EXPECT_EQ(note_construct(nullptr, "text", nullptr, 0, &my_error), nullptr);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    EXPECT_EQ(std::string(error_message(my_error)), "title not initialized");
+    my_error = error_destruct(my_error);
+
+    // Without an error object, the error is only recorded in the thread-local error record
+    storyboard_clear_last_error();
+    EXPECT_EQ(storyboard_last_error_code(), STORYBOARD_OK);
+    EXPECT_EQ(std::string(storyboard_last_error_message()), "");
+
+    EXPECT_EQ(note_construct("title", nullptr, nullptr, 0, nullptr), nullptr);
+    EXPECT_EQ(storyboard_last_error_code(), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    EXPECT_EQ(std::string(storyboard_last_error_message()), "text not initialized");
+
+    EXPECT_EQ(storyboard_get_nr_notes(nullptr, nullptr), -1);
+    EXPECT_EQ(storyboard_last_error_code(), STORYBOARD_ERROR_INVALID_ARGUMENT);
+
+    // Messages are truncated to fit a caller-provided buffer
+    char buffer[6];
+    storyboard_set_error_buffer(buffer, sizeof(buffer));
+    storyboard_add_note(nullptr, nullptr, nullptr);
+    EXPECT_EQ(storyboard_last_error_code(), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    EXPECT_EQ(std::string(buffer), "board");
+    EXPECT_EQ(storyboard_last_error_message(), buffer);
+    storyboard_set_error_buffer(nullptr, 0);
+
+    storyboard_clear_last_error();
+    EXPECT_EQ(storyboard_last_error_code(), STORYBOARD_OK);
+}
+
+TEST(CAPI, error_codes_without_allocation)
+{
+    board_t my_board = storyboard_construct(nullptr);
+    ASSERT_NE(my_board, nullptr);
+
+    const char*   tags[]         = {"tag", nullptr};
+    const int32_t tag_lengths[]  = {3, 3};
+    const int32_t negative[]     = {3, -1};
+    note_t        my_note        = nullptr;
+    std::size_t   nr_allocations = t_nr_allocations;
+
+    // Failing validations with a NULL out_error only write the thread-local error record
+    note_t            bad_note     = note_construct_n("title", 5, "text", 4, tags, tag_lengths, 2, nullptr);
+    storyboard_status bad_tag      = note_construct_n_status("title", 5, "text", 4, tags, tag_lengths, 2, &my_note);
+    storyboard_status bad_length   = note_construct_n_status("title", 5, "text", 4, tags, negative, 2, &my_note);
+    int32_t           nr_bad_tags  = storyboard_count_by_tags(my_board, tags, 2, STORYBOARD_TAG_MATCH_ANY, nullptr);
+    int32_t           nr_bad_match = storyboard_count_by_tags(my_board, tags, 1, 7, nullptr);
+    storyboard_status no_board     = storyboard_add_note_status(nullptr, my_note, nullptr);
+    storyboard_status no_note      = storyboard_enqueue_note_status(my_board, nullptr);
+    nr_allocations                 = t_nr_allocations - nr_allocations;
+
+    EXPECT_EQ(nr_allocations, 0);
+    EXPECT_EQ(bad_note, nullptr);
+    EXPECT_EQ(bad_tag, STORYBOARD_ERROR_INVALID_ARGUMENT);
+    EXPECT_EQ(bad_length, STORYBOARD_ERROR_INVALID_ARGUMENT);
+    EXPECT_EQ(my_note, nullptr);
+    EXPECT_EQ(nr_bad_tags, 0);
+    EXPECT_EQ(nr_bad_match, 0);
+    EXPECT_EQ(no_board, STORYBOARD_ERROR_INVALID_ARGUMENT);
+    EXPECT_EQ(no_note, STORYBOARD_ERROR_INVALID_ARGUMENT);
+    EXPECT_EQ(std::string(storyboard_last_error_message()), "note_in not initialized");
+
+    // The status of a successful call is STORYBOARD_OK, while the error record keeps the last failure
+    int32_t nr_added = 0;
+    EXPECT_EQ(note_construct_n_status("title", 5, "text", 4, tags, tag_lengths, 1, &my_note), STORYBOARD_OK);
+    ASSERT_NE(my_note, nullptr);
+    EXPECT_EQ(storyboard_add_note_status(my_board, my_note, &nr_added), STORYBOARD_OK);
+    EXPECT_EQ(nr_added, 1);
+    EXPECT_EQ(storyboard_enqueue_note_status(my_board, my_note), STORYBOARD_OK);
+    storyboard_flush(my_board, nullptr);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, nullptr), 2);
+    EXPECT_EQ(storyboard_last_error_code(), STORYBOARD_ERROR_INVALID_ARGUMENT);
+
+    storyboard_clear_last_error();
+    note_destruct(my_note);
+    storyboard_destruct(my_board);
+}
+
 TEST(CAPI, construct_and_destruct_board)
 {
     board_t  my_board = nullptr;
@@ -118,6 +315,10 @@ TEST(CAPI, board_add_note)
     ASSERT_NE(my_error, nullptr);
     my_error = error_destruct(my_error);
 
+    EXPECT_EQ(storyboard_add_note_checked(nullptr, my_note, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+
     EXPECT_NO_THROW(storyboard_add_note(my_board, my_note, &my_error));
     ASSERT_EQ(my_error, nullptr);
     ASSERT_EQ(storyboard_get_nr_notes(my_board, &my_error), 1);
@@ -280,6 +481,1227 @@ TEST_F(QueryTestCAPI, board_search_by_tag)
     ASSERT_EQ(query_result.size(), 0);
 }
 
+TEST_F(QueryTestCAPI, board_query_cache)
+{
+    int32_t nr_results = 0;
+    auto    callback   = [](void*, const char*, const char*, const char*[], int32_t) {};
+
+    storyboard_cache_stats stats;
+
+    EXPECT_NO_THROW(storyboard_set_query_cache_capacity(my_board, -1, &my_error));
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+
+    EXPECT_NO_THROW(storyboard_set_query_cache_capacity(my_board, 2, &my_error));
+    ASSERT_EQ(my_error, nullptr);
+
+    // First query misses, second one is served from the cache
+    EXPECT_NO_THROW(nr_results = storyboard_search_by_tag(my_board, "t1", callback, nullptr, &my_error));
+    ASSERT_EQ(my_error, nullptr);
+    ASSERT_EQ(nr_results, 2);
+    EXPECT_NO_THROW(nr_results = storyboard_search_by_tag(my_board, "t1", callback, nullptr, &my_error));
+    ASSERT_EQ(my_error, nullptr);
+    ASSERT_EQ(nr_results, 2);
+
+    EXPECT_NO_THROW(storyboard_get_query_cache_stats(my_board, &stats, &my_error));
+    ASSERT_EQ(my_error, nullptr);
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.entries, 1);
+    ASSERT_EQ(stats.capacity, 2);
+    ASSERT_GT(stats.memory_bytes, 0);
+
+    // Adding a note invalidates the cached result
+    const char* tags[] = {"t1"};
+    note_t      note   = note_construct("title3", "text", tags, 1, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_NO_THROW(storyboard_add_note(my_board, note, &my_error));
+    ASSERT_EQ(my_error, nullptr);
+    note_destruct(note);
+
+    EXPECT_NO_THROW(nr_results = storyboard_search_by_tag(my_board, "t1", callback, nullptr, &my_error));
+    ASSERT_EQ(my_error, nullptr);
+    ASSERT_EQ(nr_results, 3);
+
+    // Least recently used results are evicted once the capacity is exceeded
+    EXPECT_NO_THROW(storyboard_search_by_title(my_board, "title1", callback, nullptr, &my_error));
+    EXPECT_NO_THROW(storyboard_search_by_text(my_board, "hello", callback, nullptr, &my_error));
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_NO_THROW(storyboard_get_query_cache_stats(my_board, &stats, &my_error));
+    ASSERT_EQ(my_error, nullptr);
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 4);
+    ASSERT_EQ(stats.entries, 2);
+    ASSERT_EQ(stats.evictions, 1);
+}
+
+TEST_F(QueryTestCAPI, copy_with_warm_query_cache)
+{
+    auto callback = [](void*, const char*, const char*, const char*[], int32_t) {};
+
+    storyboard_set_query_cache_capacity(my_board, 4, &my_error);
+    EXPECT_EQ(storyboard_search_by_tag(my_board, "t1", callback, nullptr, &my_error), 2);
+    EXPECT_EQ(storyboard_search_by_title(my_board, "title1", callback, nullptr, &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    // The copy keeps the capacity but none of the entries, which refer to the notes of the source
+    board_t my_copy = storyboard_copy(my_board, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    storyboard_destruct(my_board);
+    my_board = nullptr;
+
+    storyboard_cache_stats stats;
+    storyboard_get_query_cache_stats(my_copy, &stats, &my_error);
+    EXPECT_EQ(stats.entries, 0);
+    EXPECT_EQ(stats.capacity, 4);
+
+    EXPECT_EQ(storyboard_search_by_tag(my_copy, "t1", callback, nullptr, &my_error), 2);
+    EXPECT_EQ(storyboard_search_by_tag(my_copy, "t1", callback, nullptr, &my_error), 2);
+    EXPECT_EQ(storyboard_search_by_title(my_copy, "title1", callback, nullptr, &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_get_query_cache_stats(my_copy, &stats, &my_error);
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.entries, 2);
+
+    storyboard_destruct(my_copy);
+}
+
+TEST_F(QueryTestCAPI, board_count)
+{
+    EXPECT_EQ(storyboard_count_by_title(my_board, "title1", &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(storyboard_count_by_text(my_board, "text", &my_error), 2);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(storyboard_count_by_text(my_board, "hej", &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "t1", &my_error), 2);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "t5", &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(storyboard_count_by_tag(my_board, nullptr, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+}
+
+TEST_F(QueryTestCAPI, board_tag_stats)
+{
+    typedef std::map<std::string, int32_t> stats_t;
+    stats_t                                stats;
+
+    auto callback = [](void* client_data, const char* tag, int32_t nr_notes) {
+        (*(stats_t*)client_data)[std::string(tag)] = nr_notes;
+    };
+
+    EXPECT_EQ(storyboard_get_tag_stats(my_board, callback, &stats, &my_error), 5);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(stats, (stats_t{{"t1", 2}, {"t2", 1}, {"t3", 1}, {"t4", 1}, {"t5", 1}}));
+
+    // Statistics follow deletes
+    EXPECT_EQ(storyboard_delete_note(my_board, my_note1, &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    stats.clear();
+    EXPECT_EQ(storyboard_get_tag_stats(my_board, callback, &stats, &my_error), 3);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(stats, (stats_t{{"t1", 1}, {"t4", 1}, {"t5", 1}}));
+
+    EXPECT_EQ(storyboard_get_tag_stats(my_board, nullptr, &stats, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+}
+
+TEST_F(QueryTestCAPI, board_tag_facets)
+{
+    typedef std::map<std::string, int32_t> stats_t;
+    stats_t                                stats;
+
+    auto callback = [](void* client_data, const char* tag, int32_t nr_notes) {
+        (*(stats_t*)client_data)[std::string(tag)] = nr_notes;
+    };
+
+    EXPECT_EQ(storyboard_get_tag_facets(my_board, STORYBOARD_QUERY_BY_TEXT, "hello", callback, &stats, &my_error), 3);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(stats, (stats_t{{"t1", 1}, {"t4", 1}, {"t5", 1}}));
+
+    stats.clear();
+    EXPECT_EQ(storyboard_get_tag_facets(my_board, STORYBOARD_QUERY_BY_TAG, "t1", callback, &stats, &my_error), 5);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(stats, (stats_t{{"t1", 2}, {"t2", 1}, {"t3", 1}, {"t4", 1}, {"t5", 1}}));
+
+    stats.clear();
+    EXPECT_EQ(storyboard_get_tag_facets(my_board, STORYBOARD_QUERY_BY_TITLE, "none", callback, &stats, &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_TRUE(stats.empty());
+
+    EXPECT_EQ(storyboard_get_tag_facets(my_board, 7, "t1", callback, &stats, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    EXPECT_EQ(storyboard_get_tag_facets(my_board, STORYBOARD_QUERY_BY_TAG, "t1", nullptr, &stats, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+}
+
+TEST_F(QueryTestCAPI, board_stats)
+{
+    typedef std::map<std::string, storyboard_op_stats> stats_t;
+    stats_t                                            stats;
+
+    auto callback = [](void* client_data, const storyboard_op_stats* op_stats) {
+        (*(stats_t*)client_data)[std::string(op_stats->operation)] = *op_stats;
+    };
+
+    // Nothing is recorded before the statistics are enabled
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "t1", &my_error), 2);
+    EXPECT_EQ(storyboard_get_stats(my_board, callback, &stats, &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_enable_stats(my_board, 1, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(storyboard_count_by_text(my_board, "hello", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_text(my_board, "text", &my_error), 2);
+    EXPECT_EQ(storyboard_count_by_text(my_board, nullptr, nullptr), 0);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "t1", &my_error), 2);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(storyboard_get_stats(my_board, callback, &stats, &my_error), 2);
+    ASSERT_EQ(my_error, nullptr);
+
+    const storyboard_op_stats& text_stats = stats.at("storyboard_count_by_text");
+    EXPECT_EQ(text_stats.calls, 3);
+    EXPECT_EQ(text_stats.errors, 1);
+    EXPECT_EQ(text_stats.results, 3);
+    EXPECT_EQ(text_stats.notes_scanned, 4);
+
+    uint64_t nr_latencies = 0;
+    for (uint64_t bucket : text_stats.latency_buckets)
+    {
+        nr_latencies += bucket;
+    }
+    EXPECT_EQ(nr_latencies, 3);
+
+    // Tag counts are served from the tag statistics, without scanning the notes
+    EXPECT_EQ(stats.at("storyboard_count_by_tag").calls, 1);
+    EXPECT_EQ(stats.at("storyboard_count_by_tag").notes_scanned, 0);
+
+    storyboard_reset_stats(my_board, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    stats.clear();
+    EXPECT_EQ(storyboard_get_stats(my_board, callback, &stats, &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_enable_stats(nullptr, 1, &my_error);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+}
+
+TEST_F(QueryTestCAPI, board_delete_by)
+{
+    EXPECT_EQ(storyboard_delete_by_tag(my_board, "t9", &my_error), 0);
+    EXPECT_EQ(storyboard_delete_by_text(my_board, "hello", &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "t4", &my_error), 0);
+
+    // Both copies of note1 are removed in one call, also in tombstone mode
+    storyboard_add_note(my_board, my_note1, &my_error);
+    storyboard_set_delete_mode(my_board, STORYBOARD_DELETE_TOMBSTONE, &my_error);
+    EXPECT_EQ(storyboard_delete_by_title(my_board, "title1", &my_error), 2);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 0);
+    EXPECT_EQ(storyboard_get_tag_stats(my_board, [](void*, const char*, int32_t) {}, nullptr, &my_error), 0);
+
+    EXPECT_EQ(storyboard_delete_by_tag(my_board, nullptr, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+}
+
+TEST_F(QueryTestCAPI, board_memory_usage)
+{
+    storyboard_memory_stats usage;
+
+    storyboard_memory_usage(my_board, &usage, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(usage.titles, 12);
+    EXPECT_EQ(usage.texts, 23);
+    // t1 is shared by the notes, so it is counted once. Each of the 5 tags also has an entry in the table of tags.
+    const uint64_t tag_entry = (usage.tags - 10) / 5;
+    EXPECT_GT(tag_entry, 0);
+    EXPECT_EQ(usage.tags, 10 + 5 * tag_entry);
+    EXPECT_GT(usage.notes, 0);
+    EXPECT_GT(usage.tag_index, 0);
+    EXPECT_GT(usage.content_index, 0);
+    EXPECT_EQ(usage.query_cache, 0);
+    EXPECT_EQ(usage.total, usage.notes + usage.titles + usage.texts + usage.tags + usage.slack + usage.tag_index +
+                               usage.content_index + usage.query_cache);
+
+    // The counters follow deletes
+    const uint64_t tag_index = usage.tag_index;
+    EXPECT_EQ(storyboard_delete_note(my_board, my_note2, &my_error), 1);
+    storyboard_memory_usage(my_board, &usage, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(usage.titles, 6);
+    EXPECT_EQ(usage.texts, 4);
+    EXPECT_EQ(usage.tags, 6 + 3 * tag_entry);
+    EXPECT_LT(usage.tag_index, tag_index);
+
+    // Adding the note back gives the postings the same size as before
+    storyboard_add_note(my_board, my_note2, &my_error);
+    storyboard_memory_usage(my_board, &usage, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(usage.tag_index, tag_index);
+
+    storyboard_memory_usage(my_board, nullptr, &my_error);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+}
+
+TEST_F(QueryTestCAPI, board_tombstones)
+{
+    storyboard_memory_stats usage;
+
+    storyboard_set_delete_mode(my_board, STORYBOARD_DELETE_TOMBSTONE, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(storyboard_delete_note(my_board, my_note1, &my_error), 1);
+    EXPECT_EQ(storyboard_delete_note(my_board, my_note1, &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+
+    // Tombstones are skipped by queries, but keep their memory until the board is compacted
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_text(my_board, "text", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "t1", &my_error), 1);
+    storyboard_memory_usage(my_board, &usage, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_GT(usage.tombstones, 0);
+
+    EXPECT_EQ(storyboard_compact(my_board, &my_error), 1);
+    EXPECT_EQ(storyboard_compact(my_board, &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_memory_usage(my_board, &usage, &my_error);
+    EXPECT_EQ(usage.tombstones, 0);
+    EXPECT_EQ(usage.slack, 0);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_title(my_board, "title2", &my_error), 1);
+
+    storyboard_set_delete_mode(my_board, 7, &my_error);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+}
+
+TEST_F(QueryTestCAPI, board_auto_compaction)
+{
+    storyboard_memory_stats usage;
+
+    storyboard_set_delete_mode(my_board, STORYBOARD_DELETE_TOMBSTONE, &my_error);
+    storyboard_set_auto_compaction(my_board, 0.5, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(storyboard_delete_note(my_board, my_note2, &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    // The compaction runs on a background thread
+    for (int attempt = 0; attempt < 1000; attempt++)
+    {
+        storyboard_memory_usage(my_board, &usage, &my_error);
+
+        if (usage.tombstones == 0)
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(usage.tombstones, 0);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_title(my_board, "title1", &my_error), 1);
+
+    storyboard_set_auto_compaction(my_board, 1.5, &my_error);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+}
+
+TEST(CAPI, sharded_board)
+{
+    error_t_    my_error = nullptr;
+    const char* tags[2]  = {"shared", nullptr};
+    board_t     my_board = storyboard_construct_sharded(4, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    ASSERT_NE(my_board, nullptr);
+
+    EXPECT_EQ(storyboard_construct_sharded(0, &my_error), nullptr);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+
+    // Each thread adds its own notes, concurrently with the others
+    const int                NR_THREADS = 4;
+    const int                NR_NOTES   = 100;
+    std::vector<std::thread> threads;
+
+    for (int thread = 0; thread < NR_THREADS; thread++)
+    {
+        threads.emplace_back([my_board, thread, &tags] {
+            std::string own_tag      = "thread" + std::to_string(thread);
+            const char* note_tags[2] = {tags[0], own_tag.c_str()};
+
+            for (int index = 0; index < NR_NOTES; index++)
+            {
+                std::string title = own_tag + "_" + std::to_string(index);
+                note_t      note  = note_construct(title.c_str(), "text", note_tags, 2, nullptr);
+                storyboard_add_note(my_board, note, nullptr);
+                note_destruct(note);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), NR_THREADS * NR_NOTES);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "shared", &my_error), NR_THREADS * NR_NOTES);
+    EXPECT_EQ(storyboard_count_by_title(my_board, "thread2_42", &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    int32_t nr_visited = 0;
+    auto    handler    = [](void* client_data, const char*, const char*, const char**, int32_t) {
+        (*(int32_t*)client_data)++;
+    };
+
+    EXPECT_EQ(storyboard_search_by_tag(my_board, "thread1", handler, &nr_visited, &my_error), NR_NOTES);
+    EXPECT_EQ(nr_visited, NR_NOTES);
+
+    typedef std::map<std::string, int32_t> stats_t;
+    stats_t                                stats;
+
+    auto callback = [](void* client_data, const char* tag, int32_t nr_notes) {
+        (*(stats_t*)client_data)[std::string(tag)] = nr_notes;
+    };
+
+    EXPECT_EQ(storyboard_get_tag_stats(my_board, callback, &stats, &my_error), NR_THREADS + 1);
+    EXPECT_EQ(stats["shared"], NR_THREADS * NR_NOTES);
+    EXPECT_EQ(stats["thread3"], NR_NOTES);
+
+    EXPECT_EQ(storyboard_delete_by_tag(my_board, "thread0", &my_error), NR_NOTES);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), (NR_THREADS - 1) * NR_NOTES);
+
+    board_t my_copy = storyboard_copy(my_board, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(storyboard_count_by_text(my_copy, "text", &my_error), (NR_THREADS - 1) * NR_NOTES);
+
+    storyboard_destruct(my_copy);
+    storyboard_destruct(my_board);
+}
+
+TEST(CAPI, enqueue_and_flush)
+{
+    error_t_    my_error = nullptr;
+    const char* tags[1]  = {"queued"};
+    board_t     my_board = storyboard_construct(&my_error);
+
+    // Nothing has been queued yet
+    storyboard_flush(my_board, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    const int                NR_THREADS = 8;
+    const int                NR_NOTES   = 200;
+    std::vector<std::thread> threads;
+
+    for (int thread = 0; thread < NR_THREADS; thread++)
+    {
+        threads.emplace_back([my_board, thread, &tags] {
+            for (int index = 0; index < NR_NOTES; index++)
+            {
+                std::string title = "thread" + std::to_string(thread) + "_" + std::to_string(index);
+                note_t      note  = note_construct(title.c_str(), "text", tags, 1, nullptr);
+                storyboard_enqueue_note(my_board, note, nullptr);
+                note_destruct(note);
+            }
+
+            // After the flush this thread sees all of its own notes
+            storyboard_flush(my_board, nullptr);
+            std::string last = "thread" + std::to_string(thread) + "_" + std::to_string(NR_NOTES - 1);
+            EXPECT_EQ(storyboard_count_by_title(my_board, last.c_str(), nullptr), 1);
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), NR_THREADS * NR_NOTES);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "queued", &my_error), NR_THREADS * NR_NOTES);
+
+    // The notes of one producer are added in the order they were queued
+    std::vector<std::string> titles;
+    auto                     handler = [](void* client_data, const char* title, const char*, const char**, int32_t) {
+        ((std::vector<std::string>*)client_data)->push_back(title);
+    };
+
+    EXPECT_EQ(storyboard_search_by_text(my_board, "text", handler, &titles, &my_error), NR_THREADS * NR_NOTES);
+
+    std::map<std::string, int> last_index;
+    for (auto& title : titles)
+    {
+        std::string thread = title.substr(0, title.find('_'));
+        int         index  = std::stoi(title.substr(title.find('_') + 1));
+
+        EXPECT_EQ(last_index.count(thread) ? last_index[thread] + 1 : 0, index) << title;
+        last_index[thread] = index;
+    }
+
+    storyboard_enqueue_note(my_board, nullptr, &my_error);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    storyboard_destruct(my_board);
+}
+
+TEST(CAPI, destruct_applies_queued_notes)
+{
+    note_t  my_note  = note_construct("title", "text", nullptr, 0, nullptr);
+    board_t my_board = storyboard_construct(nullptr);
+
+    for (int index = 0; index < 100; index++)
+    {
+        storyboard_enqueue_note(my_board, my_note, nullptr);
+    }
+
+    // The queued notes are applied while the board is destroyed, with no flush
+    storyboard_destruct(my_board);
+    note_destruct(my_note);
+}
+
+// Collects the results of asynchronous searches
+struct AsyncResults
+{
+    std::mutex               mutex;
+    std::vector<std::string> titles;
+    int                      nr_completions = 0;
+    int                      nr_cancelled   = 0;
+
+    static void completion(void* user_data, storyboard_status status, const note_t* notes, int32_t nr_notes)
+    {
+        AsyncResults*               results = (AsyncResults*)user_data;
+        std::lock_guard<std::mutex> lock(results->mutex);
+
+        for (int32_t index = 0; index < nr_notes; index++)
+        {
+            results->titles.push_back(note_get_title(notes[index], nullptr));
+        }
+
+        results->nr_completions++;
+        results->nr_cancelled += (status == STORYBOARD_ERROR_CANCELLED);
+    }
+};
+
+TEST_F(QueryTestCAPI, search_async)
+{
+    AsyncResults results;
+    search_t     my_search =
+        storyboard_search_async(my_board, STORYBOARD_QUERY_BY_TAG, "t4", AsyncResults::completion, &results, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    ASSERT_NE(my_search, nullptr);
+
+    search_wait(my_search, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(results.nr_completions, 1);
+    EXPECT_EQ(results.titles, std::vector<std::string>{"title2"});
+
+    // The results have been delivered, so it is too late to cancel
+    EXPECT_EQ(search_cancel(my_search, &my_error), 0);
+    my_search = search_destruct(my_search);
+
+    EXPECT_EQ(storyboard_search_async(my_board, STORYBOARD_QUERY_BY_TAG, "t4", nullptr, nullptr, &my_error), nullptr);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    EXPECT_EQ(storyboard_search_async(my_board, 7, "t4", AsyncResults::completion, &results, &my_error), nullptr);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+}
+
+TEST_F(QueryTestCAPI, search_async_cancel)
+{
+    const int    NR_SEARCHES = 50;
+    AsyncResults results;
+    int          nr_cancelled = 0;
+
+    for (int index = 0; index < NR_SEARCHES; index++)
+    {
+        search_t my_search = storyboard_search_async(my_board, STORYBOARD_QUERY_BY_TEXT, "text",
+                                                     AsyncResults::completion, &results, &my_error);
+        nr_cancelled += search_cancel(my_search, &my_error);
+        search_destruct(my_search);
+    }
+
+    ASSERT_EQ(my_error, nullptr);
+
+    // The board waits for its searches, so all the completions have been called once it is gone
+    storyboard_destruct(my_board);
+    my_board = nullptr;
+
+    EXPECT_EQ(results.nr_completions, NR_SEARCHES);
+    EXPECT_EQ(results.nr_cancelled, nr_cancelled);
+    EXPECT_EQ(results.titles.size(), 2 * (NR_SEARCHES - nr_cancelled));
+}
+
+TEST(CAPI, block_filter)
+{
+    error_t_ my_error = nullptr;
+    board_t  my_board = storyboard_construct(&my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    const int NR_NOTES = 1000;
+
+    for (int index = 0; index < NR_NOTES; index++)
+    {
+        std::string title    = "note" + std::to_string(index);
+        std::string group    = "group" + std::to_string(index % 10);
+        const char* tags[2]  = {group.c_str(), "rare"};
+        note_t      note     = note_construct(title.c_str(), "text", tags, index == 500 ? 2 : 1, nullptr);
+        storyboard_add_note(my_board, note, nullptr);
+        note_destruct(note);
+    }
+
+    storyboard_set_block_filter(my_board, 64, 0.01, &my_error);
+    storyboard_enable_stats(my_board, 1, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    int32_t nr_visited = 0;
+    auto    handler    = [](void* client_data, const char*, const char*, const char**, int32_t) {
+        (*(int32_t*)client_data)++;
+    };
+
+    EXPECT_EQ(storyboard_search_by_tag(my_board, "rare", handler, &nr_visited, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_title(my_board, "note999", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_text(my_board, "text", &my_error), NR_NOTES);
+    ASSERT_EQ(my_error, nullptr);
+
+    typedef std::map<std::string, storyboard_op_stats> stats_t;
+    stats_t                                            stats;
+
+    auto callback = [](void* client_data, const storyboard_op_stats* op_stats) {
+        (*(stats_t*)client_data)[std::string(op_stats->operation)] = *op_stats;
+    };
+
+    // Tag and title queries only scan the blocks that may match, text queries scan everything
+    storyboard_get_stats(my_board, callback, &stats, &my_error);
+    EXPECT_LT(stats.at("storyboard_search_by_tag").notes_scanned, NR_NOTES / 4);
+    EXPECT_LT(stats.at("storyboard_count_by_title").notes_scanned, NR_NOTES / 4);
+    EXPECT_EQ(stats.at("storyboard_count_by_text").notes_scanned, NR_NOTES);
+
+    storyboard_memory_stats usage;
+    storyboard_memory_usage(my_board, &usage, &my_error);
+    EXPECT_GT(usage.filters, 0);
+
+    // Erasing notes moves the notes after them, the filters follow
+    EXPECT_EQ(storyboard_delete_by_title(my_board, "note0", &my_error), 1);
+    EXPECT_EQ(storyboard_delete_by_tag(my_board, "group5", &my_error), NR_NOTES / 10);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "rare", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_title(my_board, "note999", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_title(my_board, "note15", &my_error), 0);
+    EXPECT_EQ(storyboard_delete_by_tag(my_board, "rare", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "group0", &my_error), NR_NOTES / 10 - 2);
+    ASSERT_EQ(my_error, nullptr);
+
+    // So does compaction
+    storyboard_set_delete_mode(my_board, STORYBOARD_DELETE_TOMBSTONE, &my_error);
+    EXPECT_EQ(storyboard_delete_by_title(my_board, "note1", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_title(my_board, "note1", &my_error), 0);
+    EXPECT_EQ(storyboard_compact(my_board, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_title(my_board, "note998", &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_set_block_filter(my_board, 64, 0.0, &my_error);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+    storyboard_set_block_filter(my_board, -1, 0.01, &my_error);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+
+    storyboard_set_block_filter(my_board, 0, 0.0, &my_error);
+    storyboard_memory_usage(my_board, &usage, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+    EXPECT_EQ(usage.filters, 0);
+
+    storyboard_destruct(my_board);
+}
+
+TEST(CAPI, tag_postings)
+{
+    error_t_ my_error = nullptr;
+    board_t  my_board = storyboard_construct(&my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    // Enough notes for the postings to use every kind of container: sparse, dense and runs of consecutive notes
+    const int NR_NOTES = 10000;
+
+    for (int index = 0; index < NR_NOTES; index++)
+    {
+        std::vector<const char*> tags{"all", index % 2 ? "odd" : "even"};
+        std::string              title = "note" + std::to_string(index);
+
+        if ((index >= 2000) && (index < 7000))
+        {
+            tags.push_back("block");
+        }
+
+        if (index % 1000 == 0)
+        {
+            tags.push_back("sparse");
+        }
+
+        note_t note = note_construct(title.c_str(), "text", tags.data(), tags.size(), nullptr);
+        storyboard_add_note(my_board, note, nullptr);
+        note_destruct(note);
+    }
+
+    std::vector<std::string> titles;
+    auto                     handler = [](void* client_data, const char* title, const char*, const char**, int32_t) {
+        ((std::vector<std::string>*)client_data)->push_back(title);
+    };
+
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "all", &my_error), NR_NOTES);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "block", &my_error), 5000);
+    EXPECT_EQ(storyboard_search_by_tag(my_board, "sparse", handler, &titles, &my_error), 10);
+    EXPECT_EQ(titles.at(3), "note3000");
+    ASSERT_EQ(my_error, nullptr);
+
+    // Erasing notes moves the notes after them, which keep their ids in the postings
+    EXPECT_EQ(storyboard_delete_by_title(my_board, "note1", &my_error), 1);
+    EXPECT_EQ(storyboard_delete_by_tag(my_board, "block", &my_error), 5000);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "all", &my_error), NR_NOTES - 5001);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "odd", &my_error), NR_NOTES / 2 - 2501);
+
+    titles.clear();
+    EXPECT_EQ(storyboard_search_by_tag(my_board, "sparse", handler, &titles, &my_error), 5);
+    EXPECT_EQ(titles, (std::vector<std::string>{"note0", "note1000", "note7000", "note8000", "note9000"}));
+    ASSERT_EQ(my_error, nullptr);
+
+    // Tombstones leave the postings right away, compaction moves the remaining notes
+    storyboard_set_delete_mode(my_board, STORYBOARD_DELETE_TOMBSTONE, &my_error);
+    EXPECT_EQ(storyboard_delete_by_tag(my_board, "odd", &my_error), NR_NOTES / 2 - 2501);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "odd", &my_error), 0);
+    EXPECT_EQ(storyboard_compact(my_board, &my_error), NR_NOTES / 2 - 2501);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "all", &my_error), NR_NOTES / 2 - 2500);
+
+    titles.clear();
+    EXPECT_EQ(storyboard_search_by_tag(my_board, "sparse", handler, &titles, &my_error), 5);
+    EXPECT_EQ(titles.back(), "note9000");
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_destruct(my_board);
+}
+
+TEST(CAPI, search_by_tags)
+{
+    error_t_ my_error = nullptr;
+    board_t  my_board = storyboard_construct(&my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    const char* tags_a[] = {"red", "blue", "red"};
+    const char* tags_b[] = {"blue", "green"};
+    const char* tags_c[] = {"green"};
+    note_t      notes[]  = {note_construct("a", "text", tags_a, 3, nullptr),
+                            note_construct("b", "text", tags_b, 2, nullptr),
+                            note_construct("c", "text", tags_c, 1, nullptr)};
+
+    for (auto note : notes)
+    {
+        storyboard_add_note(my_board, note, &my_error);
+    }
+
+    // The stored tags are sorted and deduplicated
+    std::vector<std::string> tags;
+    auto                     handler = [](void* client_data, const char*, const char*, const char** tags, int32_t nr) {
+        ((std::vector<std::string>*)client_data)->assign(tags, tags + nr);
+    };
+    EXPECT_EQ(storyboard_search_by_title(my_board, "a", handler, &tags, &my_error), 1);
+    EXPECT_EQ(tags, (std::vector<std::string>{"blue", "red"}));
+
+    const char* query[] = {"green", "blue", "green"};
+    EXPECT_EQ(storyboard_count_by_tags(my_board, query, 3, STORYBOARD_TAG_MATCH_ANY, &my_error), 3);
+    EXPECT_EQ(storyboard_count_by_tags(my_board, query, 3, STORYBOARD_TAG_MATCH_ALL, &my_error), 1);
+    EXPECT_EQ(storyboard_search_by_tags(my_board, query, 3, STORYBOARD_TAG_MATCH_ALL, handler, &tags, &my_error), 1);
+    EXPECT_EQ(tags, (std::vector<std::string>{"blue", "green"}));
+    ASSERT_EQ(my_error, nullptr);
+
+    // A tag that no note carries makes an all-of query match nothing
+    const char* unknown[] = {"blue", "no such tag"};
+    EXPECT_EQ(storyboard_count_by_tags(my_board, unknown, 2, STORYBOARD_TAG_MATCH_ANY, &my_error), 2);
+    EXPECT_EQ(storyboard_count_by_tags(my_board, unknown, 2, STORYBOARD_TAG_MATCH_ALL, &my_error), 0);
+    EXPECT_EQ(storyboard_count_by_tags(my_board, nullptr, 0, STORYBOARD_TAG_MATCH_ANY, &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+
+    // Deleting by note matches the stored note whatever the order of its tags
+    const char* reordered[] = {"red", "red", "blue"};
+    note_t      delete_me   = note_construct("a", "text", reordered, 3, nullptr);
+    EXPECT_EQ(storyboard_delete_note(my_board, delete_me, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "red", &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(storyboard_count_by_tags(my_board, nullptr, 1, STORYBOARD_TAG_MATCH_ANY, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    EXPECT_EQ(storyboard_count_by_tags(my_board, query, 3, 7, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+
+    EXPECT_EQ(storyboard_search_by_tags(my_board, query, 3, -1, handler, &tags, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    note_destruct(delete_me);
+    for (auto note : notes)
+    {
+        note_destruct(note);
+    }
+    storyboard_destruct(my_board);
+}
+
+TEST(CAPI, reject_duplicates)
+{
+    error_t_ my_error = nullptr;
+    board_t  my_board = storyboard_construct_sharded(4, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    const char* tags[]      = {"a", "b"};
+    const char* reordered[] = {"b", "a", "b"};
+    std::string long_text(5000, 'x');
+    note_t      original   = note_construct("title", long_text.c_str(), tags, 2, nullptr);
+    note_t      same       = note_construct("title", long_text.c_str(), reordered, 3, nullptr);
+    note_t      other_text = note_construct("title", (long_text + "y").c_str(), tags, 2, nullptr);
+
+    // Duplicates are accepted by default
+    EXPECT_EQ(storyboard_add_note_checked(my_board, original, &my_error), 1);
+    EXPECT_EQ(storyboard_add_note_checked(my_board, same, &my_error), 1);
+
+    storyboard_set_reject_duplicates(my_board, 1, &my_error);
+    EXPECT_EQ(storyboard_add_note_checked(my_board, original, &my_error), 0);
+    EXPECT_EQ(storyboard_add_note_checked(my_board, other_text, &my_error), 1);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 3);
+    ASSERT_EQ(my_error, nullptr);
+
+    // The rejection is not an error
+    storyboard_add_note(my_board, original, &my_error);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 3);
+    ASSERT_EQ(my_error, nullptr);
+
+    // Queued duplicates are dropped when the queue is applied
+    storyboard_enqueue_note(my_board, same, &my_error);
+    storyboard_flush(my_board, &my_error);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 3);
+
+    // Both copies are deleted, the note with a different text is not
+    EXPECT_EQ(storyboard_delete_note(my_board, same, &my_error), 2);
+    EXPECT_EQ(storyboard_delete_note(my_board, same, &my_error), 0);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 1);
+    EXPECT_EQ(storyboard_add_note_checked(my_board, original, &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    note_destruct(original);
+    note_destruct(same);
+    note_destruct(other_text);
+    storyboard_destruct(my_board);
+}
+
+struct LengthRecord
+{
+    std::vector<std::string> titles;
+    std::vector<std::string> texts;
+    std::vector<std::string> tags;
+};
+
+TEST(CAPI, length_delimited_strings)
+{
+    error_t_ my_error = nullptr;
+    board_t  my_board = storyboard_construct_sharded(2, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    // The strings are slices of one buffer, and the text contains a NUL
+    const char    buffer[]      = "title1title2text\0moretagA";
+    const char*   tags[]        = {buffer + 21, buffer + 21};
+    const int32_t tag_lengths[] = {4, 3};
+    note_t        first         = note_construct_n(buffer, 6, buffer + 12, 9, tags, tag_lengths, 2, &my_error);
+    note_t        second        = note_construct_n(buffer + 6, 6, nullptr, 0, nullptr, nullptr, 0, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    int32_t     length = 0;
+    const char* text   = note_get_text_n(first, &length, &my_error);
+    EXPECT_EQ(std::string(text, length), std::string("text\0more", 9));
+    EXPECT_STREQ(note_get_title(second, &my_error), "title2");
+
+    EXPECT_EQ(storyboard_add_note_checked(my_board, first, &my_error), 1);
+    EXPECT_EQ(storyboard_add_note_checked(my_board, second, &my_error), 1);
+
+    LengthRecord record;
+
+    auto handler = [](void* client_data, const char* title, int32_t title_length, const char* text,
+                      int32_t text_length, const char* const* tags, const int32_t* tag_lengths, int32_t nr_tags) {
+        LengthRecord* record = static_cast<LengthRecord*>(client_data);
+        record->titles.push_back(std::string(title, title_length));
+        record->texts.push_back(std::string(text, text_length));
+
+        for (int32_t index = 0; index < nr_tags; index++)
+        {
+            record->tags.push_back(std::string(tags[index], tag_lengths[index]));
+        }
+    };
+
+    EXPECT_EQ(storyboard_search_by_title_n(my_board, buffer, 6, handler, &record, &my_error), 1);
+    ASSERT_EQ(record.titles.size(), 1);
+    EXPECT_EQ(record.titles.at(0), "title1");
+    EXPECT_EQ(record.texts.at(0), std::string("text\0more", 9));
+    EXPECT_EQ(record.tags, (std::vector<std::string>{"tag", "tagA"}));
+
+    // Matching does not stop at the NUL
+    EXPECT_EQ(storyboard_count_by_text_n(my_board, buffer + 15, 4, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_text_n(my_board, buffer + 15, 0, &my_error), 2);
+    EXPECT_EQ(storyboard_count_by_tag_n(my_board, buffer + 21, 3, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_tags_n(my_board, tags, tag_lengths, 2, STORYBOARD_TAG_MATCH_ALL, &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_title_n(my_board, nullptr, 0, &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(storyboard_count_by_title_n(my_board, buffer, -1, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    EXPECT_EQ(note_construct_n(nullptr, 3, nullptr, 0, nullptr, nullptr, 0, &my_error), nullptr);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+
+    // A tag may be NULL only if it is empty
+    const char*   bad_tags[]        = {buffer + 21, nullptr};
+    const int32_t negative_length[] = {4, -1};
+    const int32_t missing_tag[]     = {4, 3};
+    EXPECT_EQ(note_construct_n(buffer, 6, nullptr, 0, tags, negative_length, 2, &my_error), nullptr);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    EXPECT_EQ(note_construct_n(buffer, 6, nullptr, 0, bad_tags, missing_tag, 2, &my_error), nullptr);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    EXPECT_EQ(storyboard_count_by_tags_n(my_board, bad_tags, missing_tag, 2, STORYBOARD_TAG_MATCH_ANY, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    EXPECT_EQ(storyboard_delete_by_text_n(my_board, buffer + 12, 5, &my_error), 1);
+    EXPECT_EQ(storyboard_delete_by_title_n(my_board, buffer + 6, 6, &my_error), 1);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), 0);
+    ASSERT_EQ(my_error, nullptr);
+
+    note_destruct(first);
+    note_destruct(second);
+    storyboard_destruct(my_board);
+}
+
+struct DiffRecord
+{
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+};
+
+TEST(CAPI, merge_and_diff)
+{
+    error_t_ my_error = nullptr;
+    board_t  before   = storyboard_construct_sharded(3, &my_error);
+    board_t  after    = storyboard_construct_sharded(2, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    const char* tags[]      = {"a", "b"};
+    const char* reordered[] = {"b", "a"};
+    note_t      first       = note_construct("first", "text", tags, 2, nullptr);
+    note_t      same        = note_construct("first", "text", reordered, 2, nullptr);
+    note_t      second      = note_construct("second", "text", nullptr, 0, nullptr);
+    note_t      third       = note_construct("third", "text", nullptr, 0, nullptr);
+
+    storyboard_add_note(before, first, &my_error);
+    storyboard_add_note(before, second, &my_error);
+    storyboard_add_note(after, same, &my_error);
+    storyboard_add_note(after, same, &my_error);
+    storyboard_add_note(after, third, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    // The boards are compared as multisets, so the second copy of the first note is added
+    DiffRecord record;
+
+    auto handler = [](void* client_data, storyboard_diff_kind kind, const char* title, int32_t title_length,
+                      const char*, int32_t, const char* const*, const int32_t*, int32_t) {
+        DiffRecord* record = static_cast<DiffRecord*>(client_data);
+        (kind == STORYBOARD_DIFF_ADDED ? record->added : record->removed).push_back(std::string(title, title_length));
+    };
+
+    EXPECT_EQ(storyboard_diff(before, after, handler, &record, &my_error), 3);
+    std::sort(record.added.begin(), record.added.end());
+    EXPECT_EQ(record.added, (std::vector<std::string>{"first", "third"}));
+    EXPECT_EQ(record.removed, (std::vector<std::string>{"second"}));
+    EXPECT_EQ(storyboard_diff(after, after, handler, &record, &my_error), 0);
+
+    // Boards with different numbers of shards are merged note by note
+    EXPECT_EQ(storyboard_merge(before, after, STORYBOARD_MERGE_SKIP_DUPLICATES, &my_error), 1);
+    EXPECT_EQ(storyboard_get_nr_notes(before, &my_error), 3);
+    EXPECT_EQ(storyboard_merge(before, after, STORYBOARD_MERGE_KEEP_ALL, &my_error), 3);
+    EXPECT_EQ(storyboard_merge(before, before, STORYBOARD_MERGE_KEEP_ALL, &my_error), 6);
+    EXPECT_EQ(storyboard_count_by_title(before, "first", &my_error), 6);
+    ASSERT_EQ(my_error, nullptr);
+
+    // Boards with the same number of shards are merged shard by shard
+    board_t copy = storyboard_construct_sharded(3, &my_error);
+    EXPECT_EQ(storyboard_merge(copy, before, STORYBOARD_MERGE_SKIP_DUPLICATES, &my_error), 3);
+    EXPECT_EQ(storyboard_merge(copy, before, STORYBOARD_MERGE_SKIP_DUPLICATES, &my_error), 0);
+    EXPECT_EQ(storyboard_count_by_tag(copy, "b", &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(storyboard_merge(copy, nullptr, STORYBOARD_MERGE_KEEP_ALL, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    my_error = error_destruct(my_error);
+
+    EXPECT_EQ(storyboard_merge(copy, before, 2, &my_error), 0);
+    ASSERT_NE(my_error, nullptr);
+    EXPECT_EQ(error_get_code(my_error), STORYBOARD_ERROR_INVALID_ARGUMENT);
+    my_error = error_destruct(my_error);
+
+    note_destruct(first);
+    note_destruct(same);
+    note_destruct(second);
+    note_destruct(third);
+    storyboard_destruct(copy);
+    storyboard_destruct(before);
+    storyboard_destruct(after);
+}
+
+// Boilerplate around a few words that differ between the notes
+std::string templatedText(int index)
+{
+    std::string text;
+
+    for (int paragraph = 0; paragraph < 8; paragraph++)
+    {
+        text += "Dear customer, thank you for your order number " + std::to_string(index * 8 + paragraph) +
+                ". The items will be shipped within " + std::to_string(paragraph + 2) + " days. ";
+    }
+
+    return text;
+}
+
+TEST(CAPI, text_compression)
+{
+    error_t_ my_error = nullptr;
+    board_t  my_board = storyboard_construct_sharded(2, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    const int   nr_notes = 400;
+    const char* tags[]   = {"order"};
+
+    for (int index = 0; index < nr_notes; index++)
+    {
+        std::string title = "title" + std::to_string(index);
+        note_t      note  = note_construct(title.c_str(), templatedText(index).c_str(), tags, 1, nullptr);
+        storyboard_add_note(my_board, note, &my_error);
+        note_destruct(note);
+    }
+
+    storyboard_memory_stats before;
+    storyboard_memory_usage(my_board, &before, &my_error);
+    EXPECT_EQ(before.dictionary, 0);
+
+    storyboard_set_text_compression(my_board, 1, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_memory_stats after;
+    storyboard_memory_usage(my_board, &after, &my_error);
+    EXPECT_GT(after.dictionary, 0);
+    EXPECT_LT(after.texts * 3, before.texts);
+    EXPECT_EQ(after.titles, before.titles);
+
+    // Texts are decompressed for text queries and for the results
+    std::string text;
+
+    auto handler = [](void* client_data, const char*, const char* text, const char**, int32_t) {
+        *static_cast<std::string*>(client_data) = text;
+    };
+
+    EXPECT_EQ(storyboard_search_by_title(my_board, "title123", handler, &text, &my_error), 1);
+    EXPECT_EQ(text, templatedText(123));
+    EXPECT_EQ(storyboard_count_by_text(my_board, "order number 1000.", &my_error), 1);
+
+    // The text passed to a handler stays valid while the handler decompresses more blocks than a thread caches. The
+    // boards are not sharded, so that they decompress on the calling thread.
+    board_t single = storyboard_construct(&my_error);
+
+    for (int index = 0; index < 4 * nr_notes; index++)
+    {
+        std::string title = "title" + std::to_string(index);
+        note_t      note  = note_construct(title.c_str(), templatedText(index).c_str(), tags, 1, nullptr);
+        storyboard_add_note(single, note, &my_error);
+        note_destruct(note);
+    }
+
+    storyboard_set_text_compression(single, 1, &my_error);
+    std::pair<board_t, std::string> scan{storyboard_copy(single, &my_error), ""};
+
+    auto scanning_handler = [](void* client_data, const char*, const char* text, const char**, int32_t) {
+        auto* scan = static_cast<std::pair<board_t, std::string>*>(client_data);
+        EXPECT_EQ(storyboard_count_by_text(scan->first, "no such text", nullptr), 0);
+        scan->second = text;
+    };
+
+    EXPECT_EQ(storyboard_search_by_title(single, "title124", scanning_handler, &scan, &my_error), 1);
+    EXPECT_EQ(scan.second, templatedText(124));
+    ASSERT_EQ(my_error, nullptr);
+    storyboard_destruct(scan.first);
+    storyboard_destruct(single);
+    EXPECT_EQ(storyboard_count_by_text(my_board, "within 9 days", &my_error), nr_notes);
+    EXPECT_EQ(storyboard_count_by_tag(my_board, "order", &my_error), nr_notes);
+    ASSERT_EQ(my_error, nullptr);
+
+    // Notes added later are compressed once they fill a block, the others are still found
+    note_t later = note_construct("later", templatedText(nr_notes).c_str(), tags, 1, nullptr);
+    storyboard_add_note(my_board, later, &my_error);
+    EXPECT_EQ(storyboard_delete_note(my_board, later, &my_error), 1);
+    EXPECT_EQ(storyboard_delete_by_text(my_board, "order number 8.", &my_error), 1);
+    EXPECT_EQ(storyboard_get_nr_notes(my_board, &my_error), nr_notes - 1);
+
+    storyboard_set_text_compression(my_board, 0, &my_error);
+    storyboard_memory_usage(my_board, &after, &my_error);
+    EXPECT_EQ(after.dictionary, 0);
+    EXPECT_EQ(after.texts, before.texts - templatedText(1).size());
+    EXPECT_EQ(storyboard_search_by_title(my_board, "title321", handler, &text, &my_error), 1);
+    EXPECT_EQ(text, templatedText(321));
+    ASSERT_EQ(my_error, nullptr);
+
+    note_destruct(later);
+    storyboard_destruct(my_board);
+}
+
+TEST(CAPI, memory_budget)
+{
+    error_t_ my_error = nullptr;
+    board_t  my_board = storyboard_construct_sharded(2, &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_set_memory_budget(my_board, 100000, "no-such-directory", &my_error);
+    EXPECT_NE(my_error, nullptr);
+    EXPECT_EQ(storyboard_last_error_code(), STORYBOARD_ERROR_INTERNAL);
+    my_error = error_destruct(my_error);
+
+    storyboard_set_memory_budget(my_board, 100000, ".", &my_error);
+    ASSERT_EQ(my_error, nullptr);
+
+    const int   nr_notes = 400;
+    const char* tags[]   = {"order"};
+
+    for (int index = 0; index < nr_notes; index++)
+    {
+        std::string title = "title" + std::to_string(index);
+        note_t      note  = note_construct(title.c_str(), templatedText(index).c_str(), tags, 1, nullptr);
+        storyboard_add_note(my_board, note, &my_error);
+        note_destruct(note);
+    }
+
+    // Most texts are on disk, the titles are not
+    storyboard_memory_stats usage;
+    storyboard_memory_usage(my_board, &usage, &my_error);
+    EXPECT_GT(usage.spilled, templatedText(0).size() * nr_notes / 2);
+    EXPECT_LT(usage.texts, templatedText(0).size() * nr_notes / 2);
+    EXPECT_GT(usage.titles, 0);
+
+    std::string text;
+
+    auto handler = [](void* client_data, const char*, const char* text, const char**, int32_t) {
+        *static_cast<std::string*>(client_data) = text;
+    };
+
+    EXPECT_EQ(storyboard_search_by_title(my_board, "title12", handler, &text, &my_error), 1);
+    EXPECT_EQ(text, templatedText(12));
+    EXPECT_EQ(storyboard_count_by_text(my_board, "order number 1000.", &my_error), 1);
+    EXPECT_EQ(storyboard_count_by_text(my_board, "within 9 days", &my_error), nr_notes);
+    EXPECT_EQ(storyboard_delete_by_text(my_board, "order number 8.", &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    // Removing the budget reads the texts back
+    storyboard_set_memory_budget(my_board, 0, nullptr, &my_error);
+    storyboard_memory_usage(my_board, &usage, &my_error);
+    EXPECT_EQ(usage.spilled, 0);
+    EXPECT_GT(usage.texts, templatedText(0).size() * (nr_notes - 1));
+    EXPECT_EQ(storyboard_search_by_title(my_board, "title321", handler, &text, &my_error), 1);
+    EXPECT_EQ(text, templatedText(321));
+    ASSERT_EQ(my_error, nullptr);
+
+    storyboard_destruct(my_board);
+}
+
+struct TraceRecord
+{
+    std::vector<std::string> begun;
+    std::vector<std::string> ended;
+    std::vector<int64_t>     results;
+    std::vector<uint64_t>    scanned;
+    board_t                  board = nullptr;
+};
+
+TEST_F(QueryTestCAPI, trace_hooks)
+{
+    TraceRecord record;
+
+    auto begin_cb = [](void* user_data, const char* operation, const board_t board) -> void* {
+        TraceRecord* trace = (TraceRecord*)user_data;
+        trace->begun.push_back(operation);
+        trace->board = board;
+        return trace;
+    };
+
+    auto end_cb = [](void* user_data, void* span, const char* operation, const board_t board, int64_t nr_results,
+                     uint64_t notes_scanned) {
+        TraceRecord* trace = (TraceRecord*)user_data;
+        EXPECT_EQ(span, user_data);
+        EXPECT_EQ(board, trace->board);
+        trace->ended.push_back(operation);
+        trace->results.push_back(nr_results);
+        trace->scanned.push_back(notes_scanned);
+    };
+
+    storyboard_set_trace_hooks(begin_cb, end_cb, &record);
+
+    EXPECT_EQ(storyboard_count_by_text(my_board, "hello", &my_error), 1);
+    EXPECT_EQ(record.board, my_board);
+    EXPECT_STREQ(note_get_title(my_note1, &my_error), "title1");
+    EXPECT_EQ(record.board, nullptr);
+
+    storyboard_set_trace_hooks(nullptr, nullptr, nullptr);
+    EXPECT_EQ(storyboard_count_by_text(my_board, "hello", &my_error), 1);
+    ASSERT_EQ(my_error, nullptr);
+
+    EXPECT_EQ(record.begun, (std::vector<std::string>{"storyboard_count_by_text", "note_get_title"}));
+    EXPECT_EQ(record.ended, record.begun);
+    EXPECT_EQ(record.results, (std::vector<int64_t>{1, 0}));
+    EXPECT_EQ(record.scanned, (std::vector<uint64_t>{2, 0}));
+}
+
 int main(int argc, char* argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <string>
 #include <vector>
 
+#include "storyboard/query.hpp"
 #include "storyboard/storyboardCppAPI.hpp"
 
 class QueryTestCppAPI : public ::testing::Test
@@ -46,6 +48,25 @@ TEST(CppAPI, exceptions_note)
     EXPECT_THROW(temp = my_note.getText(), std::runtime_error);
 }
 
+TEST(CppAPI, note_tags_view)
+{
+    Note my_note("note1", "text", {"tag1", "longer tag"});
+
+    TagsView tags = my_note.getTagsView();
+    EXPECT_EQ(tags.size(), 2);
+    EXPECT_EQ(tags[0], "tag1");
+    EXPECT_EQ(tags[1].size(), 10);
+    EXPECT_EQ(tags.at(1).str(), "longer tag");
+    EXPECT_THROW(tags.at(2), std::out_of_range);
+
+    tag_cont_t copied;
+    for (StringRef tag : tags)
+    {
+        copied.push_back(tag.str());
+    }
+    EXPECT_EQ(copied, my_note.getTags());
+}
+
 TEST(CppAPI, construct_and_destruct_board)
 {
     Note my_note("note1", "text", {"tag1", "tag2"});
@@ -182,6 +203,378 @@ TEST_F(QueryTestCppAPI, board_search_by_tag)
     EXPECT_EQ(nr_results, 0);
 }
 
+TEST_F(QueryTestCppAPI, board_query_cache)
+{
+    note_cont_t query_result;
+
+    EXPECT_NO_THROW(my_board.setQueryCacheCapacity(8));
+    EXPECT_EQ(my_board.searchByTitle("title2", query_result), 1);
+    EXPECT_EQ(my_board.searchByTitle("title2", query_result), 1);
+    EXPECT_EQ(query_result.at(1).getText(), "text hei hello hola");
+
+    storyboard_cache_stats stats = my_board.getQueryCacheStats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 1);
+
+    // Deleting a note invalidates the cached result
+    EXPECT_EQ(my_board.deleteNote(note2), 1);
+    EXPECT_EQ(my_board.searchByTitle("title2", query_result), 0);
+
+    EXPECT_THROW(my_board.setQueryCacheCapacity(-1), std::runtime_error);
+}
+
+TEST_F(QueryTestCppAPI, board_count)
+{
+    EXPECT_EQ(my_board.countByTitle("title2"), 1);
+    EXPECT_EQ(my_board.countByText("hello"), 1);
+    EXPECT_EQ(my_board.countByTag("tag1"), 2);
+    EXPECT_EQ(my_board.countByTag("tag"), 0);
+}
+
+TEST_F(QueryTestCppAPI, board_tag_stats)
+{
+    tag_stats_cont_t stats = my_board.getTagStats();
+    std::sort(stats.begin(), stats.end());
+    EXPECT_EQ(stats, (tag_stats_cont_t{{"tag1", 2}, {"tag2", 1}, {"tag3", 1}, {"tag4", 1}, {"tag5", 1}}));
+
+    stats = my_board.getTagFacets(STORYBOARD_QUERY_BY_TITLE, "title1");
+    std::sort(stats.begin(), stats.end());
+    EXPECT_EQ(stats, (tag_stats_cont_t{{"tag1", 1}, {"tag2", 1}, {"tag3", 1}}));
+}
+
+TEST_F(QueryTestCppAPI, board_search_views)
+{
+    std::vector<std::string> titles;
+
+    int nr_results = 0;
+    EXPECT_NO_THROW(nr_results = my_board.searchByTag("tag1", [&titles](const NoteView& view) {
+        titles.push_back(view.getTitle().str());
+        EXPECT_EQ(view.getTags().size(), 3);
+        EXPECT_EQ(view.getTags()[0], "tag1");
+    }));
+    EXPECT_EQ(nr_results, 2);
+    EXPECT_EQ(titles, (std::vector<std::string>{"title1", "title2"}));
+
+    // Views can be materialized into notes that outlive the callback
+    note_cont_t notes;
+    EXPECT_NO_THROW(nr_results = my_board.searchByText("hello", [&notes](const NoteView& view) {
+        EXPECT_EQ(view.getText(), "text hei hello hola");
+        notes.push_back(view.toNote());
+    }));
+    EXPECT_EQ(nr_results, 1);
+    EXPECT_EQ(notes.at(0).getTitle(), "title2");
+    EXPECT_EQ(notes.at(0).getTags().at(2), "tag5");
+
+    nr_results = my_board.searchByTitle("title3", [](const NoteView&) { FAIL(); });
+    EXPECT_EQ(nr_results, 0);
+}
+
+TEST_F(QueryTestCppAPI, board_memory_usage)
+{
+    storyboard_memory_stats before = my_board.getMemoryUsage();
+
+    my_board.addNote(Note("title3", "some text", {"tag6"}));
+
+    storyboard_memory_stats after = my_board.getMemoryUsage();
+    EXPECT_EQ(after.titles - before.titles, 6);
+    EXPECT_EQ(after.texts - before.texts, 9);
+    EXPECT_GT(after.tags - before.tags, 4);
+    EXPECT_GT(after.tag_index, before.tag_index);
+
+    // The entry of a tag in the table of tags has the same size whatever the tag
+    my_board.addNote(Note("title4", "some text", {"tag77"}));
+
+    storyboard_memory_stats last = my_board.getMemoryUsage();
+    EXPECT_EQ((last.tags - after.tags) - (after.tags - before.tags), 1);
+}
+
+TEST_F(QueryTestCppAPI, board_delete_by)
+{
+    EXPECT_EQ(my_board.deleteByTitle("title3"), 0);
+    EXPECT_EQ(my_board.deleteByTag("tag1"), 2);
+    EXPECT_EQ(my_board.length(), 0);
+    EXPECT_EQ(my_board.deleteByText("text"), 0);
+}
+
+TEST_F(QueryTestCppAPI, board_tombstones)
+{
+    note_cont_t query_result;
+
+    my_board.setDeleteMode(STORYBOARD_DELETE_TOMBSTONE);
+    EXPECT_EQ(my_board.deleteNote(note2), 1);
+    EXPECT_EQ(my_board.length(), 1);
+    EXPECT_EQ(my_board.searchByTag("tag1", query_result), 1);
+    EXPECT_EQ(query_result.at(0).getTitle(), "title1");
+
+    EXPECT_EQ(my_board.compact(), 1);
+    EXPECT_EQ(my_board.length(), 1);
+    EXPECT_EQ(my_board.getMemoryUsage().tombstones, 0);
+
+    EXPECT_THROW(my_board.setAutoCompaction(-1.0), std::runtime_error);
+}
+
+TEST(CppAPI, sharded_board)
+{
+    StoryBoard  my_board(3);
+    note_cont_t query_result;
+
+    for (int index = 0; index < 30; index++)
+    {
+        my_board.addNote(Note("title" + std::to_string(index), index % 2 ? "odd" : "even", {"tag"}));
+    }
+
+    EXPECT_EQ(my_board.length(), 30);
+    EXPECT_EQ(my_board.searchByText("odd", query_result), 15);
+    EXPECT_EQ(query_result.size(), 15);
+    EXPECT_EQ(my_board.searchByTitle("title7", query_result), 1);
+    EXPECT_EQ(query_result.back().getText(), "odd");
+    EXPECT_EQ(my_board.getTagStats(), (tag_stats_cont_t{{"tag", 30}}));
+
+    EXPECT_THROW(StoryBoard(0), std::runtime_error);
+}
+
+TEST(CppAPI, block_filter)
+{
+    StoryBoard  my_board(2);
+    note_cont_t query_result;
+
+    my_board.setBlockFilter(8, 0.05);
+
+    for (int index = 0; index < 100; index++)
+    {
+        my_board.addNote(Note("title" + std::to_string(index), "text", {"tag" + std::to_string(index % 7)}));
+    }
+
+    EXPECT_EQ(my_board.searchByTag("tag3", query_result), 14);
+    EXPECT_EQ(my_board.searchByTitle("title42", query_result), 1);
+    EXPECT_EQ(query_result.back().getTags().at(0), "tag0");
+    EXPECT_GT(my_board.getMemoryUsage().filters, 0);
+
+    my_board.deleteNote(Note("title42", "text", {"tag0"}));
+    EXPECT_EQ(my_board.countByTitle("title42"), 0);
+    EXPECT_EQ(my_board.countByTitle("title43"), 1);
+
+    EXPECT_THROW(my_board.setBlockFilter(8, 1.0), std::runtime_error);
+}
+
+TEST(CppAPI, search_by_tags)
+{
+    StoryBoard my_board;
+
+    for (int index = 0; index < 60; index++)
+    {
+        tag_cont_t tags{"all"};
+
+        if (index % 2 == 0)
+        {
+            tags.push_back("two");
+        }
+
+        if (index % 3 == 0)
+        {
+            tags.push_back("three");
+        }
+
+        my_board.addNote(Note("title" + std::to_string(index), "text", tags));
+    }
+
+    note_cont_t query_result;
+    EXPECT_EQ(my_board.searchByTags({"three", "two"}, STORYBOARD_TAG_MATCH_ALL, query_result), 10);
+    EXPECT_EQ(query_result.at(1).getTitle(), "title6");
+    EXPECT_EQ(query_result.at(1).getTags(), (tag_cont_t{"all", "three", "two"}));
+
+    EXPECT_EQ(my_board.countByTags({"two", "three"}, STORYBOARD_TAG_MATCH_ANY), 40);
+    EXPECT_EQ(my_board.countByTags({"two", "three", "all"}, STORYBOARD_TAG_MATCH_ALL), 10);
+    EXPECT_EQ(my_board.countByTags({"two", "unknown"}, STORYBOARD_TAG_MATCH_ALL), 0);
+}
+
+TEST(CppAPI, reject_duplicates)
+{
+    StoryBoard my_board;
+    my_board.setRejectDuplicates(true);
+
+    EXPECT_TRUE(my_board.addNote(Note("title", "text", {"x", "y"})));
+    EXPECT_FALSE(my_board.addNote(Note("title", "text", {"y", "x"})));
+    EXPECT_TRUE(my_board.addNote(Note("title", "text", {"y"})));
+    EXPECT_EQ(my_board.deleteNote(Note("title", "text", {"y", "x", "x"})), 1);
+    EXPECT_EQ(my_board.length(), 1);
+}
+
+TEST(CppAPI, length_delimited_strings)
+{
+    StoryBoard  my_board;
+    std::string text("before\0after", 12);
+
+    my_board.addNote(Note("title", text, {"tag"}));
+    EXPECT_EQ(my_board.countByText(std::string("e\0a", 3)), 1);
+
+    // Queries can be slices of a larger string
+    std::string buffer     = "xtitley";
+    int         nr_results = my_board.searchByTitle(StringRef(buffer.data() + 1, 5), [&text](const NoteView& view) {
+        EXPECT_EQ(view.getText(), StringRef(text));
+        EXPECT_EQ(view.toNote().getText(), text);
+    });
+    EXPECT_EQ(nr_results, 1);
+    EXPECT_EQ(my_board.deleteByTag(StringRef("tags", 3)), 1);
+}
+
+TEST(CppAPI, merge_and_diff)
+{
+    StoryBoard before;
+    StoryBoard after(2);
+
+    before.addNote(Note("title", "old", {"tag"}));
+    before.addNote(Note("title", "kept", {"tag"}));
+    after.addNote(Note("title", "kept", {"tag"}));
+    after.addNote(Note("title", "new", {"tag"}));
+
+    std::vector<std::pair<storyboard_diff_kind, std::string>> changes;
+
+    auto record = [&changes](storyboard_diff_kind kind, const NoteView& view) {
+        changes.emplace_back(kind, view.getText().str());
+    };
+
+    EXPECT_EQ(before.diff(after, record), 2);
+    ASSERT_EQ(changes.size(), 2);
+    EXPECT_EQ(changes[0], std::make_pair(STORYBOARD_DIFF_ADDED, std::string("new")));
+    EXPECT_EQ(changes[1], std::make_pair(STORYBOARD_DIFF_REMOVED, std::string("old")));
+
+    EXPECT_EQ(before.merge(after, STORYBOARD_MERGE_SKIP_DUPLICATES), 1);
+    EXPECT_EQ(before.merge(after), 2);
+    EXPECT_EQ(before.countByTitle("title"), 5);
+}
+
+TEST(CppAPI, text_compression)
+{
+    StoryBoard  my_board;
+    std::string boilerplate;
+
+    for (int line = 0; line < 20; line++)
+    {
+        boilerplate += "This message was sent to you because you are subscribed to the release notes. ";
+    }
+
+    my_board.setTextCompression(true);
+
+    for (int index = 0; index < 300; index++)
+    {
+        my_board.addNote(Note("title" + std::to_string(index), boilerplate + std::to_string(index), {"tag"}));
+    }
+
+    EXPECT_GT(my_board.getMemoryUsage().dictionary, 0);
+    EXPECT_LT(my_board.getMemoryUsage().texts * 5, boilerplate.size() * 300);
+
+    note_cont_t query_result;
+    EXPECT_EQ(my_board.searchByText(boilerplate + "42", query_result), 1);
+    ASSERT_EQ(query_result.size(), 1);
+    EXPECT_EQ(query_result.front().getTitle(), "title42");
+    EXPECT_EQ(query_result.front().getText(), boilerplate + "42");
+}
+
+TEST(CppAPI, memory_budget)
+{
+    StoryBoard my_board;
+    my_board.setTextCompression(true);
+    my_board.setMemoryBudget(64 * 1024, ".");
+
+    for (int index = 0; index < 2000; index++)
+    {
+        std::string text = "text number " + std::to_string(index) + std::string(200, '.');
+        my_board.addNote(Note("title" + std::to_string(index), text, {"tag"}));
+    }
+
+    storyboard_memory_stats usage = my_board.getMemoryUsage();
+    EXPECT_GT(usage.spilled, 0);
+    EXPECT_LT(usage.texts, usage.spilled);
+
+    note_cont_t query_result;
+    EXPECT_EQ(my_board.searchByText("text number 7.", query_result), 1);
+    ASSERT_EQ(query_result.size(), 1);
+    EXPECT_EQ(query_result.front().getTitle(), "title7");
+    EXPECT_EQ(my_board.countByTag("tag"), 2000);
+    EXPECT_THROW(my_board.setMemoryBudget(64 * 1024, "no-such-directory"), std::exception);
+}
+
+TEST(CppAPI, enqueue_and_flush)
+{
+    StoryBoard my_board;
+
+    for (int index = 0; index < 50; index++)
+    {
+        my_board.enqueueNote(Note("title" + std::to_string(index), "text", {"tag"}));
+    }
+
+    my_board.flush();
+    EXPECT_EQ(my_board.length(), 50);
+    EXPECT_EQ(my_board.getTagStats(), (tag_stats_cont_t{{"tag", 50}}));
+}
+
+TEST_F(QueryTestCppAPI, search_async)
+{
+    std::string       title;
+    storyboard_status result_status = STORYBOARD_ERROR_INTERNAL;
+
+    SearchHandle my_search =
+        my_board.searchAsync(STORYBOARD_QUERY_BY_TEXT, "hola", [&](storyboard_status status, note_cont_t&& notes) {
+            result_status = status;
+            title         = notes.size() == 1 ? notes.front().getTitle() : "";
+        });
+
+    my_search.wait();
+    EXPECT_EQ(result_status, STORYBOARD_OK);
+    EXPECT_EQ(title, "title2");
+    EXPECT_FALSE(my_search.cancel());
+}
+
+TEST_F(QueryTestCppAPI, query_predicates)
+{
+    using namespace storyboard::query;
+
+    // Predicates on string literals can be built at compile time
+    constexpr auto urgent = hasTag("tag4") && !textContains("bye");
+    static_assert(sizeof(urgent) == 2 * sizeof(Key), "composed predicates hold only their keys");
+
+    std::string title = "title1";
+
+    EXPECT_TRUE(urgent(note2));
+    EXPECT_FALSE(urgent(note1));
+    EXPECT_TRUE((titleEquals(title) || hasTag("tag5"))(note1));
+    EXPECT_TRUE((titleEquals(title) || hasTag("tag5"))(note2));
+    EXPECT_FALSE((titleEquals(title) && textContains("hola"))(note2));
+    EXPECT_TRUE(any()(note1));
+
+    note_cont_t matching;
+    my_board.searchByTag("tag1", [&](const NoteView& view) {
+        Note note = view.toNote();
+        if ((textContains("hei") || !hasTag("tag1"))(note))
+        {
+            matching.push_back(note);
+        }
+    });
+
+    ASSERT_EQ(matching.size(), 1);
+    EXPECT_EQ(matching.front().getTitle(), "title2");
+}
+
+TEST_F(QueryTestCppAPI, board_stats)
+{
+    note_cont_t query_result;
+
+    EXPECT_NO_THROW(my_board.enableStats(true));
+    EXPECT_EQ(my_board.searchByTitle("title2", query_result), 1);
+    EXPECT_EQ(my_board.searchByTitle("title3", query_result), 0);
+
+    std::vector<storyboard_op_stats> stats = my_board.getStats();
+    ASSERT_EQ(stats.size(), 1);
+    EXPECT_STREQ(stats.at(0).operation, "storyboard_search_by_title_n");
+    EXPECT_EQ(stats.at(0).calls, 2);
+    EXPECT_EQ(stats.at(0).results, 1);
+    EXPECT_EQ(stats.at(0).errors, 0);
+
+    EXPECT_NO_THROW(my_board.resetStats());
+    EXPECT_TRUE(my_board.getStats().empty());
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);